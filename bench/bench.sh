@@ -0,0 +1,100 @@
+#!/bin/sh
+#
+# End-to-end benchmark of histogramr on synthetic input.
+#
+# USAGE: make bench [BENCH_ROWS=...] [BENCH_DIMS=...] ...
+#
+# Every combination of dimensionality, grid volume, distribution
+# (occupancy) and save interval is run once. The metrics records of
+# histogramr (-T) are written to $BENCH_OUT, one JSON object per line,
+# tagged with the configuration, followed by one "total" record per
+# run with its wall time, throughput and peak memory.
+
+: ${HISTOGRAMR:=../src/histogramr}
+: ${GENERATE:=./histogramr-generate}
+: ${BENCH_DIR:=bench-data}
+: ${BENCH_OUT:=bench-results.jsonl}
+: ${BENCH_ROWS:=250000}
+: ${BENCH_FILES:=4}
+: ${BENCH_ARRAY:=0}
+: ${BENCH_COMPRESSION:=none}
+: ${BENCH_DIMS:=1 2 3 4}
+: ${BENCH_VOLUMES:=1000 1000000}
+: ${BENCH_DISTRIBUTIONS:=uniform gaussian heavy clustered}
+: ${BENCH_SAVEVERY:=1 0}
+: ${BENCH_FORMATS:=sparse}
+
+set -e
+
+maxdim=0
+for dim in $BENCH_DIMS; do
+  test $dim -gt $maxdim && maxdim=$dim
+done
+
+mkdir -p "$BENCH_DIR"
+: > "$BENCH_OUT"
+
+# the input is generated once per distribution and reused by every run
+input=$BENCH_ROWS-m$maxdim-a$BENCH_ARRAY-z$BENCH_COMPRESSION
+for dist in $BENCH_DISTRIBUTIONS; do
+  n=0
+  while test $n -lt $BENCH_FILES; do
+    file="$BENCH_DIR/$dist-$input.$n.h5"
+    if test ! -f "$file"; then
+      "$GENERATE" -o "$file" -n $BENCH_ROWS -m $maxdim -a $BENCH_ARRAY \
+        -D $dist -z $BENCH_COMPRESSION -r $n
+    fi
+    n=`expr $n + 1`
+  done
+done
+
+for dim in $BENCH_DIMS; do
+for volume in $BENCH_VOLUMES; do
+for dist in $BENCH_DISTRIBUTIONS; do
+for savevery in $BENCH_SAVEVERY; do
+for format in $BENCH_FORMATS; do
+  # equal bins on the unit interval, about $volume cells in total
+  set -- `awk -v d=$dim -v v=$volume 'BEGIN {
+    n = int (v ^ (1 / d) + .5); if (n < 1) n = 1
+    for (i = 0; i < d; i++) {
+      m = m (i ? ":" : "") "m" i; b = b (i ? ":" : "") 1 / n; l = l (i ? ":" : "") "0,1"
+    }
+    print m, b, l, n ^ d
+  }'`
+  name="d$dim-v$volume-$dist-e$savevery-$format"
+  files=
+  n=0
+  while test $n -lt $BENCH_FILES; do
+    files="$files $BENCH_DIR/$dist-$input.$n.h5"
+    n=`expr $n + 1`
+  done
+  printf "%s... " "$name"
+  "$HISTOGRAMR" -d data -m $1 -b $2 -l $3 -e $savevery -f $format \
+    -T "$BENCH_DIR/$name.jsonl" -o "$BENCH_DIR/$name.h5" \
+    $files > /dev/null
+  awk -v tag="\"bench\": \"$name\", \"dims\": $dim, \"cells\": $4, \"distribution\": \"$dist\", \"save_every\": $savevery, \"format\": \"$format\", \"array\": $BENCH_ARRAY, \"compression\": \"$BENCH_COMPRESSION\", " '
+    function field (key,    s) {
+      if (! match ($0, "\"" key "\": [0-9.e+-]+"))
+        return 0
+      s = substr ($0, RSTART, RLENGTH)
+      sub (/^[^:]*: /, "", s)
+      return s + 0
+    }
+    {
+      sub (/^\{/, "{" tag)
+      print
+      if (field("elapsed") > elapsed) elapsed = field("elapsed")
+      if (field("max_rss") > rss) rss = field("max_rss")
+      if ($0 ~ /"phase": "load"/) { rows += field("rows"); bytes += field("bytes") }
+    }
+    END {
+      printf "{%s\"phase\": \"total\", \"seconds\": %.6f, \"bytes\": %d, \"rows\": %d, \"rows_per_s\": %.1f, \"max_rss\": %d}\n", tag, elapsed, bytes, rows, (elapsed > 0) ? rows / elapsed : 0, rss
+    }' "$BENCH_DIR/$name.jsonl" | tee -a "$BENCH_OUT" | tail -n 1 | sed 's/.*"seconds": \([0-9.]*\).*"rows_per_s": \([0-9.]*\).*/\1 s, \2 rows\/s/'
+  rm -f "$BENCH_DIR/$name.h5" "$BENCH_DIR/$name.jsonl"
+done
+done
+done
+done
+done
+
+echo "results: $BENCH_OUT"
@@ -0,0 +1,294 @@
+/* generate.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "generate.h"
+
+int
+main (
+  int argc, char * argv[]
+)
+{
+  int optchar, level = -1;
+  size_t i, j, k, nrow = 1000000, chunk = 65536;
+  char * output = NULL, * dataset = "data", name[32];
+  double * buf;
+  generator_t gen = {DIST_UNIFORM, 3, 0, 1, NULL};
+  hid_t file, dset, space, memspace, memtype, member_type, dcpl;
+  hsize_t dims[1], start[1], count[1], adim[1];
+  herr_t status;
+  
+  static const char short_options[] = {
+    OPT_OUTPUT, ':',
+    OPT_DATASET, ':',
+    OPT_ROWS, ':',
+    OPT_MEMBERS, ':',
+    OPT_ARRAY, ':',
+    OPT_DISTRIBUTION, ':',
+    OPT_COMPRESSION, ':',
+    OPT_CHUNK, ':',
+    OPT_SEED, ':',
+    OPT_HELP,
+    OPT_VERSION,
+    '\0'
+  };
+  static const struct option long_options[] = {
+    { "output", required_argument, NULL, OPT_OUTPUT },
+    { "dataset", required_argument, NULL, OPT_DATASET },
+    { "rows", required_argument, NULL, OPT_ROWS },
+    { "members", required_argument, NULL, OPT_MEMBERS },
+    { "array", required_argument, NULL, OPT_ARRAY },
+    { "distribution", required_argument, NULL, OPT_DISTRIBUTION },
+    { "compression", required_argument, NULL, OPT_COMPRESSION },
+    { "chunk", required_argument, NULL, OPT_CHUNK },
+    { "seed", required_argument, NULL, OPT_SEED },
+    
+    { "help", no_argument, NULL, OPT_HELP },
+    { "version", no_argument, NULL, OPT_VERSION },
+    
+    { NULL, 0, NULL, 0 }
+  };
+  
+  while ((optchar = getopt_long (argc, argv, short_options, long_options, NULL)) != EOF)
+    switch (optchar)
+    {
+      case OPT_OUTPUT:
+        output = optarg;
+        break;
+      case OPT_DATASET:
+        dataset = optarg;
+        break;
+      case OPT_ROWS:
+        nrow = (size_t) strtoul (optarg, NULL, 10);
+        break;
+      case OPT_MEMBERS:
+        gen.nmember = (size_t) strtoul (optarg, NULL, 10);
+        break;
+      case OPT_ARRAY:
+        gen.length = (size_t) strtoul (optarg, NULL, 10);
+        break;
+      case OPT_DISTRIBUTION:
+        if (strcasecmp (optarg, "uniform") == 0)
+          gen.dist = DIST_UNIFORM;
+        else if (strcasecmp (optarg, "gaussian") == 0)
+          gen.dist = DIST_GAUSSIAN;
+        else if (strcasecmp (optarg, "heavy") == 0)
+          gen.dist = DIST_HEAVY;
+        else if (strcasecmp (optarg, "clustered") == 0)
+          gen.dist = DIST_CLUSTERED;
+        else
+        {
+          fprintf (stderr, "fatal: unknown distribution `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, GENERATE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_COMPRESSION:
+        level = (strcasecmp (optarg, "none") == 0) ? -1 : atoi (optarg);
+        break;
+      case OPT_CHUNK:
+        chunk = (size_t) strtoul (optarg, NULL, 10);
+        break;
+      case OPT_SEED:
+        gen.state = strtoul (optarg, NULL, 10);
+        break;
+      
+      case OPT_HELP:
+        print_usage ();
+        exit (EXIT_SUCCESS);
+      case OPT_VERSION:
+        print_version ();
+        exit (EXIT_SUCCESS);
+      
+      default:
+        fprintf (stderr, "try '%s --help' for more information\n", GENERATE_NAME);
+        exit (EXIT_FAILURE);
+    }
+  
+  if (! output || ! gen.nmember || ! chunk || optind != argc)
+  {
+    fprintf (stderr, "fatal: an output file and at least one member must be given.\n"
+                     "try '%s --help' for more information\n", GENERATE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* xorshift needs a non-zero state, the same seed gives the same file everywhere */
+  gen.state = gen.state * 2685821657736338717ul + 1442695040888963407ul;
+  if (! gen.state)
+    gen.state = 1;
+  gen.centre = malloc (GENERATE_CLUSTERS * gen.nmember * sizeof (* gen.centre));
+  for (i = 0; i < GENERATE_CLUSTERS * gen.nmember; i++)
+    gen.centre[i] = .1 + .8 * generate_uniform (& gen);
+  
+  /* members m0, m1, ... of native doubles, or of arrays of them */
+  if (gen.length)
+  {
+    adim[0] = gen.length;
+    member_type = H5Tarray_create (H5T_NATIVE_DOUBLE, 1, adim);
+  }
+  else
+  {
+    gen.length = 1;
+    member_type = H5Tcopy (H5T_NATIVE_DOUBLE);
+  }
+  memtype = H5Tcreate (H5T_COMPOUND, gen.nmember * gen.length * sizeof (double));
+  for (j = 0; j < gen.nmember; j++)
+  {
+    sprintf (name, "m%lu", (unsigned long int) j);
+    status = H5Tinsert (memtype, name, j * gen.length * sizeof (double), member_type);
+  }
+  
+  if (chunk > nrow)
+    chunk = nrow ? nrow : 1;
+  dims[0] = chunk;
+  dcpl = H5Pcreate (H5P_DATASET_CREATE);
+  status = H5Pset_chunk (dcpl, 1, dims);
+  if (level >= 0)
+    status = H5Pset_deflate (dcpl, (unsigned int) level);
+  
+  if ((file = H5Fcreate (output, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)) < 0)
+  {
+    fprintf (stderr, "fatal: file `%s' could not be created.\n"
+                     "try '%s --help' for more information\n", output, GENERATE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  dims[0] = nrow;
+  space = H5Screate_simple (1, dims, NULL);
+  dset = H5Dcreate (file, dataset, memtype, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  
+  /* rows are drawn and written one chunk at a time */
+  buf = malloc (chunk * gen.nmember * gen.length * sizeof (* buf));
+  for (start[0] = 0; start[0] < nrow; start[0] += count[0])
+  {
+    count[0] = (nrow - start[0] < chunk) ? nrow - start[0] : chunk;
+    for (i = 0; i < count[0]; i++)
+      for (j = 0; j < gen.nmember; j++)
+        for (k = 0; k < gen.length; k++)
+          buf[(i * gen.nmember + j) * gen.length + k] = generate_value (& gen, j);
+    memspace = H5Screate_simple (1, count, NULL);
+    status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, NULL, count, NULL);
+    status = H5Dwrite (dset, memtype, memspace, space, H5P_DEFAULT, buf);
+    status = H5Sclose (memspace);
+  }
+  
+  free (buf);
+  free (gen.centre);
+  status = H5Dclose (dset);
+  status = H5Sclose (space);
+  status = H5Pclose (dcpl);
+  status = H5Tclose (memtype);
+  status = H5Tclose (member_type);
+  status = H5Fclose (file);
+  
+  return (status < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static double
+generate_uniform (
+  generator_t * const gen
+)
+{
+  /* xorshift64*, 53 bits in [0, 1) */
+  gen->state ^= gen->state >> 12;
+  gen->state ^= gen->state << 25;
+  gen->state ^= gen->state >> 27;
+  
+  return ((double) ((gen->state * 2685821657736338717ul) >> 11) / 9007199254740992.);
+}
+
+static double
+generate_gaussian (
+  generator_t * const gen
+)
+{
+  double u;
+  
+  /* Box-Muller, one of the pair is enough here */
+  while ((u = generate_uniform (gen)) <= 0.)
+    ;
+  
+  return (sqrt (-2. * log (u)) * cos (2. * M_PI * generate_uniform (gen)));
+}
+
+static double
+generate_value (
+  generator_t * const gen, const size_t member
+)
+{
+  size_t cluster;
+  
+  /* every distribution is centred on the unit interval, the heavy tails reach far beyond */
+  switch (gen->dist)
+  {
+    case DIST_GAUSSIAN:
+      return (.5 + .15 * generate_gaussian (gen));
+    case DIST_HEAVY:
+      return (.5 + .02 * tan (M_PI * (generate_uniform (gen) - .5)));
+    case DIST_CLUSTERED:
+      cluster = (size_t) (generate_uniform (gen) * GENERATE_CLUSTERS);
+      return (gen->centre[cluster * gen->nmember + member] + .01 * generate_gaussian (gen));
+    default:
+      return (generate_uniform (gen));
+  }
+}
+
+static void
+print_usage (
+  void
+)
+{
+  printf (
+    "%s: write synthetic input for benchmarks\n\n"
+    "Usage: %s -o <outfile> [-d <dsname>] [-n <rows>] [-m <members>]\n"
+    "  [-a <length>] [-D <distribution>] [-z <level>] [-c <rows>] [-r <seed>]\n\n"
+    "Mandatory options:\n"
+    "  -o, --output <outfile>     name the output file\n\n"
+    "Optional options:\n"
+    "  -d, --dataset <dsname>     compound data set (default: data)\n"
+    "  -n, --rows <rows>          number of rows (default: 1000000)\n"
+    "  -m, --members <members>    number of members m0, m1, ... (default: 3)\n"
+    "  -a, --array <length>       members are arrays of <length> doubles\n"
+    "                             (default: 0, plain doubles)\n"
+    "  -D, --distribution <name>  uniform, gaussian, heavy or clustered\n"
+    "                             (default: uniform)\n"
+    "  -z, --compression <level>  deflate level, or none (default: none)\n"
+    "  -c, --chunk <rows>         rows per chunk (default: 65536)\n"
+    "  -r, --seed <number>        random seed (default: 1)\n\n"
+    "Other options:\n"
+    "  -h, --help                 print this help message and quit\n"
+    "  -V, --version              print version information and quit\n\n"
+    "Report bugs to: %s\n"
+    "%s home page: <%s>\n",
+    GENERATE_NAME, GENERATE_NAME, PACKAGE_BUGREPORT, PACKAGE_NAME, PACKAGE_URL
+  );
+
+  return;
+}
+
+static void
+print_version (
+  void
+)
+{
+  printf (
+    "%s-%s\n"
+    "Copyright (C) 2015 Torsten Scholak\n",
+    GENERATE_NAME, PACKAGE_VERSION
+  );
+
+  return;
+}
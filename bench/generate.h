@@ -0,0 +1,93 @@
+/* generate.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __generate_h__
+#define __generate_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+
+#define GENERATE_NAME PACKAGE_NAME "-generate"
+#define GENERATE_CLUSTERS 16
+
+enum
+{
+  OPT_OUTPUT = 'o',
+  OPT_DATASET = 'd',
+  OPT_ROWS = 'n',
+  OPT_MEMBERS = 'm',
+  OPT_ARRAY = 'a',
+  OPT_DISTRIBUTION = 'D',
+  OPT_COMPRESSION = 'z',
+  OPT_CHUNK = 'c',
+  OPT_SEED = 'r',
+
+  OPT_HELP = 'h',
+  OPT_VERSION = 'V'
+};
+
+typedef enum
+{
+  DIST_UNIFORM = 0,
+  DIST_GAUSSIAN,
+  DIST_HEAVY,
+  DIST_CLUSTERED
+}
+dist_t;
+
+typedef struct
+{
+  dist_t dist;
+  size_t nmember, length;
+  unsigned long int state;
+  double * centre;
+}
+generator_t;
+
+static double
+generate_uniform (
+  generator_t * const gen
+);
+
+static double
+generate_gaussian (
+  generator_t * const gen
+);
+
+static double
+generate_value (
+  generator_t * const gen, const size_t member
+);
+
+static void
+print_usage (
+  void
+);
+
+static void
+print_version (
+  void
+);
+
+#endif
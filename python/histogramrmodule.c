@@ -0,0 +1,652 @@
+/* histogramrmodule.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Python bindings of libhistogramr. Samples are taken from any object
+ * exporting float64 buffers, NumPy arrays among them, without copying,
+ * and the counts are returned as memoryviews, which numpy.asarray wraps
+ * without copying either. */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+
+#include <string.h>
+
+#include "libhistogramr.h"
+
+typedef struct
+{
+  PyObject_HEAD
+  histogramr_t * histogramr;
+  Py_ssize_t dim;
+}
+HistogramObject;
+
+/* the library keeps global counters, its calls are serialized across threads */
+static PyThread_type_lock histogramr_lock;
+
+static PyTypeObject HistogramType;
+
+static void
+histogram_lock (
+  void
+)
+{
+  /* waits with the GIL released, the holder may need it to finish */
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock (histogramr_lock, WAIT_LOCK);
+  Py_END_ALLOW_THREADS
+}
+
+static int
+histogram_current (
+  HistogramObject * const self, const Py_ssize_t dim
+)
+{
+  /* under the lock, the handle a call began with was not replaced by __init__ */
+  return (self->histogramr && self->dim == dim);
+}
+
+static int
+histogram_doubles (
+  PyObject * const seq, const Py_ssize_t dim, const char * const what,
+  double * const v, const double fill
+)
+{
+  Py_ssize_t i;
+  PyObject * fast;
+  
+  if (seq == NULL || seq == Py_None)
+  {
+    for (i = 0; i < dim; i++)
+      v[i] = fill;
+    return (0);
+  }
+  if (! (fast = PySequence_Fast (seq, what)))
+    return (-1);
+  if (PySequence_Fast_GET_SIZE (fast) != dim)
+  {
+    PyErr_Format (PyExc_ValueError, "%s must have one value per axis", what);
+    Py_DECREF (fast);
+    return (-1);
+  }
+  for (i = 0; i < dim; i++)
+    v[i] = PyFloat_AsDouble (PySequence_Fast_GET_ITEM (fast, i));
+  Py_DECREF (fast);
+  
+  return (PyErr_Occurred () ? -1 : 0);
+}
+
+static int
+Histogram_init (
+  HistogramObject * self,
+  PyObject * args, PyObject * kwds
+)
+{
+  static char * kwlist[] = {"binning", "lower", "upper", "log10", "members", NULL};
+  PyObject * binning, * lower = NULL, * upper = NULL, * log10 = NULL, * members = NULL, * fast;
+  Py_ssize_t i, dim;
+  
+  if (! PyArg_ParseTupleAndKeywords (args, kwds, "O|OOOO", kwlist, & binning, & lower, & upper, & log10, & members))
+    return (-1);
+  if ((dim = PySequence_Size (binning)) < 1)
+  {
+    PyErr_SetString (PyExc_ValueError, "binning must have one value per axis");
+    return (-1);
+  }
+  if ((lower == NULL || lower == Py_None) != (upper == NULL || upper == Py_None))
+  {
+    PyErr_SetString (PyExc_ValueError, "lower and upper must be given together");
+    return (-1);
+  }
+  
+  {
+    double b[dim], l[dim], u[dim], f[dim];
+    int l10[dim];
+    const char * name[dim];
+    
+    if (histogram_doubles (binning, dim, "binning", b, 0.)
+        || histogram_doubles (lower, dim, "lower", l, 0.)
+        || histogram_doubles (upper, dim, "upper", u, 0.)
+        || histogram_doubles (log10, dim, "log10", f, 0.))
+      return (-1);
+    for (i = 0; i < dim; i++)
+      l10[i] = f[i] != 0.;
+    
+    fast = NULL;
+    if (members && members != Py_None)
+    {
+      if (! (fast = PySequence_Fast (members, "members")))
+        return (-1);
+      if (PySequence_Fast_GET_SIZE (fast) != dim)
+      {
+        PyErr_SetString (PyExc_ValueError, "members must have one name per axis");
+        Py_DECREF (fast);
+        return (-1);
+      }
+      for (i = 0; i < dim; i++)
+        if (! (name[i] = PyUnicode_AsUTF8 (PySequence_Fast_GET_ITEM (fast, i))))
+        {
+          Py_DECREF (fast);
+          return (-1);
+        }
+    }
+    
+    histogram_lock ();
+    histogramr_free (self->histogramr);
+    self->histogramr = histogramr_create (
+                         (size_t) dim, fast ? name : NULL, b,
+                         (lower && lower != Py_None) ? l : NULL, (upper && upper != Py_None) ? u : NULL,
+                         l10
+                       );
+    self->dim = dim;
+    PyThread_release_lock (histogramr_lock);
+    Py_XDECREF (fast);
+  }
+  
+  if (! self->histogramr)
+  {
+    PyErr_SetString (PyExc_ValueError, "invalid histogram, check the bin sizes and limits");
+    return (-1);
+  }
+  
+  return (0);
+}
+
+static void
+Histogram_dealloc (
+  HistogramObject * self
+)
+{
+  if (self->histogramr)
+  {
+    histogram_lock ();
+    histogramr_free (self->histogramr);
+    PyThread_release_lock (histogramr_lock);
+  }
+  Py_TYPE (self)->tp_free ((PyObject *) self);
+}
+
+static int
+histogram_ready (
+  HistogramObject * const self
+)
+{
+  if (self->histogramr)
+    return (1);
+  PyErr_SetString (PyExc_RuntimeError, "histogram is not initialized");
+  
+  return (0);
+}
+
+static PyObject *
+Histogram_add (
+  HistogramObject * self,
+  PyObject * samples
+)
+{
+  const Py_ssize_t dim = self->dim;
+  Py_ssize_t i, j, n = 0, stride = 0;
+  const double * column[dim];
+  Py_buffer view[dim];
+  Py_ssize_t nview = 0;
+  PyObject * fast = NULL, * ret = NULL;
+  int current, status = EXIT_FAILURE;
+  
+  if (! histogram_ready (self))
+    return (NULL);
+  
+  /* one buffer of n samples by dim axes, or one buffer per axis */
+  if (PyObject_CheckBuffer (samples))
+  {
+    if (PyObject_GetBuffer (samples, & view[0], PyBUF_STRIDED_RO | PyBUF_FORMAT))
+      return (NULL);
+    nview = 1;
+    if (view[0].ndim != 2 || view[0].shape[1] != dim)
+    {
+      PyErr_Format (PyExc_ValueError, "samples must have the shape (n, %zd)", dim);
+      goto done;
+    }
+    n = view[0].shape[0];
+    stride = view[0].strides[0];
+    for (i = 0; i < dim; i++)
+      column[i] = (const double *) ((const char *) view[0].buf + i * view[0].strides[1]);
+  }
+  else
+  {
+    if (! (fast = PySequence_Fast (samples, "samples must be a buffer or a sequence of buffers")))
+      return (NULL);
+    if (PySequence_Fast_GET_SIZE (fast) != dim)
+    {
+      PyErr_Format (PyExc_ValueError, "samples must have %zd columns", dim);
+      goto done;
+    }
+    for (i = 0; i < dim; i++)
+    {
+      if (PyObject_GetBuffer (PySequence_Fast_GET_ITEM (fast, i), & view[i], PyBUF_STRIDED_RO | PyBUF_FORMAT))
+        goto done;
+      nview++;
+      if (view[i].ndim != 1 || (i && (view[i].shape[0] != n || view[i].strides[0] != stride)))
+      {
+        PyErr_SetString (PyExc_ValueError, "columns must be one-dimensional, of equal length and stride");
+        goto done;
+      }
+      n = view[i].shape[0];
+      stride = view[i].strides[0];
+      column[i] = view[i].buf;
+    }
+  }
+  for (j = 0; j < nview; j++)
+    if (! view[j].format || strcmp (view[j].format, "d") || view[j].itemsize != sizeof (double))
+    {
+      PyErr_SetString (PyExc_TypeError, "samples must be float64");
+      goto done;
+    }
+  if (stride <= 0)
+  {
+    PyErr_SetString (PyExc_ValueError, "samples must have positive strides");
+    goto done;
+  }
+  
+  /* the samples are binned in place, other threads may run meanwhile */
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock (histogramr_lock, WAIT_LOCK);
+  if ((current = histogram_current (self, dim)))
+    status = histogramr_add (self->histogramr, (size_t) n, column, (size_t) stride);
+  PyThread_release_lock (histogramr_lock);
+  Py_END_ALLOW_THREADS
+  
+  if (! current)
+    PyErr_SetString (PyExc_RuntimeError, "histogram was reinitialized meanwhile");
+  else if (status != EXIT_SUCCESS)
+    PyErr_NoMemory ();
+  else
+    ret = Py_NewRef (Py_None);
+  
+done:
+  for (j = 0; j < nview; j++)
+    PyBuffer_Release (& view[j]);
+  Py_XDECREF (fast);
+  
+  return (ret);
+}
+
+static PyObject *
+Histogram_merge (
+  HistogramObject * self,
+  PyObject * other
+)
+{
+  int status = EXIT_FAILURE;
+  
+  if (! PyObject_TypeCheck (other, & HistogramType))
+  {
+    PyErr_SetString (PyExc_TypeError, "only histograms can be merged");
+    return (NULL);
+  }
+  if (! histogram_ready (self) || ! histogram_ready ((HistogramObject *) other))
+    return (NULL);
+  
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock (histogramr_lock, WAIT_LOCK);
+  if (self->histogramr && ((HistogramObject *) other)->histogramr)
+    status = histogramr_merge (self->histogramr, ((HistogramObject *) other)->histogramr);
+  PyThread_release_lock (histogramr_lock);
+  Py_END_ALLOW_THREADS
+  
+  if (status != EXIT_SUCCESS)
+  {
+    PyErr_SetString (PyExc_ValueError, "histograms have different axes");
+    return (NULL);
+  }
+  
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+Histogram_set (
+  HistogramObject * self,
+  PyObject * args
+)
+{
+  const char * name, * value;
+  int status;
+  
+  if (! PyArg_ParseTuple (args, "ss", & name, & value) || ! histogram_ready (self))
+    return (NULL);
+  
+  /* moments may be freed, no add may be binning into them */
+  histogram_lock ();
+  status = self->histogramr ? histogramr_set (self->histogramr, name, value) : EXIT_FAILURE;
+  PyThread_release_lock (histogramr_lock);
+  
+  if (status != EXIT_SUCCESS)
+  {
+    PyErr_Format (PyExc_ValueError, "invalid option %s=%s", name, value);
+    return (NULL);
+  }
+  
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+Histogram_save (
+  HistogramObject * self,
+  PyObject * args
+)
+{
+  const char * output;
+  int status = EXIT_FAILURE;
+  
+  if (! PyArg_ParseTuple (args, "s", & output) || ! histogram_ready (self))
+    return (NULL);
+  
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock (histogramr_lock, WAIT_LOCK);
+  if (self->histogramr)
+    status = histogramr_save (self->histogramr, output);
+  PyThread_release_lock (histogramr_lock);
+  Py_END_ALLOW_THREADS
+  
+  if (status != EXIT_SUCCESS)
+  {
+    PyErr_Format (PyExc_OSError, "could not save `%s'", output);
+    return (NULL);
+  }
+  
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+histogram_view (
+  PyObject * const bytes, const char * const format,
+  const Py_ssize_t ndim, const Py_ssize_t * const shape
+)
+{
+  Py_ssize_t i;
+  PyObject * view, * cast, * tuple;
+  
+  /* a shaped view of the bytes, which it keeps alive */
+  if (! (view = PyMemoryView_FromObject (bytes)))
+    return (NULL);
+  
+  /* memoryviews have no shapes with zeros, no bins are a flat empty view */
+  if (! PyByteArray_GET_SIZE (bytes))
+  {
+    cast = PyObject_CallMethod (view, "cast", "s", format);
+    Py_DECREF (view);
+    return (cast);
+  }
+  if (! (tuple = PyTuple_New (ndim)))
+  {
+    Py_DECREF (view);
+    return (NULL);
+  }
+  for (i = 0; i < ndim; i++)
+    PyTuple_SET_ITEM (tuple, i, PyLong_FromSsize_t (shape[i]));
+  cast = PyObject_CallMethod (view, "cast", "sO", format, tuple);
+  Py_DECREF (tuple);
+  Py_DECREF (view);
+  
+  return (cast);
+}
+
+static PyObject *
+Histogram_dense (
+  HistogramObject * self,
+  PyObject * Py_UNUSED (ignored)
+)
+{
+  const Py_ssize_t dim = self->dim;
+  Py_ssize_t i, shape[dim];
+  long int lower[dim], upper[dim];
+  size_t size = 0, n;
+  int current, filled;
+  PyObject * bytes = NULL, * ret;
+  
+  if (! histogram_ready (self))
+    return (NULL);
+  
+  /* the counts are written once, straight into the exported buffer, which
+   * is allocated with the GIL, so it is sized anew if the extent changed */
+  for (;;)
+  {
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock (histogramr_lock, WAIT_LOCK);
+    n = (current = histogram_current (self, dim)) ? histogramr_size (self->histogramr) : 0;
+    if ((filled = n && n == size))
+    {
+      histogramr_extent (self->histogramr, lower, upper);
+      histogramr_dense (self->histogramr, (unsigned long int *) PyByteArray_AS_STRING (bytes));
+    }
+    PyThread_release_lock (histogramr_lock);
+    Py_END_ALLOW_THREADS
+    
+    if (filled || ! n)
+      break;
+    Py_XDECREF (bytes);
+    size = n;
+    if (! (bytes = PyByteArray_FromStringAndSize (NULL, (Py_ssize_t) (size * sizeof (unsigned long int)))))
+      return (NULL);
+  }
+  
+  if (! filled)
+  {
+    Py_XDECREF (bytes);
+    if (current)
+      PyErr_SetString (PyExc_ValueError, "the histogram has no dense layout, it is empty or too large");
+    else
+      PyErr_SetString (PyExc_RuntimeError, "histogram was reinitialized meanwhile");
+    return (NULL);
+  }
+  for (i = 0; i < dim; i++)
+    shape[i] = (Py_ssize_t) (upper[i] - lower[i]);
+  ret = histogram_view (bytes, "L", dim, shape);
+  Py_DECREF (bytes);
+  
+  return (ret);
+}
+
+static PyObject *
+Histogram_sparse (
+  HistogramObject * self,
+  PyObject * Py_UNUSED (ignored)
+)
+{
+  const Py_ssize_t dim = self->dim;
+  size_t size = 0, n;
+  int current, filled;
+  Py_ssize_t shape[2];
+  PyObject * index, * count, * view_index, * view_count;
+  
+  if (! histogram_ready (self))
+    return (NULL);
+  
+  /* the cells are counted and exported in one critical section, the
+   * buffers are allocated with the GIL in between and resized until the
+   * number of cells they were sized for still holds */
+  for (;;)
+  {
+    index = PyByteArray_FromStringAndSize (NULL, (Py_ssize_t) (size * dim * sizeof (long int)));
+    count = PyByteArray_FromStringAndSize (NULL, (Py_ssize_t) (size * sizeof (unsigned long int)));
+    if (! index || ! count)
+    {
+      Py_XDECREF (index);
+      Py_XDECREF (count);
+      return (NULL);
+    }
+    
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock (histogramr_lock, WAIT_LOCK);
+    n = (current = histogram_current (self, dim)) ? histogramr_cells (self->histogramr) : 0;
+    if ((filled = current && n == size))
+      histogramr_sparse (self->histogramr, (long int *) PyByteArray_AS_STRING (index), (unsigned long int *) PyByteArray_AS_STRING (count));
+    PyThread_release_lock (histogramr_lock);
+    Py_END_ALLOW_THREADS
+    
+    if (filled || ! current)
+      break;
+    Py_DECREF (index);
+    Py_DECREF (count);
+    size = n;
+  }
+  
+  if (! filled)
+  {
+    Py_DECREF (index);
+    Py_DECREF (count);
+    PyErr_SetString (PyExc_RuntimeError, "histogram was reinitialized meanwhile");
+    return (NULL);
+  }
+  shape[0] = (Py_ssize_t) n;
+  shape[1] = dim;
+  view_index = histogram_view (index, "l", 2, shape);
+  view_count = histogram_view (count, "L", 1, shape);
+  Py_DECREF (index);
+  Py_DECREF (count);
+  if (! view_index || ! view_count)
+  {
+    Py_XDECREF (view_index);
+    Py_XDECREF (view_count);
+    return (NULL);
+  }
+  
+  return (Py_BuildValue ("NN", view_index, view_count));
+}
+
+static PyObject *
+Histogram_get_charge (
+  HistogramObject * self,
+  void * closure
+)
+{
+  unsigned long int charge = 0;
+  
+  if (! histogram_ready (self))
+    return (NULL);
+  
+  histogram_lock ();
+  if (self->histogramr)
+    charge = histogramr_charge (self->histogramr);
+  PyThread_release_lock (histogramr_lock);
+  
+  return (PyLong_FromUnsignedLong (charge));
+}
+
+static PyObject *
+Histogram_get_extent (
+  HistogramObject * self,
+  void * closure
+)
+{
+  const Py_ssize_t dim = self->dim;
+  Py_ssize_t i;
+  long int lower[dim], upper[dim];
+  int current;
+  PyObject * ret;
+  
+  if (! histogram_ready (self))
+    return (NULL);
+  
+  histogram_lock ();
+  if ((current = histogram_current (self, dim)))
+    histogramr_extent (self->histogramr, lower, upper);
+  PyThread_release_lock (histogramr_lock);
+  
+  if (! current)
+  {
+    PyErr_SetString (PyExc_RuntimeError, "histogram was reinitialized meanwhile");
+    return (NULL);
+  }
+  if (! (ret = PyTuple_New (dim)))
+    return (NULL);
+  for (i = 0; i < dim; i++)
+    PyTuple_SET_ITEM (ret, i, Py_BuildValue ("ll", lower[i], upper[i]));
+  
+  return (ret);
+}
+
+static PyMethodDef Histogram_methods[] = {
+  {"add", (PyCFunction) Histogram_add, METH_O,
+   "add(samples)\n\nBins float64 samples, an (n, dim) buffer or a sequence of dim buffers\n"
+   "of n values each, in place and without the GIL."},
+  {"merge", (PyCFunction) Histogram_merge, METH_O,
+   "merge(other)\n\nAdds the counts of a histogram with the same axes."},
+  {"set", (PyCFunction) Histogram_set, METH_VARARGS,
+   "set(name, value)\n\nSets an output option by the long name of its command line option."},
+  {"save", (PyCFunction) Histogram_save, METH_VARARGS,
+   "save(output)\n\nWrites the histogram in the output format of histogramr."},
+  {"dense", (PyCFunction) Histogram_dense, METH_NOARGS,
+   "dense()\n\nThe counts of all bins of the extent, the box of the occupied bins within\n"
+   "the limits, as a uint64 memoryview of its shape."},
+  {"sparse", (PyCFunction) Histogram_sparse, METH_NOARGS,
+   "sparse()\n\nThe occupied bins as an (n, dim) int64 memoryview of bin indices and\n"
+   "a uint64 memoryview of their counts."},
+  {NULL}
+};
+
+static PyGetSetDef Histogram_getset[] = {
+  {"charge", (getter) Histogram_get_charge, NULL, "number of samples added, including those outside of the limits", NULL},
+  {"extent", (getter) Histogram_get_extent, NULL, "bin index range (lower, upper) of the occupied bins on every axis", NULL},
+  {NULL}
+};
+
+static PyTypeObject HistogramType = {
+  PyVarObject_HEAD_INIT (NULL, 0)
+  .tp_name = "histogramr.Histogram",
+  .tp_doc = PyDoc_STR ("Histogram(binning, lower=None, upper=None, log10=None, members=None)\n\n"
+                       "A multivariate histogram binned like histogramr."),
+  .tp_basicsize = sizeof (HistogramObject),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+  .tp_init = (initproc) Histogram_init,
+  .tp_dealloc = (destructor) Histogram_dealloc,
+  .tp_methods = Histogram_methods,
+  .tp_getset = Histogram_getset,
+};
+
+static struct PyModuleDef histogramr_module = {
+  PyModuleDef_HEAD_INIT,
+  .m_name = "histogramr",
+  .m_doc = "Multivariate histograms of continuous data, binned in place.",
+  .m_size = -1,
+};
+
+PyMODINIT_FUNC
+PyInit_histogramr (
+  void
+)
+{
+  PyObject * m;
+  
+  if (PyType_Ready (& HistogramType) < 0)
+    return (NULL);
+  if (! histogramr_lock && ! (histogramr_lock = PyThread_allocate_lock ()))
+    return (PyErr_NoMemory ());
+  if (! (m = PyModule_Create (& histogramr_module)))
+    return (NULL);
+  Py_INCREF (& HistogramType);
+  if (PyModule_AddObject (m, "Histogram", (PyObject *) & HistogramType) < 0)
+  {
+    Py_DECREF (& HistogramType);
+    Py_DECREF (m);
+    return (NULL);
+  }
+  
+  return (m);
+}
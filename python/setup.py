@@ -0,0 +1,26 @@
+# Build the Python bindings against the libhistogramr of this tree:
+#
+#   ./configure CFLAGS="-O2 -fPIC" && make && cd python && python3 setup.py build_ext
+#
+# The library is linked into the module, hence -fPIC. The locations of
+# HDF5 may be passed in CFLAGS and LDFLAGS, or with
+# build_ext -I and -L.
+
+from setuptools import setup, Extension
+
+setup (
+  name = "histogramr",
+  version = "0.1.0",
+  description = "Multivariate histograms of continuous data",
+  url = "https://github.com/tscholak/histogramr",
+  license = "GPLv3+",
+  ext_modules = [
+    Extension (
+      "histogramr",
+      sources = ["histogramrmodule.c"],
+      include_dirs = ["../src"],
+      extra_objects = ["../src/libhistogramr.a"],
+      libraries = ["hdf5", "z", "pthread", "m"],
+    )
+  ],
+)
@@ -0,0 +1,126 @@
+/* batch.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batch.h"
+
+batch_t *
+batch_alloc (
+  const options_t * const source
+)
+{
+  size_t i;
+  batch_t * batch;
+  
+  batch = malloc (sizeof (* batch));
+  batch->n = 0;
+  batch->size = 0;
+  batch->length = 0;
+  for (i = 0; i < NDATASET_MAX; i++)
+  {
+    batch->dim[i] = source->dim[i];
+    batch->buf[i] = NULL;
+    batch->raw[i] = NULL;
+  }
+  
+  return (batch);
+}
+
+void
+batch_free (
+  batch_t * const batch
+)
+{
+  size_t i;
+  
+  batch_clear (batch);
+  for (i = 0; i < NDATASET_MAX; i++)
+    free (batch->buf[i]);
+  free (batch);
+}
+
+void
+batch_add (
+  batch_t * const batch,
+  double *** const * const raw,
+  const size_t dataset_length, const size_t compound_member_length
+)
+{
+  size_t i;
+  
+  /* the buffers of load are contiguous, rows of all members of all elements */
+  if (! batch->n && compound_member_length != batch->length)
+    batch->size = 0;
+  if (batch->n + dataset_length > batch->size)
+  {
+    batch->size = (batch->n + dataset_length > 2 * batch->size) ? batch->n + dataset_length : 2 * batch->size;
+    for (i = 0; i < NDATASET_MAX; i++)
+      if (batch->dim[i])
+        batch->buf[i] = realloc (batch->buf[i], batch->size * batch->dim[i] * compound_member_length * sizeof (* batch->buf[i]));
+  }
+  for (i = 0; i < NDATASET_MAX; i++)
+    if (batch->dim[i])
+      memcpy (
+        batch->buf[i] + batch->n * batch->dim[i] * compound_member_length,
+        raw[i][0][0],
+        dataset_length * batch->dim[i] * compound_member_length * sizeof (* batch->buf[i])
+      );
+  batch->n += dataset_length;
+  batch->length = compound_member_length;
+}
+
+double *** const *
+batch_raw (
+  batch_t * const batch
+)
+{
+  size_t i, k, l;
+  
+  /* shaped like the buffers of load */
+  for (i = 0; i < NDATASET_MAX; i++)
+  {
+    if (! batch->dim[i])
+      continue;
+    batch->raw[i] = malloc (batch->n * sizeof (* batch->raw[i]));
+    batch->raw[i][0] = malloc (batch->n * batch->dim[i] * sizeof (* batch->raw[i][0]));
+    for (k = 0; k < batch->n; k++)
+    {
+      batch->raw[i][k] = batch->raw[i][0] + k * batch->dim[i];
+      for (l = 0; l < batch->dim[i]; l++)
+        batch->raw[i][k][l] = batch->buf[i] + (k * batch->dim[i] + l) * batch->length;
+    }
+  }
+  
+  return ((double *** const *) batch->raw);
+}
+
+void
+batch_clear (
+  batch_t * const batch
+)
+{
+  size_t i;
+  
+  for (i = 0; i < NDATASET_MAX; i++)
+    if (batch->raw[i])
+    {
+      free (batch->raw[i][0]);
+      free (batch->raw[i]);
+      batch->raw[i] = NULL;
+    }
+  batch->n = 0;
+}
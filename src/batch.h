@@ -0,0 +1,65 @@
+/* batch.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __batch_h__
+#define __batch_h__
+
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "structs.h"
+
+/* samples of small files binned together */
+#define BATCH_SIZE 4096
+
+/* inputs the kernel reads ahead of the current one */
+#define BATCH_AHEAD 16
+
+/* growth of the in-memory image of a small file, never written */
+#define BATCH_INCREMENT 1048576
+
+batch_t *
+batch_alloc (
+  const options_t * const source
+);
+
+void
+batch_free (
+  batch_t * const batch
+);
+
+void
+batch_add (
+  batch_t * const batch,
+  double *** const * const raw,
+  const size_t dataset_length, const size_t compound_member_length
+);
+
+double *** const *
+batch_raw (
+  batch_t * const batch
+);
+
+void
+batch_clear (
+  batch_t * const batch
+);
+
+#endif
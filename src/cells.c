@@ -0,0 +1,336 @@
+/* cells.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cells.h"
+
+cells_t *
+cells_open (
+  const char * const file, const char * const group
+)
+{
+  size_t i;
+  hid_t attr, space, strtype;
+  char * layout;
+  cells_t * cells;
+  herr_t status;
+  
+  cells = malloc (sizeof (* cells));
+  
+  if ((cells->file = H5Fopen (file, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0)
+  {
+    fprintf (stderr, "warning: file `%s' could not be opened.\n", file);
+    free (cells);
+    return (NULL);
+  }
+  cells->loc = group ? H5Gopen (cells->file, group, H5P_DEFAULT) : cells->file;
+  if (cells->loc < 0 || (cells->dset = H5Dopen (cells->loc, "probability density", H5P_DEFAULT)) < 0)
+  {
+    fprintf (stderr, "warning: file `%s' holds no histogram.\n", file);
+    if (cells->loc >= 0 && cells->loc != cells->file)
+      status = H5Gclose (cells->loc);
+    status = H5Fclose (cells->file);
+    free (cells);
+    return (NULL);
+  }
+  
+  /* dimension and binning */
+  cells->dim = 0;
+  if (H5Aexists (cells->dset, "analyzer binning") > 0)
+  {
+    attr = H5Aopen (cells->dset, "analyzer binning", H5P_DEFAULT);
+    space = H5Aget_space (attr);
+    cells->dim = (size_t) H5Sget_simple_extent_npoints (space);
+    status = H5Sclose (space);
+    status = H5Aclose (attr);
+  }
+  if (! cells->dim || cells->dim > H5S_MAX_RANK
+      || ! cells_attr (cells->dset, "analyzer binning", H5T_NATIVE_DOUBLE, cells->binning)
+      || ! cells_attr (cells->dset, "charge", H5T_NATIVE_ULONG, & cells->charge)
+      || ! cells_attr (cells->dset, "analyzer lower index", H5T_NATIVE_LONG, cells->idl)
+      || ! cells_attr (cells->dset, "analyzer upper index", H5T_NATIVE_LONG, cells->idu))
+  {
+    fprintf (stderr, "warning: histogram in `%s' lacks the binning attributes.\n", file);
+    cells->dim = 0;
+    cells_close (cells);
+    return (NULL);
+  }
+  
+  /* descriptive attributes are optional */
+  for (i = 0; i < cells->dim; i++)
+  {
+    cells->member[i] = NULL;
+    cells->limit_l[i] = - DBL_MAX;
+    cells->limit_u[i] = DBL_MAX;
+    cells->l10[i] = 0;
+  }
+  strtype = H5Tcopy (H5T_C_S1);
+  status = H5Tset_size (strtype, H5T_VARIABLE);
+  cells_attr (cells->dset, "members", strtype, cells->member);
+  cells_attr (cells->dset, "analyzer lower limit", H5T_NATIVE_DOUBLE, cells->limit_l);
+  cells_attr (cells->dset, "analyzer upper limit", H5T_NATIVE_DOUBLE, cells->limit_u);
+  cells_attr (cells->dset, "analyzer log10", H5T_NATIVE_HBOOL, cells->l10);
+  
+  /* outputs predating the layout attribute are dense */
+  strcpy (cells->layout, "dense");
+  if (cells_attr (cells->dset, "analyzer layout", strtype, & layout))
+  {
+    strncpy (cells->layout, layout, sizeof (cells->layout) - 1);
+    cells->layout[sizeof (cells->layout) - 1] = '\0';
+    H5free_memory (layout);
+  }
+  status = H5Tclose (strtype);
+  
+  cells_extent (cells);
+  
+  return (cells);
+}
+
+void
+cells_close (
+  cells_t * cells
+)
+{
+  size_t i;
+  herr_t status;
+  
+  for (i = 0; i < cells->dim; i++)
+    if (cells->member[i])
+      H5free_memory (cells->member[i]);
+  status = H5Dclose (cells->dset);
+  if (cells->loc != cells->file)
+    status = H5Gclose (cells->loc);
+  status = H5Fclose (cells->file);
+  free (cells);
+  cells = NULL;
+}
+
+void
+cells_read (
+  const cells_t * const cells,
+  const cells_cb_t cb, void * const ctx
+)
+{
+  if (! strcmp (cells->layout, "sparse"))
+    cells_read_sparse (cells, cb, ctx);
+  else
+    cells_read_table (cells, cb, ctx);
+}
+
+static bool
+cells_attr (
+  const hid_t dset, const char * const name, const hid_t memtype, void * const buf
+)
+{
+  hid_t attr;
+  herr_t status;
+  bool ret;
+  
+  if (H5Aexists (dset, name) <= 0)
+    return (false);
+  attr = H5Aopen (dset, name, H5P_DEFAULT);
+  ret = H5Aread (attr, memtype, buf) >= 0;
+  status = H5Aclose (attr);
+  
+  return (ret);
+}
+
+static void
+cells_extent (
+  cells_t * const cells
+)
+{
+  size_t i, k, rows;
+  char name[32];
+  hid_t dset, space, mem;
+  hsize_t length, start[1], count[1];
+  long int * buf, max;
+  herr_t status;
+  
+  /* dense and grid layouts cover the limits */
+  if (strcmp (cells->layout, "sparse"))
+  {
+    for (i = 0; i < cells->dim; i++)
+    {
+      cells->cl[i] = cells->idl[i];
+      cells->n[i] = (cells->idu[i] > cells->idl[i]) ? (hsize_t) ((unsigned long int) cells->idu[i] - (unsigned long int) cells->idl[i]) : 0;
+    }
+    return;
+  }
+  
+  /* the sparse layout may be unbounded, it covers the occupied cells */
+  rows = CELLS_BLOCK_SIZE / sizeof (* buf);
+  buf = malloc (rows * sizeof (* buf));
+  
+  for (i = 0; i < cells->dim; i++)
+  {
+    sprintf (name, "bin index %lu", i);
+    dset = H5Dopen (cells->loc, name, H5P_DEFAULT);
+    space = H5Dget_space (dset);
+    H5Sget_simple_extent_dims (space, & length, NULL);
+    
+    cells->cl[i] = LONG_MAX;
+    max = LONG_MIN;
+    for (start[0] = 0; start[0] < length; start[0] += count[0])
+    {
+      count[0] = (length - start[0] < rows) ? length - start[0] : rows;
+      status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, NULL, count, NULL);
+      mem = H5Screate_simple (1, count, NULL);
+      status = H5Dread (dset, H5T_NATIVE_LONG, mem, space, H5P_DEFAULT, buf);
+      status = H5Sclose (mem);
+      for (k = 0; k < count[0]; k++)
+      {
+        if (buf[k] < cells->cl[i])
+          cells->cl[i] = buf[k];
+        if (buf[k] > max)
+          max = buf[k];
+      }
+    }
+    cells->n[i] = (max >= cells->cl[i]) ? (hsize_t) ((unsigned long int) max - (unsigned long int) cells->cl[i]) + 1 : 0;
+    if (! cells->n[i])
+      cells->cl[i] = 0;
+    
+    status = H5Sclose (space);
+    status = H5Dclose (dset);
+  }
+  
+  free (buf);
+}
+
+static void
+cells_read_table (
+  const cells_t * const cells,
+  const cells_cb_t cb, void * const ctx
+)
+{
+  const size_t dim = cells->dim;
+  const bool grid = ! strcmp (cells->layout, "grid");
+  const size_t width = grid ? 1 : dim + 1;
+  size_t i, k, rows, n;
+  hsize_t start[H5S_MAX_RANK], count[H5S_MAX_RANK], r, total, plane;
+  long int id[H5S_MAX_RANK];
+  hid_t space, mem;
+  double * buf, norm;
+  herr_t status;
+  
+  for (i = 0, total = 1, norm = (double) cells->charge; i < dim; i++)
+  {
+    total *= cells->n[i];
+    norm *= cells->binning[i];
+    id[i] = cells->cl[i];
+  }
+  if (! total)
+    return;
+  
+  /* blocks of rows of the dense table, or of planes along the first grid axis */
+  plane = grid ? total / cells->n[0] : 1;
+  rows = CELLS_BLOCK_SIZE / (width * plane * sizeof (* buf));
+  if (! rows)
+    rows = 1;
+  buf = malloc (rows * plane * width * sizeof (* buf));
+  
+  space = H5Dget_space (cells->dset);
+  for (r = 0; r < (grid ? cells->n[0] : total); r += rows)
+  {
+    if (rows > (grid ? cells->n[0] : total) - r)
+      rows = (grid ? cells->n[0] : total) - r;
+    start[0] = r;
+    count[0] = rows;
+    for (i = 1; i < (grid ? dim : 2); i++)
+    {
+      start[i] = 0;
+      count[i] = grid ? cells->n[i] : width;
+    }
+    status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, NULL, count, NULL);
+    n = rows * plane;
+    count[0] = n * width;
+    mem = H5Screate_simple (1, count, NULL);
+    status = H5Dread (cells->dset, H5T_NATIVE_DOUBLE, mem, space, H5P_DEFAULT, buf);
+    status = H5Sclose (mem);
+    
+    /* cells come in row-major order, exact counts are density times charge and volume */
+    for (k = 0; k < n; k++)
+    {
+      cb (ctx, id, (unsigned long int) llround (buf[k * width + width - 1] * norm));
+      
+      i = dim - 1;
+      while (++id[i] == cells->cl[i] + (long int) cells->n[i] && i > 0)
+      {
+        id[i] = cells->cl[i];
+        i--;
+      }
+    }
+  }
+  status = H5Sclose (space);
+  
+  free (buf);
+}
+
+static void
+cells_read_sparse (
+  const cells_t * const cells,
+  const cells_cb_t cb, void * const ctx
+)
+{
+  const size_t dim = cells->dim;
+  size_t i, k, rows;
+  char name[32];
+  hid_t dset[dim], dset_c, space, mem;
+  hsize_t length, start[1], count[1];
+  long int * buf, id[dim];
+  unsigned long int * c;
+  herr_t status;
+  
+  for (i = 0; i < dim; i++)
+  {
+    sprintf (name, "bin index %lu", i);
+    dset[i] = H5Dopen (cells->loc, name, H5P_DEFAULT);
+  }
+  dset_c = H5Dopen (cells->loc, "count", H5P_DEFAULT);
+  space = H5Dget_space (dset_c);
+  H5Sget_simple_extent_dims (space, & length, NULL);
+  
+  rows = CELLS_BLOCK_SIZE / ((dim + 1) * sizeof (* buf));
+  buf = malloc (rows * dim * sizeof (* buf));
+  c = malloc (rows * sizeof (* c));
+  
+  for (start[0] = 0; start[0] < length; start[0] += count[0])
+  {
+    count[0] = (length - start[0] < rows) ? length - start[0] : rows;
+    status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, NULL, count, NULL);
+    mem = H5Screate_simple (1, count, NULL);
+    for (i = 0; i < dim; i++)
+      status = H5Dread (dset[i], H5T_NATIVE_LONG, mem, space, H5P_DEFAULT, & buf[i * rows]);
+    status = H5Dread (dset_c, H5T_NATIVE_ULONG, mem, space, H5P_DEFAULT, c);
+    status = H5Sclose (mem);
+    
+    /* entries come in tree order */
+    for (k = 0; k < count[0]; k++)
+    {
+      for (i = 0; i < dim; i++)
+        id[i] = buf[i * rows + k];
+      cb (ctx, id, c[k]);
+    }
+  }
+  
+  free (buf);
+  free (c);
+  status = H5Sclose (space);
+  status = H5Dclose (dset_c);
+  for (i = 0; i < dim; i++)
+    status = H5Dclose (dset[i]);
+}
@@ -0,0 +1,75 @@
+/* cells.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __cells_h__
+#define __cells_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+
+#include "structs.h"
+
+#define CELLS_BLOCK_SIZE 16777216
+
+cells_t *
+cells_open (
+  const char * const file, const char * const group
+);
+
+void
+cells_close (
+  cells_t * cells
+);
+
+void
+cells_read (
+  const cells_t * const cells,
+  const cells_cb_t cb, void * const ctx
+);
+
+static bool
+cells_attr (
+  const hid_t dset, const char * const name, const hid_t memtype, void * const buf
+);
+
+static void
+cells_extent (
+  cells_t * const cells
+);
+
+static void
+cells_read_table (
+  const cells_t * const cells,
+  const cells_cb_t cb, void * const ctx
+);
+
+static void
+cells_read_sparse (
+  const cells_t * const cells,
+  const cells_cb_t cb, void * const ctx
+);
+
+#endif
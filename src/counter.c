@@ -0,0 +1,317 @@
+/* counter.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "counter.h"
+
+/* bytes held by all blocks, for the memory budget */
+static unsigned long int counter_total = 0;
+/* cells held by all blocks */
+static unsigned long int counter_ncell = 0;
+
+static size_t
+counter_bytes (
+  const size_t size, const unsigned int width
+)
+{
+  return (sizeof (counter_t) + size * (sizeof (long int) + width));
+}
+
+static unsigned char *
+counter_base (
+  const counter_t * const counter
+)
+{
+  /* the counters follow the bin indices in the same allocation */
+  return ((unsigned char *) (counter->id + counter->size));
+}
+
+static unsigned long int
+counter_max (
+  const unsigned int width
+)
+{
+  if (width < sizeof (unsigned long int))
+    return ((1ul << (8 * width)) - 1);
+  
+  return (ULONG_MAX);
+}
+
+static unsigned long int
+counter_raw (
+  const counter_t * const counter, const size_t i
+)
+{
+  const unsigned char * const base = counter_base (counter);
+  
+  switch (counter->width)
+  {
+    case 1:
+      return (base[i]);
+    case 2:
+      return (((const unsigned short int *) base)[i]);
+    case 4:
+      return (((const unsigned int *) base)[i]);
+    default:
+      return (((const unsigned long int *) base)[i]);
+  }
+}
+
+static void
+counter_set (
+  counter_t * const counter, const size_t i,
+  const unsigned long int c
+)
+{
+  unsigned char * const base = counter_base (counter);
+  
+  switch (counter->width)
+  {
+    case 1:
+      base[i] = (unsigned char) c;
+      break;
+    case 2:
+      ((unsigned short int *) base)[i] = (unsigned short int) c;
+      break;
+    case 4:
+      ((unsigned int *) base)[i] = (unsigned int) c;
+      break;
+    default:
+      ((unsigned long int *) base)[i] = c;
+  }
+}
+
+static counter_t *
+counter_resize (
+  counter_t * const counter,
+  const size_t size, const unsigned int width
+)
+{
+  size_t i;
+  unsigned long int c, max;
+  counter_t * next;
+  
+  next = malloc (counter_bytes (size, width));
+  counter_total += counter_bytes (size, width);
+  next->size = size;
+  next->width = width;
+  
+  if (! counter)
+  {
+    next->n = 0;
+    next->nover = 0;
+    next->over = NULL;
+    return (next);
+  }
+  
+  next->n = counter->n;
+  next->nover = counter->nover;
+  next->over = counter->over;
+  memcpy (next->id, counter->id, counter->n * sizeof (* next->id));
+  if (width == counter->width)
+    memcpy (counter_base (next), counter_base (counter), counter->n * width);
+  else
+  {
+    /* overflowed counters stay saturated until the side table is folded */
+    max = counter_max (counter->width);
+    for (i = 0; i < counter->n; i++)
+    {
+      c = counter_raw (counter, i);
+      counter_set (next, i, (c == max) ? counter_max (width) : c);
+    }
+  }
+  
+  counter_total -= counter_bytes (counter->size, counter->width);
+  free (counter);
+  
+  return (next);
+}
+
+static size_t
+counter_over (
+  const counter_t * const counter,
+  const long int id
+)
+{
+  size_t lo = 0, hi = counter->nover, mid;
+  
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (counter->over[mid].id < id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  
+  return (lo);
+}
+
+static counter_t *
+counter_widen (
+  counter_t * counter
+)
+{
+  size_t j, k;
+  unsigned long int max;
+  
+  counter = counter_resize (counter, counter->size, 2 * counter->width);
+  max = counter_max (counter->width);
+  
+  /* fold the side table back into the counters that fit now */
+  for (j = 0, k = 0; k < counter->nover; k++)
+    if (counter->over[k].c < max)
+      counter_set (counter, counter_find (counter, 0, counter->over[k].id), counter->over[k].c);
+    else
+      counter->over[j++] = counter->over[k];
+  counter_total -= (counter->nover - j) * sizeof (* counter->over);
+  counter->nover = j;
+  if (! j)
+  {
+    free (counter->over);
+    counter->over = NULL;
+  }
+  
+  return (counter);
+}
+
+void
+counter_free (
+  counter_t * const counter
+)
+{
+  counter_total -= counter_bytes (counter->size, counter->width) + counter->nover * sizeof (* counter->over);
+  counter_ncell -= counter->n;
+  free (counter->over);
+  free (counter);
+}
+
+unsigned long int
+counter_allocated (
+  void
+)
+{
+  return (counter_total);
+}
+
+unsigned long int
+counter_cells (
+  void
+)
+{
+  return (counter_ncell);
+}
+
+size_t
+counter_find (
+  const counter_t * const counter, const size_t from,
+  const long int id
+)
+{
+  size_t lo = from, hi, mid;
+  
+  if (! counter)
+    return (0);
+  
+  /* first cell at or after the bin index */
+  hi = counter->n;
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (counter->id[mid] < id)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  
+  return (lo);
+}
+
+counter_t *
+counter_insert (
+  counter_t * counter, const size_t i,
+  const long int id
+)
+{
+  const size_t n = counter ? counter->n : 0;
+  unsigned char * base;
+  
+  if (! counter)
+    counter = counter_resize (NULL, 1, COUNTER_WIDTH);
+  else if (counter->n == counter->size)
+    counter = counter_resize (counter, 2 * counter->size, counter->width);
+  
+  base = counter_base (counter);
+  memmove (& counter->id[i + 1], & counter->id[i], (n - i) * sizeof (* counter->id));
+  memmove (& base[(i + 1) * counter->width], & base[i * counter->width], (n - i) * counter->width);
+  counter->id[i] = id;
+  counter_set (counter, i, 0);
+  counter->n++;
+  counter_ncell++;
+  
+  return (counter);
+}
+
+unsigned long int
+counter_get (
+  const counter_t * const counter, const size_t i
+)
+{
+  const unsigned long int c = counter_raw (counter, i);
+  
+  if (counter->width < sizeof (unsigned long int) && c == counter_max (counter->width))
+    return (counter->over[counter_over (counter, counter->id[i])].c);
+  
+  return (c);
+}
+
+counter_t *
+counter_add (
+  counter_t * counter, const size_t i,
+  const unsigned long int c
+)
+{
+  const unsigned long int max = counter_max (counter->width),
+                          v = counter_raw (counter, i);
+  size_t k;
+  
+  if (counter->width < sizeof (unsigned long int) && v == max)
+  {
+    counter->over[counter_over (counter, counter->id[i])].c += c;
+    return (counter);
+  }
+  if (counter->width == sizeof (unsigned long int) || c < max - v)
+  {
+    counter_set (counter, i, v + c);
+    return (counter);
+  }
+  
+  /* saturate the counter and keep the count in the side table */
+  k = counter_over (counter, counter->id[i]);
+  counter->over = realloc (counter->over, (counter->nover + 1) * sizeof (* counter->over));
+  memmove (& counter->over[k + 1], & counter->over[k], (counter->nover - k) * sizeof (* counter->over));
+  counter->over[k].id = counter->id[i];
+  counter->over[k].c = v + c;
+  counter->nover++;
+  counter_total += sizeof (* counter->over);
+  counter_set (counter, i, max);
+  
+  if (COUNTER_OVERFLOW * counter->nover > counter->n)
+    counter = counter_widen (counter);
+  
+  return (counter);
+}
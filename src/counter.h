@@ -0,0 +1,116 @@
+/* counter.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __counter_h__
+#define __counter_h__
+
+#include "global.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "structs.h"
+
+/* bytes per counter of a new block */
+#define COUNTER_WIDTH 1
+/* widen the block once more than one in so many counters overflowed */
+#define COUNTER_OVERFLOW 16
+
+static size_t
+counter_bytes (
+  const size_t size, const unsigned int width
+);
+
+static unsigned char *
+counter_base (
+  const counter_t * const counter
+);
+
+static unsigned long int
+counter_max (
+  const unsigned int width
+);
+
+static unsigned long int
+counter_raw (
+  const counter_t * const counter, const size_t i
+);
+
+static void
+counter_set (
+  counter_t * const counter, const size_t i,
+  const unsigned long int c
+);
+
+static counter_t *
+counter_resize (
+  counter_t * const counter,
+  const size_t size, const unsigned int width
+);
+
+static size_t
+counter_over (
+  const counter_t * const counter,
+  const long int id
+);
+
+static counter_t *
+counter_widen (
+  counter_t * counter
+);
+
+void
+counter_free (
+  counter_t * const counter
+);
+
+unsigned long int
+counter_allocated (
+  void
+);
+
+unsigned long int
+counter_cells (
+  void
+);
+
+size_t
+counter_find (
+  const counter_t * const counter, const size_t from,
+  const long int id
+);
+
+counter_t *
+counter_insert (
+  counter_t * counter, const size_t i,
+  const long int id
+);
+
+unsigned long int
+counter_get (
+  const counter_t * const counter, const size_t i
+);
+
+counter_t *
+counter_add (
+  counter_t * counter, const size_t i,
+  const unsigned long int c
+);
+
+#endif
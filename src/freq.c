@@ -18,6 +18,9 @@
 
 #include "freq.h"
 
+/* nodes alive in all trees, for the memory budget */
+static unsigned long int freq_nodes = 0;
+
 freq_t *
 freq_alloc (
   const long int id,
@@ -38,9 +41,12 @@ freq_alloc (
   
   cur->next = freq;
   cur->first = NULL;
+  cur->leaves = NULL;
   
   cur->c = 0;
   
+  freq_nodes++;
+  
   return (cur);
 }
 
@@ -57,8 +63,47 @@ freq_free (
     next = cur->next;
     freq_free (cur);
   }
+  if (freq->leaves)
+    counter_free (freq->leaves);
   free (freq);
   freq = NULL;
+  freq_nodes--;
+}
+
+void
+freq_prune (
+  freq_t * const freq
+)
+{
+  freq_t * cur, * next;
+  
+  next = freq->first;
+  while ((cur = next))
+  {
+    next = cur->next;
+    freq_free (cur);
+  }
+  freq->first = NULL;
+  if (freq->leaves)
+    counter_free (freq->leaves);
+  freq->leaves = NULL;
+}
+
+unsigned long int
+freq_allocated (
+  void
+)
+{
+  return (freq_nodes * FREQ_NODE_SIZE + counter_allocated ());
+}
+
+unsigned long int
+freq_population (
+  void
+)
+{
+  /* the same as freq_counter over all trees, plus their roots */
+  return (freq_nodes + counter_cells ());
 }
 
 static unsigned long int
@@ -84,13 +129,30 @@ freq_accumulate (
   const data_t * const data
 )
 {
-  size_t i;
+  size_t i, j, k;
   long int id;
   freq_t * prev, * cur;
   
   freq->c += freq_charge (data);
   
-  if (data->v)
+  if (data->v && data->b && ! (data->v[0])->v)
+  {
+    /* the last axis is counted in a block instead of leaf nodes */
+    for (i = 0, j = 0; i < data->b; i = k)
+    {
+      id = (data->v[i])->id;
+      for (k = i + 1; k < data->b && (data->v[k])->id == id; k++);
+      if (id < * freq->idl)
+        continue;
+      if (id > * freq->idu)
+        return;
+      j = counter_find (freq->leaves, j, id);
+      if (! freq->leaves || j == freq->leaves->n || freq->leaves->id[j] != id)
+        freq->leaves = counter_insert (freq->leaves, j, id);
+      freq->leaves = counter_add (freq->leaves, j, k - i);
+    }
+  }
+  else if (data->v)
   {
     i = 0;
     prev = NULL;
@@ -161,15 +223,61 @@ freq_accumulate (
   }
 }
 
+void
+freq_merge (
+  freq_t * const freq,
+  const freq_t * const other
+)
+{
+  size_t i, j;
+  freq_t * prev = NULL, * cur = freq->first;
+  const freq_t * src;
+  
+  freq->c += other->c;
+  
+  /* both blocks of the last axis are sorted by bin index */
+  if (other->leaves)
+    for (i = 0, j = 0; i < other->leaves->n; i++)
+    {
+      j = counter_find (freq->leaves, j, other->leaves->id[i]);
+      if (! freq->leaves || j == freq->leaves->n || freq->leaves->id[j] != other->leaves->id[i])
+        freq->leaves = counter_insert (freq->leaves, j, other->leaves->id[i]);
+      freq->leaves = counter_add (freq->leaves, j, counter_get (other->leaves, i));
+    }
+  
+  /* so are both child lists, they are merged in one pass */
+  for (src = other->first; src; src = src->next)
+  {
+    while (cur && cur->id < src->id)
+    {
+      prev = cur;
+      cur = cur->next;
+    }
+    if (! cur || cur->id != src->id)
+    {
+      cur = freq_alloc (src->id, freq->idl + 1, freq->idu + 1, freq->binning + 1, cur);
+      if (prev)
+        prev->next = cur;
+      else
+        freq->first = cur;
+    }
+    freq_merge (cur, src);
+  }
+}
+
 void
 freq_dump (
   const freq_t * const freq
 )
 {
+  size_t i;
   freq_t * cur, * next;
   
   printf ("id = %li, c = %lu\n", freq->id, freq->c);
   
+  for (i = 0; freq->leaves && i < freq->leaves->n; i++)
+    printf ("id = %li, c = %lu\n", freq->leaves->id[i], counter_get (freq->leaves, i));
+  
   next = freq->first;
   while ((cur = next))
   {
@@ -183,7 +291,7 @@ freq_counter (
   const freq_t * const freq
 )
 {
-  unsigned long int c = 0;
+  unsigned long int c = freq->leaves ? freq->leaves->n : 0;
   freq_t * cur, * next;
   
   next = freq->first;
@@ -196,18 +304,167 @@ freq_counter (
   return (c);
 }
 
+hsize_t
+freq_rows (
+  const freq_t * const freq,
+  const size_t dim
+)
+{
+  size_t i;
+  hsize_t rows = 1, range;
+  
+  for (i = 0; i < dim; i++)
+  {
+    if (freq->idu[i] <= freq->idl[i])
+      return (0);
+    range = (hsize_t) ((unsigned long int) freq->idu[i] - (unsigned long int) freq->idl[i]);
+    if (range > (HSIZE_UNDEF - 1) / rows)
+      return (HSIZE_UNDEF);
+    rows *= range;
+  }
+  
+  return (rows);
+}
+
+bool
+freq_extent (
+  const freq_t * const freq,
+  const size_t dim,
+  long int * const lo, long int * const hi
+)
+{
+  size_t n;
+  bool found = false;
+  freq_t * cur;
+  
+  /* widens lo and hi to the occupied cells of the output, hi exclusive */
+  if (dim == 1)
+  {
+    if (! freq->leaves)
+      return (false);
+    for (n = freq->leaves->n; n > 0 && freq->leaves->id[n - 1] >= * freq->idu; n--)
+      ;
+    if (! n)
+      return (false);
+    if (freq->leaves->id[0] < * lo)
+      * lo = freq->leaves->id[0];
+    if (freq->leaves->id[n - 1] >= * hi)
+      * hi = freq->leaves->id[n - 1] + 1;
+    return (true);
+  }
+  
+  for (cur = freq->first; cur && cur->id < * freq->idu; cur = cur->next)
+    if (freq_extent (cur, dim - 1, lo + 1, hi + 1))
+    {
+      if (cur->id < * lo)
+        * lo = cur->id;
+      if (cur->id >= * hi)
+        * hi = cur->id + 1;
+      found = true;
+    }
+  
+  return (found);
+}
+
+unsigned long int
+freq_leaves (
+  const freq_t * const freq,
+  const size_t dim
+)
+{
+  size_t i;
+  unsigned long int c = 0;
+  freq_t * cur;
+  
+  if (dim == 1)
+  {
+    for (i = 0; freq->leaves && i < freq->leaves->n && freq->leaves->id[i] < * freq->idu; i++)
+      c++;
+    return (c);
+  }
+  
+  for (cur = freq->first; cur && cur->id < * freq->idu; cur = cur->next)
+    c += freq_leaves (cur, dim - 1);
+  
+  return (c);
+}
+
+static double
+freq_ratio (
+  const freq_t * const freq,
+  const size_t dim
+)
+{
+  size_t i;
+  double er;
+  
+  /* ensemble ratio */
+  er = (double) freq->c;
+  for (i = 0; i < dim; i++)
+    er *= freq->binning[i];
+  
+  return (1. / er);
+}
+
+void
+freq_h5flush (
+  block_t * const block
+)
+{
+  hsize_t start[2] = {block->offset, 0},
+          count[2] = {block->fill, block->width};
+  
+  if (! block->fill)
+    return;
+  
+  writer_slab (block->writer, start, count, block->buf);
+  
+  block->offset += block->fill;
+  block->fill = 0;
+}
+
+static void
+freq_h5row (
+  const double * const buf, const size_t bufl,
+  block_t * const block
+)
+{
+  /* append row to the block, write the block once it is full */
+  memcpy (& block->buf[block->fill * block->width], buf, bufl * sizeof (* buf));
+  if (++block->fill == block->rows)
+    freq_h5flush (block);
+}
+
 static void
 freq_h5write (
   double * const buf, double * const bufcur, const size_t bufl,
-  const hid_t dset,
+  block_t * const block,
   const freq_t * const freq, const double * const binning, const long int * const idl, const long int * const idu,
   const double er
 )
 {
+  size_t i;
   long int id;
   freq_t * cur, * next;
+  const counter_t * leaves;
   
-  if (bufcur != & buf[bufl - 1])
+  if (freq && bufcur + 2 == & buf[bufl])
+  {
+    /* the last axis, merged with its block of counters */
+    leaves = freq->leaves;
+    for (id = * freq->idl, i = 0; id < * freq->idu; id++)
+    {
+      while (leaves && i < leaves->n && leaves->id[i] < id)
+        i++;
+      bufcur[0] = ((double) id + .5) * (* freq->binning);
+      if (leaves && i < leaves->n && leaves->id[i] == id)
+        bufcur[1] = (double) counter_get (leaves, i) * er;
+      else
+        bufcur[1] = 0.;
+      freq_h5row (buf, bufl, block);
+    }
+  }
+  else if (bufcur != & buf[bufl - 1])
   {
     if (freq)
     {
@@ -229,7 +486,7 @@ freq_h5write (
               * bufcur = ((double) cur->id + .5) * (* freq->binning);
               freq_h5write (
                 buf, bufcur + 1, bufl,
-                dset,
+                block,
                 cur, NULL, NULL, NULL,
                 er
               );
@@ -240,7 +497,7 @@ freq_h5write (
               * bufcur = ((double) id + .5) * (* freq->binning);
               freq_h5write (
                 buf, bufcur + 1, bufl,
-                dset,
+                block,
                 NULL, freq->binning + 1, freq->idl + 1, freq->idu + 1,
                 er
               );
@@ -253,7 +510,7 @@ freq_h5write (
           * bufcur = ((double) id + .5) * (* freq->binning);
           freq_h5write (
             buf, bufcur + 1, bufl,
-            dset,
+            block,
             NULL, freq->binning + 1, freq->idl + 1, freq->idu + 1,
             er
           );
@@ -267,7 +524,7 @@ freq_h5write (
         * bufcur = ((double) id + .5) * (* binning);
         freq_h5write (
           buf, bufcur + 1, bufl,
-          dset,
+          block,
           NULL, binning + 1, idl + 1, idu + 1,
           er
         );
@@ -276,74 +533,435 @@ freq_h5write (
   }
   else
   {
-    if (freq)
-      * bufcur = (double) freq->c * er;
-    else
-      * bufcur = 0.;
-    
-    hid_t space, memspace;
-    herr_t status;
-    hsize_t dims[2],
-            extdims[2],
-            memdims[2],
-            memmaxdims[2],
-            start[2],
-            count[2];
-    
-    space = H5Dget_space (dset);
-    H5Sget_simple_extent_dims (space, dims, NULL);
-    status = H5Sclose (space);
-    extdims[0] = dims[0] + 1;
-    extdims[1] = dims[1];
-    status = H5Dset_extent (dset, extdims);
-    
-    space = H5Dget_space (dset);
-    status = H5Sselect_all (space);
-    start[0] = 0;
-    start[1] = 0;
-    count[0] = dims[0];
-    count[1] = dims[1];
-    status = H5Sselect_hyperslab (space, H5S_SELECT_NOTB, start, NULL, count, NULL);
-    memdims[0] = 1;
-    memdims[1] = dims[1];
-    memmaxdims[0] = H5S_UNLIMITED;
-    memmaxdims[1] = dims[1];
-    memspace = H5Screate_simple (2, memdims, memmaxdims);
-    status = H5Dwrite (
-      dset,
-      H5T_NATIVE_DOUBLE,
-      memspace, space, H5P_DEFAULT,
-      buf
-    );
-    status = H5Sclose (memspace);
-    status = H5Sclose (space);
+    * bufcur = 0.;
+    freq_h5row (buf, bufl, block);
   }
 }
 
 void
 freq_save (
-  const hid_t dset,
+  writer_t * const writer,
   const freq_t * const freq,
   const size_t dim
 )
 {
-  size_t i;
-  const size_t bufl = dim + 1;
-  double er, * buf;
+  const size_t bufl = dim + 1, chunk = writer->chunk[0];
+  const double er = freq_ratio (freq, dim);
+  hsize_t rows;
+  double * buf;
+  block_t block;
   
-  /* ensemble ratio */
-  er = (double) freq->c;
-  for (i = 0; i < dim; i++)
-    er *= freq->binning[i];
-  er = 1. / er;
+  /* the block holds a whole number of chunks */
+  rows = freq_rows (freq, dim);
+  block.writer = writer;
+  block.width = bufl;
+  block.rows = FREQ_BLOCK_SIZE / (chunk * bufl * sizeof (* block.buf));
+  block.rows = chunk * (block.rows ? block.rows : 1);
+  if (rows < block.rows)
+    block.rows = rows;
+  block.fill = 0;
+  block.offset = 0;
+  
+  if (! block.rows)
+    return;
   
   /* write to hdf5 dataset */
+  block.buf = malloc (block.rows * block.width * sizeof (* block.buf));
   buf = calloc (bufl, sizeof (* buf));
   freq_h5write (
     buf, buf, bufl,
-    dset,
+    & block,
     freq, NULL, NULL, NULL,
     er
   );
+  freq_h5flush (& block);
+  free (buf);
+  free (block.buf);
+}
+
+void
+freq_cooflush (
+  coo_t * const coo
+)
+{
+  size_t i;
+  hsize_t start[1] = {coo->offset},
+          count[1] = {coo->fill};
+  
+  if (! coo->fill)
+    return;
+  
+  for (i = 0; i < coo->dim; i++)
+    writer_slab (coo->writer_id[i], start, count, & coo->id[i * coo->rows]);
+  writer_slab (coo->writer_c, start, count, coo->c);
+  writer_slab (coo->writer_d, start, count, coo->d);
+  
+  coo->offset += coo->fill;
+  coo->fill = 0;
+}
+
+static void
+freq_coowrite (
+  coo_t * const coo,
+  long int * const id, const size_t depth,
+  const freq_t * const freq,
+  const double er
+)
+{
+  size_t i, j;
+  unsigned long int c;
+  freq_t * cur;
+  
+  if (depth + 1 == coo->dim)
+    for (j = 0; freq->leaves && j < freq->leaves->n && freq->leaves->id[j] < * freq->idu; j++)
+    {
+      id[depth] = freq->leaves->id[j];
+      c = counter_get (freq->leaves, j);
+      for (i = 0; i < coo->dim; i++)
+        coo->id[i * coo->rows + coo->fill] = id[i];
+      coo->c[coo->fill] = c;
+      coo->d[coo->fill] = (double) c * er;
+      if (++coo->fill == coo->rows)
+        freq_cooflush (coo);
+    }
+  else
+    for (cur = freq->first; cur && cur->id < * freq->idu; cur = cur->next)
+    {
+      id[depth] = cur->id;
+      freq_coowrite (coo, id, depth + 1, cur, er);
+    }
+}
+
+void
+freq_save_sparse (
+  writer_t * const * const writer_id, writer_t * const writer_c, writer_t * const writer_d,
+  const freq_t * const freq,
+  const size_t dim
+)
+{
+  const size_t chunk = writer_c->chunk[0];
+  const double er = freq_ratio (freq, dim);
+  const unsigned long int leaves = freq_leaves (freq, dim);
+  long int * id;
+  coo_t coo;
+  
+  /* the block holds a whole number of chunks of every array */
+  coo.writer_id = writer_id;
+  coo.writer_c = writer_c;
+  coo.writer_d = writer_d;
+  coo.dim = dim;
+  coo.rows = FREQ_BLOCK_SIZE / (chunk * (dim + 2) * sizeof (double));
+  coo.rows = chunk * (coo.rows ? coo.rows : 1);
+  if (leaves < coo.rows)
+    coo.rows = leaves;
+  coo.fill = 0;
+  coo.offset = 0;
+  
+  if (! coo.rows)
+    return;
+  
+  coo.id = malloc (coo.rows * dim * sizeof (* coo.id));
+  coo.c = malloc (coo.rows * sizeof (* coo.c));
+  coo.d = malloc (coo.rows * sizeof (* coo.d));
+  id = malloc (dim * sizeof (* id));
+  freq_coowrite (& coo, id, 0, freq, er);
+  freq_cooflush (& coo);
+  free (id);
+  free (coo.id);
+  free (coo.c);
+  free (coo.d);
+}
+
+static void
+freq_gridfill (
+  double * const buf, const hsize_t * const stride, const size_t depth, const size_t dim,
+  const freq_t * const freq,
+  const double er
+)
+{
+  size_t j;
+  freq_t * cur;
+  
+  if (depth + 1 == dim)
+    for (j = 0; freq->leaves && j < freq->leaves->n && freq->leaves->id[j] < * freq->idu; j++)
+      buf[(hsize_t) (freq->leaves->id[j] - * freq->idl) * stride[depth]] = (double) counter_get (freq->leaves, j) * er;
+  else
+    for (cur = freq->first; cur && cur->id < * freq->idu; cur = cur->next)
+      freq_gridfill (& buf[(hsize_t) (cur->id - * freq->idl) * stride[depth]], stride, depth + 1, dim, cur, er);
+}
+
+void
+freq_save_grid (
+  writer_t * const writer,
+  const freq_t * const freq,
+  const size_t dim
+)
+{
+  size_t i;
+  const size_t chunk = writer->chunk[0];
+  const double er = freq_ratio (freq, dim);
+  hsize_t slab, extent[dim], stride[dim], start[dim], count[dim];
+  size_t j = 0;
+  double * buf;
+  freq_t * cur;
+  const counter_t * const leaves = freq->leaves;
+  
+  if (! freq_rows (freq, dim))
+    return;
+  
+  for (i = dim; i-- > 0;)
+  {
+    extent[i] = (hsize_t) (freq->idu[i] - freq->idl[i]);
+    stride[i] = (i + 1 < dim) ? stride[i + 1] * extent[i + 1] : 1;
+    start[i] = 0;
+    count[i] = extent[i];
+  }
+  
+  /* the slab spans whole chunks along the first axis */
+  slab = FREQ_BLOCK_SIZE / (chunk * stride[0] * sizeof (* buf));
+  slab = chunk * (slab ? slab : 1);
+  if (slab > extent[0])
+    slab = extent[0];
+  
+  buf = malloc (slab * stride[0] * sizeof (* buf));
+  cur = freq->first;
+  for (start[0] = 0; start[0] < extent[0]; start[0] += slab)
+  {
+    count[0] = (start[0] + slab < extent[0]) ? slab : extent[0] - start[0];
+    memset (buf, 0, count[0] * stride[0] * sizeof (* buf));
+    
+    for (; cur && (hsize_t) (cur->id - freq->idl[0]) < start[0] + count[0]; cur = cur->next)
+      freq_gridfill (& buf[(cur->id - freq->idl[0] - start[0]) * stride[0]], stride, 1, dim, cur, er);
+    for (; leaves && j < leaves->n && (hsize_t) (leaves->id[j] - freq->idl[0]) < start[0] + count[0]; j++)
+      buf[leaves->id[j] - freq->idl[0] - start[0]] = (double) counter_get (leaves, j) * er;
+    
+    writer_slab (writer, start, count, buf);
+  }
   free (buf);
 }
+
+static size_t
+freq_marghash (
+  const long int * const key, const size_t dim
+)
+{
+  size_t i;
+  unsigned long int h = 14695981039346656037ul;
+  
+  for (i = 0; i < dim; i++)
+  {
+    h ^= (unsigned long int) key[i];
+    h *= 1099511628211ul;
+    h ^= h >> 29;
+  }
+  
+  return ((size_t) h);
+}
+
+static void
+freq_margadd (
+  marg_t * const marg,
+  const long int * const key, const unsigned long int c
+)
+{
+  size_t i, j, size;
+  long int * key_old;
+  unsigned long int * c_old;
+  
+  /* keep the open addressing table at most half full */
+  if (2 * (marg->fill + 1) > marg->size)
+  {
+    size = marg->size;
+    key_old = marg->key;
+    c_old = marg->c;
+    
+    marg->size = size ? 2 * size : FREQ_MARG_SIZE;
+    marg->fill = 0;
+    marg->key = malloc (marg->size * marg->dim * sizeof (* marg->key));
+    marg->c = calloc (marg->size, sizeof (* marg->c));
+    
+    for (j = 0; j < size; j++)
+      if (c_old[j])
+        freq_margadd (marg, & key_old[j * marg->dim], c_old[j]);
+    free (key_old);
+    free (c_old);
+  }
+  
+  for (i = freq_marghash (key, marg->dim) & (marg->size - 1); marg->c[i]; i = (i + 1) & (marg->size - 1))
+    if (! memcmp (& marg->key[i * marg->dim], key, marg->dim * sizeof (* key)))
+    {
+      marg->c[i] += c;
+      return;
+    }
+  
+  memcpy (& marg->key[i * marg->dim], key, marg->dim * sizeof (* key));
+  marg->c[i] = c;
+  marg->fill++;
+}
+
+static void
+freq_margwalk (
+  marg_t * const marg, const size_t nmarg,
+  long int * const id, const size_t depth, const size_t dim,
+  const freq_t * const freq
+)
+{
+  size_t j;
+  freq_t * cur;
+  
+  if (depth + 1 == dim)
+    for (j = 0; freq->leaves && j < freq->leaves->n && freq->leaves->id[j] < * freq->idu; j++)
+    {
+      id[depth] = freq->leaves->id[j];
+      freq_margcell (marg, nmarg, id, counter_get (freq->leaves, j));
+    }
+  else
+    for (cur = freq->first; cur && cur->id < * freq->idu; cur = cur->next)
+    {
+      id[depth] = cur->id;
+      freq_margwalk (marg, nmarg, id, depth + 1, dim, cur);
+    }
+}
+
+void
+freq_margcell (
+  marg_t * const marg, const size_t nmarg,
+  const long int * const id, const unsigned long int c
+)
+{
+  size_t i, j;
+  long int key[H5S_MAX_RANK];
+  
+  if (! c)
+    return;
+  for (i = 0; i < nmarg; i++)
+  {
+    for (j = 0; j < marg[i].dim; j++)
+      key[j] = id[marg[i].axes[j]];
+    freq_margadd (& marg[i], key, c);
+  }
+}
+
+/* qsort has no context argument */
+static size_t freq_margcmp_dim;
+
+static int
+freq_margcmp (
+  const void * a, const void * b
+)
+{
+  size_t i;
+  const long int * const ka = a, * const kb = b;
+  
+  for (i = 0; i < freq_margcmp_dim; i++)
+    if (ka[i] != kb[i])
+      return ((ka[i] < kb[i]) ? -1 : 1);
+  
+  return (0);
+}
+
+static void
+freq_margtree (
+  marg_t * const marg
+)
+{
+  const size_t dim = marg->dim,
+               width = dim + 1;
+  size_t i, j, k;
+  long int * rec;
+  freq_t * path[dim + 1];
+  
+  /* gather (key, count) records and sort them in tree order */
+  rec = malloc ((marg->fill ? marg->fill : 1) * width * sizeof (* rec));
+  for (i = 0, j = 0; i < marg->size; i++)
+    if (marg->c[i])
+    {
+      memcpy (& rec[j * width], & marg->key[i * dim], dim * sizeof (* rec));
+      memcpy (& rec[j * width + dim], & marg->c[i], sizeof (* rec));
+      j++;
+    }
+  freq_margcmp_dim = dim;
+  qsort (rec, marg->fill, width * sizeof (* rec), freq_margcmp);
+  
+  /* append paths below the first level where a record leaves its predecessor */
+  path[0] = marg->freq;
+  for (i = 0; i < marg->fill; i++)
+  {
+    const long int * const key = & rec[i * width];
+    unsigned long int c;
+    
+    memcpy (& c, & rec[i * width + dim], sizeof (c));
+    for (k = 0; i && k + 1 < dim && key[k] == rec[(i - 1) * width + k]; k++)
+      path[k + 1]->c += c;
+    for (; k + 1 < dim; k++)
+    {
+      if (! path[k]->first)
+        path[k + 1] = path[k]->first = freq_alloc (key[k], path[k]->idl + 1, path[k]->idu + 1, path[k]->binning + 1, NULL);
+      else
+        path[k + 1] = path[k + 1]->next = freq_alloc (key[k], path[k]->idl + 1, path[k]->idu + 1, path[k]->binning + 1, NULL);
+      path[k + 1]->c = c;
+    }
+    
+    /* the keys are unique, so the last index is new to its block */
+    j = path[k]->leaves ? path[k]->leaves->n : 0;
+    path[k]->leaves = counter_insert (path[k]->leaves, j, key[k]);
+    path[k]->leaves = counter_add (path[k]->leaves, j, c);
+  }
+  
+  free (rec);
+}
+
+void
+freq_margopen (
+  marg_t * const marg,
+  freq_t * const * const marginal, const size_t * const * const axes, const size_t * const dim_marginal,
+  const size_t nmarginal
+)
+{
+  size_t i;
+  
+  for (i = 0; i < nmarginal; i++)
+  {
+    marg[i].freq = marginal[i];
+    marg[i].axes = axes[i];
+    marg[i].dim = dim_marginal[i];
+    marg[i].size = marg[i].fill = 0;
+    marg[i].key = NULL;
+    marg[i].c = NULL;
+  }
+}
+
+void
+freq_margclose (
+  marg_t * const marg, const size_t nmarginal,
+  const unsigned long int charge
+)
+{
+  size_t i;
+  
+  for (i = 0; i < nmarginal; i++)
+  {
+    /* normalize to all samples of the joint histogram */
+    marg[i].freq->c = charge;
+    freq_margtree (& marg[i]);
+    free (marg[i].key);
+    free (marg[i].c);
+  }
+}
+
+void
+freq_marginals (
+  freq_t * const * const marginal, const size_t * const * const axes, const size_t * const dim_marginal,
+  const size_t nmarginal,
+  const freq_t * const freq,
+  const size_t dim
+)
+{
+  long int id[dim];
+  marg_t marg[nmarginal];
+  
+  /* a single pass over the joint histogram feeds all marginals */
+  freq_margopen (marg, marginal, axes, dim_marginal, nmarginal);
+  freq_margwalk (marg, nmarginal, id, 0, dim, freq);
+  freq_margclose (marg, nmarginal, freq->c);
+}
@@ -29,6 +29,13 @@
 #include <float.h>
 
 #include "structs.h"
+#include "writer.h"
+#include "counter.h"
+
+#define FREQ_BLOCK_SIZE 16777216
+#define FREQ_MARG_SIZE 1024
+/* a node and its allocator overhead */
+#define FREQ_NODE_SIZE (sizeof (freq_t) + 2 * sizeof (size_t))
 
 freq_t *
 freq_alloc (
@@ -43,6 +50,21 @@ freq_free (
   freq_t * freq
 );
 
+void
+freq_prune (
+  freq_t * const freq
+);
+
+unsigned long int
+freq_allocated (
+  void
+);
+
+unsigned long int
+freq_population (
+  void
+);
+
 static unsigned long int
 freq_charge (
   const data_t * const data
@@ -54,6 +76,12 @@ freq_accumulate (
   const data_t * const data
 );
 
+void
+freq_merge (
+  freq_t * const freq,
+  const freq_t * const other
+);
+
 void
 freq_dump (
   const freq_t * const freq
@@ -64,17 +92,142 @@ freq_counter (
   const freq_t * const freq
 );
 
+hsize_t
+freq_rows (
+  const freq_t * const freq,
+  const size_t dim
+);
+
+bool
+freq_extent (
+  const freq_t * const freq,
+  const size_t dim,
+  long int * const lo, long int * const hi
+);
+
+unsigned long int
+freq_leaves (
+  const freq_t * const freq,
+  const size_t dim
+);
+
+static double
+freq_ratio (
+  const freq_t * const freq,
+  const size_t dim
+);
+
+void
+freq_h5flush (
+  block_t * const block
+);
+
+static void
+freq_h5row (
+  const double * const buf, const size_t bufl,
+  block_t * const block
+);
+
 static void
 freq_h5write (
   double * const buf, double * const bufcur, const size_t bufl,
-  const hid_t dset,
+  block_t * const block,
   const freq_t * const freq, const double * const binning, const long int * const idl, const long int * const idu,
   const double er
 );
 
 void
 freq_save (
-  const hid_t dset,
+  writer_t * const writer,
+  const freq_t * const freq,
+  const size_t dim
+);
+
+void
+freq_cooflush (
+  coo_t * const coo
+);
+
+static void
+freq_coowrite (
+  coo_t * const coo,
+  long int * const id, const size_t depth,
+  const freq_t * const freq,
+  const double er
+);
+
+void
+freq_save_sparse (
+  writer_t * const * const writer_id, writer_t * const writer_c, writer_t * const writer_d,
+  const freq_t * const freq,
+  const size_t dim
+);
+
+static void
+freq_gridfill (
+  double * const buf, const hsize_t * const stride, const size_t depth, const size_t dim,
+  const freq_t * const freq,
+  const double er
+);
+
+void
+freq_save_grid (
+  writer_t * const writer,
+  const freq_t * const freq,
+  const size_t dim
+);
+
+static size_t
+freq_marghash (
+  const long int * const key, const size_t dim
+);
+
+static void
+freq_margadd (
+  marg_t * const marg,
+  const long int * const key, const unsigned long int c
+);
+
+static void
+freq_margwalk (
+  marg_t * const marg, const size_t nmarg,
+  long int * const id, const size_t depth, const size_t dim,
+  const freq_t * const freq
+);
+
+void
+freq_margcell (
+  marg_t * const marg, const size_t nmarg,
+  const long int * const id, const unsigned long int c
+);
+
+static int
+freq_margcmp (
+  const void * a, const void * b
+);
+
+static void
+freq_margtree (
+  marg_t * const marg
+);
+
+void
+freq_margopen (
+  marg_t * const marg,
+  freq_t * const * const marginal, const size_t * const * const axes, const size_t * const dim_marginal,
+  const size_t nmarginal
+);
+
+void
+freq_margclose (
+  marg_t * const marg, const size_t nmarginal,
+  const unsigned long int charge
+);
+
+void
+freq_marginals (
+  freq_t * const * const marginal, const size_t * const * const axes, const size_t * const dim_marginal,
+  const size_t nmarginal,
   const freq_t * const freq,
   const size_t dim
 );
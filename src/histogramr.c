@@ -21,12 +21,15 @@
 #include "hdf5.h"
 
 #include <stdio.h>
-
-#ifdef TIMING
-#include <sys/time.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
 #include <time.h>
-#define EMA_SMOOTHING .1
-#endif
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include <math.h>
 
@@ -36,27 +39,51 @@ typedef enum {FALSE = 0, TRUE} boolean;
 #include "options.h"
 #include "data.h"
 #include "freq.h"
+#include "writer.h"
+#include "plan.h"
+#include "spill.h"
+#include "metrics.h"
+#include "trace.h"
+#include "save.h"
+#include "stream.h"
+#include "sketch.h"
+#include "range.h"
+#include "batch.h"
+#include "sample.h"
 
 char
 load (
-  size_t * const, size_t * const, double **** const, const hid_t, const options_t * const
+  size_t * const, size_t * const, double **** const, const hid_t, const options_t * const, typecache_t * const,
+  const sample_t * const
+);
+
+void
+accumulate (
+  plan_t * const, const options_t * const, const size_t, const size_t, double *** const * const, metrics_t * const
+);
+
+void
+flush (
+  plan_t * const, const options_t * const, batch_t * const, metrics_t * const
 );
 
 void
-commit (
-  freq_t * const, const size_t, const size_t, const double * const * const * const * const, const options_t * const
+prefetch (
+  const char * const, const unsigned long int
 );
 
 void
-save (
-  const hid_t, const hid_t, const freq_t * const, const options_t * const
+autorange (
+  options_t * const
 );
 
 void
-copy_attr (
-  const hid_t, const hid_t, const char * const
+request_snapshot (
+  int
 );
 
+static volatile sig_atomic_t snapshot_requested = 0;
+
 
 int
 main (
@@ -66,145 +93,254 @@ main (
   options_t * const options = malloc (sizeof (* options));
   options_defaults (options);
   options_prep (options, argc, argv);
+  if (options->autorange && range_wanted (options))
+    autorange (options);
   
-  size_t i, j;
+  size_t i, j, n, pass;
   
-  freq_t * freq;
-  freq = freq_alloc (
-           0,
-           options->limit_idl_merged, options->limit_idu_merged,
-           options->binning_merged,
-           NULL
-         );
-
-#ifdef TIMING
-  struct timeval * const tv = malloc (sizeof (* tv));
-  double begin, now, speed_ema, speed_cur;
-  gettimeofday (tv, NULL);
-  begin = speed_cur = (double) tv->tv_sec + (double) tv->tv_usec / 1e6;
-#endif
+  plan_t * const plan = plan_alloc (options);
+  unsigned long int counter;
+  
+  hid_t file_last = -1;
+  size_t processed = 0;
+  pid_t snapshot = 0;
+  bool pending = false;
+  time_t last_save = time (NULL);
+  struct sigaction action;
+  metrics_t * metrics = NULL;
+  typecache_t cache[NDATASET_MAX];
+  batch_t * batch = NULL;
+  hid_t fapl_small = -1;
+  const size_t npass = sample_passes (options);
+  sample_t sample;
+  
+  /* the phases of the metrics are the spans of the trace */
+  if (options->trace)
+    trace_open (options->trace);
+  if (options->metrics || options->status || options->trace)
+    metrics = metrics_open (options->metrics, options->status);
+  
+  /* SIGUSR1 requests a snapshot after the current file */
+  memset (& action, 0, sizeof (action));
+  action.sa_handler = request_snapshot;
+  action.sa_flags = SA_RESTART;
+  sigemptyset (& action.sa_mask);
+  sigaction (SIGUSR1, & action, NULL);
+  
+  for (j = 0; j < NDATASET_MAX; j++)
+    cache[j].dtype = -1;
   
-  for (i = 0; i < options->ninput; i++)
+  /* small files are read whole into memory and binned in batches, the kernel reads the next ones meanwhile */
+  if (options->small && ! options->layout)
+  {
+    fapl_small = H5Pcreate (H5P_FILE_ACCESS);
+    H5Pset_fapl_core (fapl_small, BATCH_INCREMENT, 0);
+    batch = batch_alloc (plan->source);
+    for (j = 0; j < BATCH_AHEAD && j < options->ninput; j++)
+      prefetch (options->input[j], options->small);
+  }
+  
+  /* a preview bins disjoint samples of growing size, pass by pass, until all rows are binned */
+  for (n = 0; n < npass * options->ninput; n++)
   {
     size_t dataset_length = 0,
            compound_member_length = 0;
-#ifdef TIMING
-    double t;
-#endif
+    unsigned long int bytes = 0, rows = 0;
     double *** raw[NDATASET_MAX];
-    hid_t file_in, file_out;
+    hid_t file_in = -1;
+    struct stat st;
     herr_t status;
     herr_t h5_error = -1;
     
-    /* open file */
-    if ((file_in = H5Fopen (options->input[i], H5F_ACC_RDONLY, H5P_DEFAULT)) == h5_error)
-    {
-      fprintf (stderr, "warning: file `%s' could not be opened, skipping.\n", options->input[i]);
-      continue;
-    }
-   
-    /* read from file */
-#ifdef TIMING
-    gettimeofday (tv, NULL);
-    t = (double) tv->tv_sec + (double) tv->tv_usec / 1e6;
-#endif
-    if (! load (& dataset_length, & compound_member_length, raw, file_in, options))
+    i = n % options->ninput;
+    if (! i && options->sample > 0.)
     {
-      status = H5Fclose (file_in);
-      continue;
+      pass = n / options->ninput;
+      sample.lo = pass ? sample_bound (options, pass - 1) : 0.;
+      sample.hi = sample_bound (options, pass);
+      sample.seed = options->seed;
+      for (j = 0; j < plan->nspec; j++)
+      {
+        plan->spec[j].options->sampled = sample.hi;
+        plan->spec[j].options->seed = options->seed;
+      }
+      printf ("sample: %g of the rows, pass %lu of %lu\n\n", sample.hi, pass + 1, npass);
     }
-#ifdef TIMING
-    gettimeofday (tv, NULL);
-    printf ("loaded: %s, time: %g s\n", options->input[i], (double) tv->tv_sec + (double) tv->tv_usec / 1e6 - t);
-#else
-    printf ("loaded: %s\n", options->input[i]);
-#endif
-
-    /* accumulate statistics */
-#ifdef TIMING
-    gettimeofday (tv, NULL);
-    t = (double) tv->tv_sec + (double) tv->tv_usec / 1e6;
-#endif
-    if (dataset_length && compound_member_length)
+    sample.name = options->input[i];
+    
+    metrics_input (metrics, options->input[i], options->ninput);
+    
+    /* binary records are binned batch by batch as they arrive */
+    if (options->layout)
     {
-      commit (freq, dataset_length, compound_member_length, raw, options);
-#ifdef TIMING
-      gettimeofday (tv, NULL);
-      printf ("committed: %s, time: %g s\n", options->input[i], (double) tv->tv_sec + (double) tv->tv_usec / 1e6 - t);
-#else
-      printf ("committed: %s\n", options->input[i]);
-#endif
-      /* free buffers */
-      for (j = 0; j < NDATASET_MAX;j++)
+      stream_t * stream;
+      
+      metrics_start (metrics, PHASE_OPEN);
+      if (! (stream = stream_open (options->input[i], options->layout, plan->source)))
       {
-        if (options->dim[j])
+        metrics_stop (metrics, PHASE_OPEN);
+        continue;
+      }
+      metrics_stop (metrics, PHASE_OPEN);
+      
+      for (;;)
+      {
+        metrics_start (metrics, PHASE_LOAD);
+        dataset_length = stream_read (stream);
+        metrics_stop (metrics, PHASE_LOAD);
+        if (! dataset_length)
+          break;
+        bytes += dataset_length * stream->size;
+        rows += dataset_length;
+        accumulate (plan, options, dataset_length, 1, stream->raw, metrics);
+        
+        /* a stream is saved on the interval and on request, as a series of files is */
+        snapshot = save_reap (snapshot, false);
+        if (! snapshot
+            && ((options->interval > 0. && difftime (time (NULL), last_save) >= options->interval)
+                || snapshot_requested))
         {
-          free (raw[j][0][0]);
-          free (raw[j][0]);
-          free (raw[j]);
+          if (options->background)
+            snapshot = save_background (file_in, plan, metrics);
+          else
+            save_atomic (file_in, plan, metrics);
+          snapshot_requested = 0;
+          last_save = time (NULL);
         }
       }
+      stream_close (stream);
+      printf ("committed: %s\n", options->input[i]);
     }
-
-    /* save statistics and attributes to hdf5 file */
-    if ((i > 0 && i % options->savevery == 0) || i + 1 == options->ninput)
+    else
     {
-#ifdef TIMING
-      double t;
-#endif
+      if (batch && n + BATCH_AHEAD < npass * options->ninput)
+        prefetch (options->input[(n + BATCH_AHEAD) % options->ninput], options->small);
+      
+      /* open file */
+      metrics_start (metrics, PHASE_OPEN);
+      if ((file_in = H5Fopen (
+                       options->input[i], H5F_ACC_RDONLY,
+                       (batch && ! stat (options->input[i], & st) && (unsigned long int) st.st_size <= options->small)
+                       ? fapl_small : H5P_DEFAULT
+                     )) == h5_error)
+      {
+        metrics_stop (metrics, PHASE_OPEN);
+        fprintf (stderr, "warning: file `%s' could not be opened, skipping.\n", options->input[i]);
+        continue;
+      }
+      metrics_stop (metrics, PHASE_OPEN);
+     
+      /* read from file */
+      metrics_start (metrics, PHASE_LOAD);
+      if (! load (& dataset_length, & compound_member_length, raw, file_in, plan->source, cache, (options->sample > 0.) ? & sample : NULL))
+      {
+        metrics_stop (metrics, PHASE_LOAD);
+        status = H5Fclose (file_in);
+        continue;
+      }
+      metrics_stop (metrics, PHASE_LOAD);
+      for (j = 0; j < NDATASET_MAX; j++)
+        bytes += plan->source->dim[j] * dataset_length * compound_member_length * sizeof (double);
+      printf ("loaded: %s\n", options->input[i]);
 
-#ifdef TIMING
-      gettimeofday (tv, NULL);
-      t = (double) tv->tv_sec + (double) tv->tv_usec / 1e6;
-#endif
-      file_out = H5Fcreate (options->output, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-      save (file_out, file_in, freq, options);
-      status = H5Fclose (file_out);
-#ifdef TIMING
-      gettimeofday (tv, NULL);
-      printf ("saved: %s, time: %g s\n", options->output, (double) tv->tv_sec + (double) tv->tv_usec / 1e6 - t);
-#else
-      printf ("saved: %s\n", options->output);
-#endif
+      /* accumulate statistics */
+      if (dataset_length && compound_member_length)
+      {
+        if (batch)
+        {
+          if (batch->n && batch->length != compound_member_length)
+            flush (plan, options, batch, metrics);
+          batch_add (batch, raw, dataset_length, compound_member_length);
+          if (batch->n >= BATCH_SIZE)
+            flush (plan, options, batch, metrics);
+          printf ("batched: %s\n", options->input[i]);
+        }
+        else
+        {
+          accumulate (plan, options, dataset_length, compound_member_length, raw, metrics);
+          printf ("committed: %s\n", options->input[i]);
+        }
+        /* free buffers */
+        for (j = 0; j < NDATASET_MAX;j++)
+        {
+          if (plan->source->dim[j])
+          {
+            free (raw[j][0][0]);
+            free (raw[j][0]);
+            free (raw[j]);
+          }
+        }
+      }
+      rows = dataset_length * compound_member_length;
     }
+    processed++;
     
-    status = H5Fclose (file_in);
+    metrics_file (metrics, options->input[i], bytes, rows, plan->spec[0].freq->c);
     
-    /* print feedback */
-#ifdef TIMING
-    gettimeofday (tv, NULL);
-    now = (double) tv->tv_sec + (double) tv->tv_usec / 1e6;
-    speed_cur = now - speed_cur;
-    if (! i)
-      speed_ema = speed_cur;
-    else
-      speed_ema = (speed_ema * (1. - EMA_SMOOTHING)) + (speed_cur * EMA_SMOOTHING);
-    printf (
-      "done: %s, freq charge: %lu, freq structure count: %lu, time elapsed: %g s, currently: %g s per file, to go: %lu files, eta: %g s\n\n",
-      options->input[i],
-      freq->c,
-      freq_counter (freq),
-      now - begin,
-      speed_cur,
-      options->ninput - i - 1,
-      speed_ema * (double) (options->ninput - i - 1)
-    );
-    speed_cur = now;
-#else
+    /* the attributes of the output are taken from the latest file */
+    if (file_last >= 0)
+      status = H5Fclose (file_last);
+    file_last = file_in;
+    
+    /* save statistics and attributes to hdf5 file after every pass, the last save follows the loop */
+    snapshot = save_reap (snapshot, false);
+    if ((options->savevery && i > 0 && i % options->savevery == 0)
+        || (options->interval > 0. && difftime (time (NULL), last_save) >= options->interval)
+        || snapshot_requested
+        || i + 1 == options->ninput)
+      pending = true;
+    if (pending && ! snapshot && n + 1 < npass * options->ninput)
+    {
+      flush (plan, options, batch, metrics);
+      if (options->background)
+        snapshot = save_background (file_in, plan, metrics);
+      else
+        save_atomic (file_in, plan, metrics);
+      pending = false;
+      snapshot_requested = 0;
+      last_save = time (NULL);
+    }
+    
+    /* print feedback, the nodes are counted as they are allocated */
+    counter = freq_population () - plan->nspec;
     printf (
       "done: %s, freq charge: %lu, freq structure count: %lu, to go: %lu files\n\n",
       options->input[i],
-      freq->c,
-      freq_counter (freq),
-      options->ninput - i - 1
+      plan->spec[0].freq->c,
+      counter,
+      npass * options->ninput - n - 1
     );
-#endif
   }
   
-  freq_free (freq);
-#ifdef TIMING
-  free (tv);
-#endif
+  /* wait for a running snapshot, then save the final state */
+  snapshot = save_reap (snapshot, true);
+  flush (plan, options, batch, metrics);
+  if (options->sample > 0. && processed && ! plan->spec[0].freq->c)
+    fprintf (stderr, "warning: the sample holds no rows, blocks are whole chunks, try a larger fraction.\n");
+  if (processed)
+  {
+    save_atomic (file_last, plan, metrics);
+    if (file_last >= 0)
+      H5Fclose (file_last);
+  }
+  else
+    fprintf (stderr, "warning: no input could be processed, nothing saved.\n");
+  
+  for (j = 0; j < NDATASET_MAX; j++)
+    if (cache[j].dtype >= 0)
+    {
+      H5Tclose (cache[j].dtype);
+      H5Tclose (cache[j].memtype);
+    }
+  if (batch)
+  {
+    batch_free (batch);
+    H5Pclose (fapl_small);
+  }
+  
+  metrics_close (metrics);
+  trace_close ();
+  plan_free (plan);
   options_free (options);
   
   return (EXIT_SUCCESS);
@@ -216,22 +352,26 @@ load (
   size_t * const compound_member_length_p,
   double **** const raw,
   const hid_t file,
-  const options_t * const options
+  const options_t * const options,
+  typecache_t * const cache,
+  const sample_t * const sample
 )
 {
-  size_t i, k, l;
+  size_t i, k, l, m;
   H5T_class_t compound_member_class = 0;
   hid_t compound_member_type = 0;
+  hsize_t nrow = 0, block = 0;
   
   for (i = 0; i < NDATASET_MAX; i++)
     if (options->dim[i])
     {
       size_t rank;
       
-      hid_t dset, dtype, native_type, space, memtype;
-      hsize_t dims[1];
+      hid_t dset, dtype, native_type = -1, space, memspace = H5S_ALL, memtype = -1;
+      hsize_t dims[1], dims_sample[1];
       H5T_class_t class;
       herr_t status;
+      bool cached;
       
       if(! H5Lexists (file, options->dataset[i], H5P_DEFAULT))
       {
@@ -241,15 +381,15 @@ load (
 
       dset = H5Dopen (file, options->dataset[i], H5P_DEFAULT);
       
+      /* files of a campaign share their types, which are validated once */
       dtype = H5Dget_type (dset);
-      native_type = H5Tget_native_type (dtype, H5T_DIR_DEFAULT);
+      cached = cache[i].dtype >= 0 && H5Tequal (dtype, cache[i].dtype) > 0;
       
-      if ((class = H5Tget_class (dtype)) != H5T_COMPOUND)
+      if (! cached && (class = H5Tget_class (dtype)) != H5T_COMPOUND)
       {
         fprintf (stderr, "warning: dataset type is not compound, skipping file.\n");
         status = H5Dclose (dset);
         status = H5Tclose (dtype);
-        status = H5Tclose (native_type);
         return FALSE;
       }
       
@@ -260,26 +400,53 @@ load (
         fprintf (stderr, "warning: dataspace rank has to be 1, skipping file.\n");
         status = H5Dclose (dset);
         status = H5Tclose (dtype);
-        status = H5Tclose (native_type);
         status = H5Sclose (space);
         return FALSE;
       }
       
       H5Sget_simple_extent_dims (space, dims, NULL);
-      if (! (* dataset_length_p))
-        * dataset_length_p = dims[0];
-      else if ((* dataset_length_p) != dims[0])
+      if (! nrow)
+        nrow = dims[0];
+      else if (nrow != dims[0])
       {
         fprintf (stderr, "warning: content of dataspaces must have the same length, skipping file.\n");
         status = H5Dclose (dset);
         status = H5Tclose (dtype);
-        status = H5Tclose (native_type);
         status = H5Sclose (space);
         return FALSE;
       }
 
-      if (dims[0])
+      /* a sample reads the same blocks of rows of every dataset */
+      if (dims[0] && sample)
       {
+        if (! block)
+          block = sample_block (dset);
+        dims_sample[0] = * dataset_length_p = sample_select (space, dims[0], block, sample);
+        memspace = H5Screate_simple (1, dims_sample, NULL);
+      }
+      else
+        * dataset_length_p = dims[0];
+      
+      if (dims[0] && cached)
+      {
+        if ((* compound_member_length_p) && (* compound_member_length_p) != cache[i].length)
+        {
+          fprintf (stderr, "fatal: content of compound members must have the same length.\n");
+          exit (EXIT_FAILURE);
+        }
+        if (compound_member_class && compound_member_class != cache[i].class)
+        {
+          fprintf (stderr, "fatal: compound members must belong to the same class.\n");
+          exit (EXIT_FAILURE);
+        }
+        * compound_member_length_p = cache[i].length;
+        compound_member_class = cache[i].class;
+        memtype = cache[i].memtype;
+      }
+      else if (dims[0])
+      {
+        native_type = H5Tget_native_type (dtype, H5T_DIR_DEFAULT);
+        
         for (l = 0; l < options->dim[i]; l++)
         {
           int field_id;
@@ -289,6 +456,19 @@ load (
         
           field_id = H5Tget_member_index (native_type, options->member[i][l]);
           member_type = H5Tget_member_type (dtype, field_id);
+          
+          /* the group-by key is one integer or float per row, read as double */
+          if (options->group && ! strcmp (options->member[i][l], options->group))
+          {
+            member_class = H5Tget_class (member_type);
+            status = H5Tclose (member_type);
+            if (member_class != H5T_INTEGER && member_class != H5T_FLOAT)
+            {
+              fprintf (stderr, "fatal: group-by member must be of integer or float type.\n");
+              exit (EXIT_FAILURE);
+            }
+            continue;
+          }
 
           member_length = H5Tget_size (member_type) / sizeof (double);
           if (! (* compound_member_length_p))
@@ -303,22 +483,8 @@ load (
           if (! compound_member_class)
           {
             compound_member_class = member_class;
-
-            if (compound_member_class == H5T_FLOAT)
-            {
-              memtype = H5Tcreate (H5T_COMPOUND, options->dim[i] * sizeof (double));
-
-              compound_member_type = H5T_NATIVE_DOUBLE;
-            }
-            else if (compound_member_class == H5T_ARRAY)
-            {
-              hsize_t adim[1] = {(* compound_member_length_p)};
-
-              memtype = H5Tcreate (H5T_COMPOUND, options->dim[i] * (* compound_member_length_p) * sizeof (double));
-
-              compound_member_type = H5Tarray_create (H5T_NATIVE_DOUBLE, 1, adim);
-            }
-            else
+            
+            if (compound_member_class != H5T_FLOAT && compound_member_class != H5T_ARRAY)
             {
               fprintf (stderr, "fatal: compound member class must be either of float or array type.\n");
               exit (EXIT_FAILURE);
@@ -329,12 +495,51 @@ load (
             fprintf (stderr, "fatal: compound members must belong to the same class.\n");
             exit (EXIT_FAILURE);
           }
-
-          status = H5Tinsert (memtype, options->member[i][l], l * (* compound_member_length_p) * sizeof (double), compound_member_type);
-        
+          
+          /* the element type is shared by the datasets of a file */
+          if (! compound_member_type)
+          {
+            if (compound_member_class == H5T_FLOAT)
+              compound_member_type = H5T_NATIVE_DOUBLE;
+            else
+            {
+              hsize_t adim[1] = {(* compound_member_length_p)};
+              
+              compound_member_type = H5Tarray_create (H5T_NATIVE_DOUBLE, 1, adim);
+            }
+          }
           status = H5Tclose (member_type);
         }
-
+        
+        /* a key of its own, as when grouping one float member by another */
+        if (! (* compound_member_length_p))
+        {
+          * compound_member_length_p = 1;
+          compound_member_class = H5T_FLOAT;
+          compound_member_type = H5T_NATIVE_DOUBLE;
+        }
+        
+        memtype = H5Tcreate (H5T_COMPOUND, options->dim[i] * (* compound_member_length_p) * sizeof (double));
+        for (l = 0; l < options->dim[i]; l++)
+          status = H5Tinsert (
+                     memtype, options->member[i][l], l * (* compound_member_length_p) * sizeof (double),
+                     (options->group && ! strcmp (options->member[i][l], options->group)) ? H5T_NATIVE_DOUBLE : compound_member_type
+                   );
+        
+        /* the memory type is kept for the following files */
+        if (cache[i].dtype >= 0)
+        {
+          status = H5Tclose (cache[i].dtype);
+          status = H5Tclose (cache[i].memtype);
+        }
+        cache[i].dtype = H5Tcopy (dtype);
+        cache[i].memtype = memtype;
+        cache[i].length = * compound_member_length_p;
+        cache[i].class = compound_member_class;
+      }
+      
+      if (dims[0] && (* dataset_length_p))
+      {
         for (k = 0; k < (* dataset_length_p); k++)
         {
           for (l = 0; l < options->dim[i]; l++)
@@ -357,14 +562,23 @@ load (
           }
         }
 
-        status = H5Dread (dset, memtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, raw[i][0][0]);
-    
-        status = H5Tclose (memtype);
+        status = H5Dread (dset, memtype, memspace, (memspace == H5S_ALL) ? H5S_ALL : space, H5P_DEFAULT, raw[i][0][0]);
+        
+        /* the key of a row holds for every element of its array members */
+        if (options->group && (* compound_member_length_p) > 1)
+          for (l = 0; l < options->dim[i]; l++)
+            if (! strcmp (options->member[i][l], options->group))
+              for (k = 0; k < (* dataset_length_p); k++)
+                for (m = 1; m < (* compound_member_length_p); m++)
+                  raw[i][k][l][m] = raw[i][k][l][0];
       }
   
+      if (memspace != H5S_ALL)
+        status = H5Sclose (memspace);
       status = H5Dclose (dset);
       status = H5Tclose (dtype);
-      status = H5Tclose (native_type);
+      if (native_type >= 0)
+        status = H5Tclose (native_type);
       status = H5Sclose (space);
 
       if (! dims[0])
@@ -374,211 +588,176 @@ load (
       }
     }
 
-  if (compound_member_class == H5T_ARRAY)
+  if (compound_member_class == H5T_ARRAY && compound_member_type)
     H5Tclose (compound_member_type);
 
   return TRUE;
 }
 
 void
-commit (
-  freq_t * const freq,
-  const size_t dataset_length,
-  const size_t compound_member_length,
-  const double * const * const * const * const raw,
-  const options_t * const options
+accumulate (
+  plan_t * const plan,
+  const options_t * const options,
+  const size_t dataset_length, const size_t compound_member_length,
+  double *** const * const raw,
+  metrics_t * const metrics
 )
 {
-  size_t i, j, k, l, m;
-  double r;
+  size_t j;
+  long int * id[plan->ncolumn];
+  double * value[plan->ncolumn];
+  bool moments = false;
   
-  const size_t bc = options->dim_merged;
-  size_t bv[bc], dv[bc];
-  bv[0] = dataset_length * compound_member_length;
-  for (i = 1; i < bc; i++)
+  /* transform the union of all columns once, then feed every histogram */
+  metrics_start (metrics, PHASE_BIN);
+  for (j = 0; j < plan->nspec; j++)
+    moments = moments || plan->spec[j].moments;
+  for (j = 0; j < plan->ncolumn; j++)
   {
-    bv[i] = 1;
-    dv[i] = 0;
+    id[j] = malloc (dataset_length * compound_member_length * sizeof (* id[j]));
+    value[j] = moments ? malloc (dataset_length * compound_member_length * sizeof (* value[j])) : NULL;
   }
+  plan_transform (id, moments ? value : NULL, plan, dataset_length, compound_member_length, (const double * const * const * const *) raw);
   
-  data_t * data, * descendant;
-  data = data_alloc (bc, bv);
-  
-  for (i = 0, j = 0; i < NDATASET_MAX; i++)
+  /* the moments are taken of the transformed values, before binning */
+  for (j = 0; j < plan->nspec; j++)
+    if (plan->spec[j].moments)
+    {
+      const double * value_spec[plan->spec[j].options->dim_merged];
+      size_t k;
+      
+      for (k = 0; k < plan->spec[j].options->dim_merged; k++)
+        value_spec[k] = value[plan->spec[j].column[k]];
+      moments_add (plan->spec[j].moments, dataset_length * compound_member_length, value_spec);
+    }
+  metrics_stop (metrics, PHASE_BIN);
+  for (j = 0; j < plan->nspec; j++)
   {
-    if (options->dim[i])
+    const spec_t * const spec = & plan->spec[j];
+    const size_t nsample = dataset_length * compound_member_length,
+                 batch = options->max_memory ? SPILL_BATCH : nsample;
+    const long int * id_spec[spec->options->dim_merged];
+    size_t k, n;
+    
+    /* under a memory budget, samples are committed in batches and spilled when it is exceeded */
+    for (n = 0; n < nsample; n += batch)
     {
-      for (k = 0; k < dataset_length; k++)
+      for (k = 0; k < spec->options->dim_merged; k++)
+        id_spec[k] = id[spec->column[k]] + n;
+      plan_commit (spec->freq, (nsample - n < batch) ? nsample - n : batch, id_spec, spec->options, metrics);
+      if (options->max_memory && freq_allocated () > options->max_memory)
       {
-        for (l = 0; l < options->dim[i]; l++)
-        {
-          for (m = 0; m < compound_member_length; m++)
-          {
-            dv[0] = k * compound_member_length + m;
-            descendant = descend (data, j + l + 1, dv);
-            r = raw[i][k][l][m];
-            if (options->l10[i])
-            {
-              if (options->l10[i][l] == 1)
-              {
-                if (options->limit_l[i][l] > 0 && options->limit_u[i][l] > 0)
-                  r = log10 (r);
-                else if (options->limit_l[i][l] < 0 && options->limit_u[i][l] < 0)
-                  r = log10 (- r);
-                else
-                  // can't happen: if this were the case program would have quitted earlier
-                  exit (EXIT_FAILURE);
-              }
-            }
-            descendant->id = (long int) floor (r / options->binning[i][l]);
-          }
-        }
+        metrics_start (metrics, PHASE_SPILL);
+        plan_spill (plan);
+        metrics_stop (metrics, PHASE_SPILL);
       }
     }
-    j += options->dim[i];
   }
-  
-  data_sort (data);
-  
-  freq_accumulate (freq, data);
-  
-  data_free (data);
+  for (j = 0; j < plan->ncolumn; j++)
+  {
+    free (id[j]);
+    free (value[j]);
+  }
 }
 
 void
-save (
-  const hid_t file_out, const hid_t file_in,
-  const freq_t * const freq,
-  const options_t * const options
+flush (
+  plan_t * const plan,
+  const options_t * const options,
+  batch_t * const batch,
+  metrics_t * const metrics
 )
 {
-  size_t i;
-  hid_t grp_in, grp_out, dcpl, dset_out, space_out, space_charge, attr_charge;
-  hsize_t dims_out[2] = {0, options->dim_merged + 1},
-          maxdims_out[2] = {H5S_UNLIMITED, options->dim_merged + 1},
-          chunk[2] = {options->chunk, options->dim_merged + 1},
-          dims_charge[1] = {1};
-  herr_t status;
-  
-  /* copy group attributes */
-  grp_in = H5Gopen (file_in, "/", H5P_DEFAULT);
-  grp_out = H5Gopen (file_out, "/", H5P_DEFAULT);
-  copy_attr (grp_in, grp_out, NULL);
-  status = H5Gclose (grp_in);
-  status = H5Gclose (grp_out);
+  if (! batch || ! batch->n)
+    return;
+  accumulate (plan, options, batch->n, batch->length, batch_raw (batch), metrics);
+  batch_clear (batch);
+  printf ("committed: batch\n");
+}
+
+void
+prefetch (
+  const char * const name,
+  const unsigned long int small
+)
+{
+  int fd;
+  struct stat st;
   
-  /* set compression */
-  dcpl = H5Pcreate (H5P_DATASET_CREATE);
-  //status = H5Pset_deflate (dcpl, 9);
-  status = H5Pset_chunk (dcpl, 2, chunk);
+  /* a small file is read ahead as a whole, without waiting for it */
+  if ((fd = open (name, O_RDONLY)) < 0)
+    return;
+  if (! fstat (fd, & st) && (unsigned long int) st.st_size <= small)
+    posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+  close (fd);
+}
+
+void
+autorange (
+  options_t * const options
+)
+{
+  size_t i, j, nfile = 0;
+  const size_t step = (options->ninput + RANGE_FILES - 1) / RANGE_FILES;
+  sketch_t * sketch[options->dim_merged];
+  typecache_t cache[NDATASET_MAX];
   
-  /* create dataset */    
-  space_out = H5Screate_simple (2, dims_out, maxdims_out);
-  dset_out = H5Dcreate (file_out, "probability density", H5T_IEEE_F64BE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  for (j = 0; j < options->dim_merged; j++)
+    sketch[j] = sketch_alloc ();
+  for (j = 0; j < NDATASET_MAX; j++)
+    cache[j].dtype = -1;
   
-  /* copy attributes */
-  for (i = 0; i < NDATASET_MAX; i++)
+  /* a sample of the inputs, spread over all of them */
+  for (i = 0; i < options->ninput; i += step)
   {
-    if (options->dim[i])
+    size_t dataset_length = 0,
+           compound_member_length = 0;
+    double *** raw[NDATASET_MAX];
+    hid_t file_in;
+    
+    if ((file_in = H5Fopen (options->input[i], H5F_ACC_RDONLY, H5P_DEFAULT)) < 0)
+      continue;
+    if (load (& dataset_length, & compound_member_length, raw, file_in, options, cache, NULL)
+        && dataset_length && compound_member_length)
     {
-      hid_t dset_in;
-      
-      dset_in = H5Dopen (file_in, options->dataset[i], H5P_DEFAULT);
-      copy_attr (dset_in, dset_out, options->dataset[i]);
-      status = H5Dclose (dset_in);
+      range_add (sketch, options, dataset_length, compound_member_length, raw);
+      for (j = 0; j < NDATASET_MAX; j++)
+        if (options->dim[j])
+        {
+          free (raw[j][0][0]);
+          free (raw[j][0]);
+          free (raw[j]);
+        }
+      nfile++;
+      printf ("sampled: %s\n", options->input[i]);
     }
+    H5Fclose (file_in);
+  }
+  if (! nfile)
+  {
+    fprintf (stderr, "fatal: no input could be sampled for the automatic range.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
   }
   
-  /* write options */
-  options_write (options, dset_out);
-  
-  space_charge = H5Screate_simple (1, dims_charge, NULL);
-  attr_charge = H5Acreate (dset_out, "charge", H5T_STD_U64BE, space_charge, H5P_DEFAULT, H5P_DEFAULT);
-  status = H5Awrite (attr_charge, H5T_NATIVE_ULONG, & freq->c);
-  status = H5Sclose (space_charge);
-  status = H5Aclose (attr_charge);
-  
-  freq_save (
-    dset_out,
-    freq,
-    options->dim_merged
-  );
+  /* the bin size rules count the samples of all inputs */
+  range_apply (options, sketch, (double) options->ninput / (double) nfile);
+  printf ("\n");
   
-  status = H5Dclose (dset_out);
-  status = H5Sclose (space_out);
-  status = H5Pclose (dcpl);
+  for (j = 0; j < options->dim_merged; j++)
+    sketch_free (sketch[j]);
+  for (j = 0; j < NDATASET_MAX; j++)
+    if (cache[j].dtype >= 0)
+    {
+      H5Tclose (cache[j].dtype);
+      H5Tclose (cache[j].memtype);
+    }
 }
 
 void
-copy_attr (
-  const hid_t loc_in, const hid_t loc_out,
-  const char * const suffix
+request_snapshot (
+  int signum
 )
 {
-  hid_t attr_id, attr_out, space_id, ftype_id, wtype_id;
-  size_t msize; /* size of type */
-  void * buf = NULL; /* data buffer */
-  hsize_t nelmts; /* number of elements in dataset */
-  int rank; /* rank of dataset */
-  htri_t is_named; /* whether the datatype is named */
-  hsize_t dims[H5S_MAX_RANK]; /* dimensions of dataset */
-  char name[255];
-  H5O_info_t oinfo; /* object info */
-  int j;
-  unsigned u;
-  
-  H5Oget_info (loc_in, & oinfo);
-  
-  /* copy all attributes */
-  for (u = 0; u < (unsigned) oinfo.num_attrs; u++)
-  {
-    buf = NULL;
-    
-    /* open attribute */
-    attr_id = H5Aopen_by_idx (loc_in, ".", H5_INDEX_CRT_ORDER, H5_ITER_INC, (hsize_t) u, H5P_DEFAULT, H5P_DEFAULT);
-    
-    /* get name */
-    H5Aget_name (attr_id, (size_t) 255, name);
-    if (suffix)
-      sprintf (& name[strlen (name)], " (%s)", suffix);
-    
-    /* get the file datatype  */
-    ftype_id = H5Aget_type (attr_id);
-    
-    /* get the dataspace handle  */
-    space_id = H5Aget_space (attr_id);
-    
-    /* get dimensions  */
-    rank = H5Sget_simple_extent_dims (space_id, dims, NULL);
-    for (j = 0, nelmts=1; j < rank; j++)
-      nelmts *= dims[j];
-    
-    wtype_id = H5Tcopy (ftype_id);
-    
-    msize = H5Tget_size (wtype_id);
-    
-    if (H5T_REFERENCE == H5Tget_class (wtype_id))
-      ;
-    else 
-    {
-      /* read to memory */
-      buf = malloc ((size_t) (nelmts * msize));
-      H5Aread (attr_id, wtype_id, buf);
-      
-      /* copy */
-      attr_out = H5Acreate2 (loc_out, name, wtype_id, space_id, H5P_DEFAULT, H5P_DEFAULT);
-      H5Awrite (attr_out, wtype_id, buf);
-      
-      /*close*/
-      H5Aclose (attr_out);
-      
-      free (buf);
-    }
-    
-    /* close */
-    H5Tclose (ftype_id);
-    H5Tclose (wtype_id);
-    H5Sclose (space_id);
-    H5Aclose (attr_id);
-  }
+  snapshot_requested = 1;
 }
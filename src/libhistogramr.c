@@ -0,0 +1,651 @@
+/* libhistogramr.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "libhistogramr.h"
+#include "structs.h"
+#include "options.h"
+#include "freq.h"
+#include "plan.h"
+#include "save.h"
+#include "sat.h"
+
+static void
+histogramr_box (
+  const histogramr_t * const histogramr,
+  long int * const idl, long int * const idu
+);
+
+static void
+histogramr_walk (
+  const freq_t * const freq,
+  const size_t depth, const size_t dim,
+  long int * const key,
+  const cells_cb_t cb, void * const arg
+);
+
+static void
+histogramr_sparse_cell (
+  void * const arg,
+  const long int * const key, const unsigned long int c
+);
+
+static void
+histogramr_dense_cell (
+  void * const arg,
+  const long int * const key, const unsigned long int c
+);
+
+histogramr_t *
+histogramr_create (
+  const size_t dim,
+  const char * const * const member,
+  const double * const binning,
+  const double * const lower, const double * const upper,
+  const int * const l10
+)
+{
+  size_t i;
+  double l, u;
+  char name[32];
+  histogramr_t * histogramr;
+  options_t * options;
+  
+  if (! dim || dim > H5S_MAX_RANK || ! binning)
+    return (NULL);
+  for (i = 0; i < dim; i++)
+    if (! (binning[i] > 0.) || (lower && upper && ! (lower[i] < upper[i])))
+      return (NULL);
+  
+  /* log10 axes need limits of one sign, as on the command line */
+  for (i = 0; l10 && ! (lower && upper) && i < dim; i++)
+    if (l10[i])
+      return (NULL);
+  
+  histogramr = malloc (sizeof (* histogramr));
+  histogramr->freq = NULL;
+  histogramr->moments = NULL;
+  histogramr->options = options = malloc (sizeof (* options));
+  options_defaults (options);
+  
+  /* the merged axes of a single dataset, as options_prep leaves them */
+  options->dim_merged = dim;
+  options->member_merged = malloc (dim * sizeof (* options->member_merged));
+  options->binning_merged = malloc (dim * sizeof (* options->binning_merged));
+  options->limit_l_merged = malloc (dim * sizeof (* options->limit_l_merged));
+  options->limit_u_merged = malloc (dim * sizeof (* options->limit_u_merged));
+  options->limit_idl_merged = malloc (dim * sizeof (* options->limit_idl_merged));
+  options->limit_idu_merged = malloc (dim * sizeof (* options->limit_idu_merged));
+  options->l10_merged = malloc (dim * sizeof (* options->l10_merged));
+  histogramr->member = malloc (dim * sizeof (* histogramr->member));
+  histogramr->column = malloc (dim * sizeof (* histogramr->column));
+  
+  for (i = 0; i < dim; i++)
+  {
+    if (! member)
+      sprintf (name, "%lu", (unsigned long int) i);
+    options->member_merged[i] = histogramr->member[i] = strdup (member ? member[i] : name);
+    options->binning_merged[i] = binning[i];
+    options->l10_merged[i] = l10 && l10[i];
+    
+    histogramr->column[i].dataset = 0;
+    histogramr->column[i].member = i;
+    histogramr->column[i].l10 = l10 && l10[i];
+    histogramr->column[i].sign = (histogramr->column[i].l10 && lower && lower[i] < 0) ? -1. : 1.;
+    histogramr->column[i].binning = binning[i];
+    
+    if (lower && upper)
+    {
+      options->limit_l_merged[i] = l = lower[i];
+      options->limit_u_merged[i] = u = upper[i];
+      if (options_limit (& l, & u, histogramr->column[i].l10) == EXIT_FAILURE)
+      {
+        options->dim_merged = i + 1;
+        histogramr_free (histogramr);
+        return (NULL);
+      }
+      options->limit_idl_merged[i] = (long int) floor (l / binning[i]);
+      options->limit_idu_merged[i] = (long int) floor (u / binning[i]);
+    }
+    else
+    {
+      options->limit_l_merged[i] = - DBL_MAX;
+      options->limit_u_merged[i] = DBL_MAX;
+      options->limit_idl_merged[i] = LONG_MIN;
+      options->limit_idu_merged[i] = LONG_MAX;
+    }
+  }
+  
+  histogramr->freq = freq_alloc (
+                       0,
+                       options->limit_idl_merged, options->limit_idu_merged,
+                       options->binning_merged,
+                       NULL
+                     );
+  
+  return (histogramr);
+}
+
+void
+histogramr_free (
+  histogramr_t * const histogramr
+)
+{
+  size_t i;
+  
+  if (! histogramr)
+    return;
+  
+  for (i = 0; i < histogramr->options->dim_merged; i++)
+    free (histogramr->member[i]);
+  if (histogramr->freq)
+    freq_free (histogramr->freq);
+  if (histogramr->moments)
+    moments_free (histogramr->moments);
+  options_free (histogramr->options);
+  free (histogramr->member);
+  free (histogramr->column);
+  free (histogramr);
+}
+
+int
+histogramr_set (
+  histogramr_t * const histogramr,
+  const char * const name, const char * const value
+)
+{
+  char * str;
+  unsigned long int marginals = 0;
+  options_t * const options = histogramr->options;
+  
+  if (! strcmp (name, "output-format"))
+    return (parse_format (& options->format, value));
+  if (! strcmp (name, "compression"))
+    return (parse_filter (& options->filter, & options->level, value));
+  if (! strcmp (name, "shuffle"))
+    options->shuffle = strtobool (value);
+  else if (! strcmp (name, "chunk-size"))
+    options->chunk = (strcasecmp (value, "auto") == 0) ? 0 : (size_t) strtoul (value, NULL, 10);
+  else if (! strcmp (name, "threads"))
+    options->nthreads = (size_t) atoi (value);
+  else if (! strcmp (name, "moments"))
+  {
+    /* the moments are taken of the samples added from now on */
+    if (strtobool (value) && ! histogramr->moments)
+      histogramr->moments = moments_alloc (options->dim_merged);
+    else if (! strtobool (value) && histogramr->moments)
+    {
+      moments_free (histogramr->moments);
+      histogramr->moments = NULL;
+    }
+  }
+  else if (! strcmp (name, "marginals"))
+  {
+    /* marginals of lower order than the histogram only */
+    str = strdup (value);
+    if (parse_marginals (& marginals, str) == EXIT_FAILURE
+        || (options->dim_merged < CHAR_BIT * sizeof (marginals) && marginals >> options->dim_merged))
+    {
+      free (str);
+      return (EXIT_FAILURE);
+    }
+    free (str);
+    options->marginals = marginals;
+  }
+  else
+    return (EXIT_FAILURE);
+  
+  return (EXIT_SUCCESS);
+}
+
+int
+histogramr_add (
+  histogramr_t * const histogramr,
+  const size_t n,
+  const double * const * const column, const size_t stride
+)
+{
+  size_t i, k;
+  double r;
+  const size_t dim = histogramr->options->dim_merged,
+               step = stride ? stride : sizeof (double);
+  long int * id[H5S_MAX_RANK] = {NULL};
+  double * value[H5S_MAX_RANK] = {NULL};
+  
+  if (! n)
+    return (EXIT_SUCCESS);
+  
+  /* the samples are binned straight from the columns of the caller */
+  for (i = 0; i < dim; i++)
+  {
+    const column_t * const c = & histogramr->column[i];
+    const char * const base = (const char *) column[i];
+    
+    if (! (id[i] = malloc (n * sizeof (* id[i])))
+        || (histogramr->moments && ! (value[i] = malloc (n * sizeof (* value[i])))))
+    {
+      for (i = 0; i < dim; i++)
+      {
+        free (id[i]);
+        free (value[i]);
+      }
+      return (EXIT_FAILURE);
+    }
+    for (k = 0; k < n; k++)
+    {
+      memcpy (& r, & base[k * step], sizeof (r));
+      if (c->l10)
+        r = log10 (c->sign * r);
+      id[i][k] = (long int) floor (r / c->binning);
+      if (value[i])
+        value[i][k] = r;
+    }
+  }
+  
+  if (histogramr->moments)
+    moments_add (histogramr->moments, n, (const double * const *) value);
+  plan_commit (histogramr->freq, n, (const long int * const *) id, histogramr->options, NULL);
+  
+  for (i = 0; i < dim; i++)
+  {
+    free (id[i]);
+    free (value[i]);
+  }
+  
+  return (EXIT_SUCCESS);
+}
+
+int
+histogramr_merge (
+  histogramr_t * const histogramr,
+  const histogramr_t * const other
+)
+{
+  size_t i;
+  const options_t * const a = histogramr->options, * const b = other->options;
+  
+  if (histogramr == other || a->dim_merged != b->dim_merged || ! histogramr->moments != ! other->moments)
+    return (EXIT_FAILURE);
+  for (i = 0; i < a->dim_merged; i++)
+    if (a->binning_merged[i] != b->binning_merged[i]
+        || a->limit_idl_merged[i] != b->limit_idl_merged[i]
+        || a->limit_idu_merged[i] != b->limit_idu_merged[i]
+        || histogramr->column[i].l10 != other->column[i].l10
+        || histogramr->column[i].sign != other->column[i].sign)
+      return (EXIT_FAILURE);
+  
+  freq_merge (histogramr->freq, other->freq);
+  if (histogramr->moments)
+    moments_merge (histogramr->moments, other->moments);
+  
+  return (EXIT_SUCCESS);
+}
+
+unsigned long int
+histogramr_charge (
+  const histogramr_t * const histogramr
+)
+{
+  return (histogramr->freq->c);
+}
+
+void
+histogramr_extent (
+  const histogramr_t * const histogramr,
+  long int * const lower, long int * const upper
+)
+{
+  histogramr_box (histogramr, lower, upper);
+}
+
+size_t
+histogramr_cells (
+  const histogramr_t * const histogramr
+)
+{
+  return ((size_t) freq_leaves (histogramr->freq, histogramr->options->dim_merged));
+}
+
+size_t
+histogramr_size (
+  const histogramr_t * const histogramr
+)
+{
+  size_t i, size = 1, range;
+  long int idl[H5S_MAX_RANK], idu[H5S_MAX_RANK];
+  
+  histogramr_box (histogramr, idl, idu);
+  for (i = 0; i < histogramr->options->dim_merged; i++)
+  {
+    range = (size_t) ((unsigned long int) idu[i] - (unsigned long int) idl[i]);
+    if (! range || range > SIZE_MAX / sizeof (unsigned long int) / size)
+      return (0);
+    size *= range;
+  }
+  
+  return (size);
+}
+
+void
+histogramr_sparse (
+  const histogramr_t * const histogramr,
+  long int * const index, unsigned long int * const count
+)
+{
+  long int key[H5S_MAX_RANK];
+  export_t export;
+  
+  export.dim = histogramr->options->dim_merged;
+  export.n = 0;
+  export.index = index;
+  export.count = count;
+  histogramr_walk (histogramr->freq, 0, export.dim, key, histogramr_sparse_cell, & export);
+}
+
+int
+histogramr_dense (
+  const histogramr_t * const histogramr,
+  unsigned long int * const count
+)
+{
+  size_t i;
+  long int key[H5S_MAX_RANK], idl[H5S_MAX_RANK], idu[H5S_MAX_RANK];
+  export_t export;
+  const size_t size = histogramr_size (histogramr);
+  
+  if (! size)
+    return (EXIT_FAILURE);
+  
+  histogramr_box (histogramr, idl, idu);
+  export.dim = histogramr->options->dim_merged;
+  export.idl = idl;
+  export.count = count;
+  export.stride[export.dim - 1] = 1;
+  for (i = export.dim - 1; i > 0; i--)
+    export.stride[i - 1] = export.stride[i] * (size_t) (idu[i] - idl[i]);
+  memset (count, 0, size * sizeof (* count));
+  histogramr_walk (histogramr->freq, 0, export.dim, key, histogramr_dense_cell, & export);
+  
+  return (EXIT_SUCCESS);
+}
+
+int
+histogramr_save (
+  const histogramr_t * const histogramr,
+  const char * const output
+)
+{
+  char * tmp;
+  hid_t file_out;
+  herr_t status;
+  hsize_t rows;
+  options_t * const options = histogramr->options;
+  long int idl[options->dim_merged], idu[options->dim_merged];
+  
+  /* the saves would exit on grids they cannot hold, within the occupied box */
+  save_narrow (histogramr->freq, NULL, options, idl, idu);
+  rows = freq_rows (histogramr->freq, options->dim_merged);
+  save_widen (options, idl, idu);
+  if (options->format != FORMAT_SPARSE && rows == HSIZE_UNDEF)
+    return (EXIT_FAILURE);
+  
+  /* readers never see a partially written output file */
+  tmp = malloc (strlen (output) + 5);
+  sprintf (tmp, "%s.tmp", output);
+  if ((file_out = H5Fcreate (tmp, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)) < 0)
+  {
+    free (tmp);
+    return (EXIT_FAILURE);
+  }
+  save (file_out, -1, histogramr->freq, NULL, options);
+  if (histogramr->moments)
+    moments_save (file_out, histogramr->moments, options);
+  status = H5Fclose (file_out);
+  if (status < 0 || rename (tmp, output))
+  {
+    unlink (tmp);
+    free (tmp);
+    return (EXIT_FAILURE);
+  }
+  free (tmp);
+  
+  return (EXIT_SUCCESS);
+}
+
+histogramr_query_t *
+histogramr_query_open (
+  const char * const file, const char * const group, const char * const cache,
+  const int rebuild
+)
+{
+  char * name = cache ? (char *) cache : sat_cache (file, group);
+  sat_t * sat;
+  histogramr_query_t * query = NULL;
+  
+  if ((sat = sat_open (file, group, name, rebuild)))
+  {
+    query = malloc (sizeof (* query));
+    query->sat = sat;
+  }
+  if (name != cache)
+    free (name);
+  
+  return (query);
+}
+
+void
+histogramr_query_close (
+  histogramr_query_t * const query
+)
+{
+  if (! query)
+    return;
+  
+  sat_close (query->sat);
+  free (query);
+}
+
+size_t
+histogramr_query_dim (
+  const histogramr_query_t * const query
+)
+{
+  return (query->sat->dim);
+}
+
+void
+histogramr_query_extent (
+  const histogramr_query_t * const query,
+  long int * const lower, long int * const upper
+)
+{
+  size_t i;
+  const sat_t * const sat = query->sat;
+  
+  for (i = 0; i < sat->dim; i++)
+  {
+    lower[i] = sat->idl[i];
+    upper[i] = sat->idl[i] + (long int) sat->n[i];
+  }
+}
+
+int
+histogramr_query_box (
+  const histogramr_query_t * const query,
+  const double * const lower, const double * const upper,
+  double * const mass, unsigned long int * const count
+)
+{
+  size_t i;
+  const sat_t * const sat = query->sat;
+  long int lo[H5S_MAX_RANK], hi[H5S_MAX_RANK];
+  
+  /* as histogramr-query --box, beyond the table is clamped by sat_count */
+  histogramr_query_extent (query, lo, hi);
+  for (i = 0; i < sat->dim; i++)
+  {
+    if (isnan (lower[i]) || isnan (upper[i]))
+      return (EXIT_FAILURE);
+    if (isfinite (lower[i]))
+      lo[i] = (long int) fmax (floor (lower[i] / sat->binning[i]), (double) lo[i]);
+    if (isfinite (upper[i]))
+      hi[i] = (long int) fmin (ceil (upper[i] / sat->binning[i]), (double) hi[i]);
+  }
+  
+  * count = sat_count (sat, lo, hi);
+  * mass = sat->charge ? (double) * count / (double) sat->charge : 0.;
+  
+  return (EXIT_SUCCESS);
+}
+
+int
+histogramr_query_slice (
+  const histogramr_query_t * const query,
+  const double * const coord,
+  double * const density
+)
+{
+  size_t i, k = 0;
+  const sat_t * const sat = query->sat;
+  long int idl[H5S_MAX_RANK], idu[H5S_MAX_RANK], lo[H5S_MAX_RANK], hi[H5S_MAX_RANK];
+  double vol = 1., er;
+  
+  histogramr_query_extent (query, idl, idu);
+  for (i = 0; i < sat->dim; i++)
+  {
+    if (isinf (coord[i]))
+      return (EXIT_FAILURE);
+    if (isnan (coord[i]) && idl[i] == idu[i])
+      return (EXIT_SUCCESS);
+    if (isnan (coord[i]))
+      lo[i] = idl[i];
+    else
+      lo[i] = (long int) fmin (fmax (floor (coord[i] / sat->binning[i]), (double) idl[i] - 1.), (double) idu[i]);
+    hi[i] = lo[i] + 1;
+    vol *= sat->binning[i];
+  }
+  
+  /* the free axes are stepped in row-major order, as histogramr-query --slice prints them */
+  er = sat->charge ? 1. / ((double) sat->charge * vol) : 0.;
+  for (;;)
+  {
+    density[k++] = (double) sat_count (sat, lo, hi) * er;
+    
+    for (i = sat->dim; i-- > 0;)
+      if (isnan (coord[i]))
+      {
+        if (++lo[i] < idu[i])
+          break;
+        lo[i] = idl[i];
+      }
+    if (i == (size_t) -1)
+      break;
+    for (i = 0; i < sat->dim; i++)
+      hi[i] = lo[i] + 1;
+  }
+  
+  return (EXIT_SUCCESS);
+}
+
+static void
+histogramr_box (
+  const histogramr_t * const histogramr,
+  long int * const idl, long int * const idu
+)
+{
+  size_t i;
+  const options_t * const options = histogramr->options;
+  
+  /* the occupied bins within the limits, the box save_narrow saves */
+  for (i = 0; i < options->dim_merged; i++)
+  {
+    idl[i] = LONG_MAX;
+    idu[i] = LONG_MIN;
+  }
+  freq_extent (histogramr->freq, options->dim_merged, idl, idu);
+  
+  /* no bin at all, an empty extent at the lower limit */
+  for (i = 0; i < options->dim_merged; i++)
+    if (idl[i] > idu[i])
+      idl[i] = idu[i] = (options->limit_idl_merged[i] == LONG_MIN) ? 0 : options->limit_idl_merged[i];
+}
+
+static void
+histogramr_walk (
+  const freq_t * const freq,
+  const size_t depth, const size_t dim,
+  long int * const key,
+  const cells_cb_t cb, void * const arg
+)
+{
+  size_t i;
+  const freq_t * cur;
+  
+  /* the cells of the output, bin indices below the upper limits */
+  if (depth + 1 == dim)
+  {
+    for (i = 0; freq->leaves && i < freq->leaves->n && freq->leaves->id[i] < * freq->idu; i++)
+    {
+      key[depth] = freq->leaves->id[i];
+      cb (arg, key, counter_get (freq->leaves, i));
+    }
+    return;
+  }
+  
+  for (cur = freq->first; cur && cur->id < * freq->idu; cur = cur->next)
+  {
+    key[depth] = cur->id;
+    histogramr_walk (cur, depth + 1, dim, key, cb, arg);
+  }
+}
+
+static void
+histogramr_sparse_cell (
+  void * const arg,
+  const long int * const key, const unsigned long int c
+)
+{
+  export_t * const export = arg;
+  
+  memcpy (& export->index[export->n * export->dim], key, export->dim * sizeof (* key));
+  export->count[export->n++] = c;
+}
+
+static void
+histogramr_dense_cell (
+  void * const arg,
+  const long int * const key, const unsigned long int c
+)
+{
+  size_t i, k = 0;
+  export_t * const export = arg;
+  
+  for (i = 0; i < export->dim; i++)
+    k += (size_t) (key[i] - export->idl[i]) * export->stride[i];
+  export->count[k] = c;
+}
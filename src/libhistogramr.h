@@ -0,0 +1,193 @@
+/* libhistogramr.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The histogramr library fills histograms in the memory of the calling
+ * process and saves them in the output format of histogramr, so producers
+ * need not write their samples to intermediate files.
+ *
+ * Functions returning int return EXIT_SUCCESS or EXIT_FAILURE. Calls are
+ * not thread-safe, not even on different handles: the library keeps global
+ * counters of its allocations. */
+
+#ifndef __libhistogramr_h__
+#define __libhistogramr_h__
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* raised whenever a function of this header changes incompatibly */
+#define HISTOGRAMR_API_VERSION 1
+
+typedef struct histogramr histogramr_t;
+typedef struct histogramr_query histogramr_query_t;
+
+/* A histogram of dim axes with the given bin sizes. The axes are named
+ * by member, or by their number if member is NULL. Samples outside of
+ * the limits lower and upper are counted in the charge only, both may be
+ * NULL for unbounded axes.
+ * Axes with a non-zero l10 are binned in log10 of the samples, they
+ * need limits of the same sign. Returns NULL for an invalid spec. */
+histogramr_t *
+histogramr_create (
+  const size_t dim,
+  const char * const * const member,
+  const double * const binning,
+  const double * const lower, const double * const upper,
+  const int * const l10
+);
+
+void
+histogramr_free (
+  histogramr_t * const histogramr
+);
+
+/* Sets an output option by the name of its long command line option,
+ * output-format, compression, shuffle, chunk-size, threads, marginals or
+ * moments, with the same values as on the command line. Moments are
+ * taken of the samples added after they are enabled. */
+int
+histogramr_set (
+  histogramr_t * const histogramr,
+  const char * const name, const char * const value
+);
+
+/* Counts n samples, column[i] points to the first value of axis i. The
+ * values of one axis are stride bytes apart, 0 for consecutive doubles.
+ * The columns are read in place and may be reused after the call. */
+int
+histogramr_add (
+  histogramr_t * const histogramr,
+  const size_t n,
+  const double * const * const column, const size_t stride
+);
+
+/* Adds the counts of other, which must have the same axes, and moments
+ * if both take them. */
+int
+histogramr_merge (
+  histogramr_t * const histogramr,
+  const histogramr_t * const other
+);
+
+/* The number of samples added, including those outside of the limits. */
+unsigned long int
+histogramr_charge (
+  const histogramr_t * const histogramr
+);
+
+/* The bin index range of every axis, lower[i] <= index < upper[i], the
+ * box of the occupied bins within the limits, as it is saved. The bin i
+ * of an axis holds the samples in [i, i + 1) times its bin size, in log10
+ * for the l10 axes. An empty histogram has an empty extent. */
+void
+histogramr_extent (
+  const histogramr_t * const histogramr,
+  long int * const lower, long int * const upper
+);
+
+/* The number of occupied bins. */
+size_t
+histogramr_cells (
+  const histogramr_t * const histogramr
+);
+
+/* The number of bins of the extent, 0 if it is empty or too large. */
+size_t
+histogramr_size (
+  const histogramr_t * const histogramr
+);
+
+/* Fills index with the bin indices, one row of dim per occupied bin in
+ * lexicographic order, and count with their counts. */
+void
+histogramr_sparse (
+  const histogramr_t * const histogramr,
+  long int * const index, unsigned long int * const count
+);
+
+/* Fills count with the counts of all bins of the extent, in row-major
+ * order. Fails if the extent has no size. */
+int
+histogramr_dense (
+  const histogramr_t * const histogramr,
+  unsigned long int * const count
+);
+
+/* Writes the histogram to output, atomically replacing the file. */
+int
+histogramr_save (
+  const histogramr_t * const histogramr,
+  const char * const output
+);
+
+/* Opens a saved histogram for queries, as histogramr-query answers them.
+ * group names a marginal or group of the file, NULL the histogram itself.
+ * The summed-area table is cached in cache, or next to file if NULL, and
+ * rebuilt if it is stale or rebuild is non-zero. Returns NULL on failure. */
+histogramr_query_t *
+histogramr_query_open (
+  const char * const file, const char * const group, const char * const cache,
+  const int rebuild
+);
+
+void
+histogramr_query_close (
+  histogramr_query_t * const query
+);
+
+/* The number of axes of the saved histogram. */
+size_t
+histogramr_query_dim (
+  const histogramr_query_t * const query
+);
+
+/* The bin index range of every axis saved, lower[i] <= index < upper[i]. */
+void
+histogramr_query_extent (
+  const histogramr_query_t * const query,
+  long int * const lower, long int * const upper
+);
+
+/* The probability mass and the count of the box lower[i] <= x < upper[i],
+ * widened to the enclosing bin edges, in log10 for the l10 axes. Infinite
+ * bounds take the whole axis. Fails for NaN bounds. */
+int
+histogramr_query_box (
+  const histogramr_query_t * const query,
+  const double * const lower, const double * const upper,
+  double * const mass, unsigned long int * const count
+);
+
+/* Fills density with the densities of the bins at coord, in row-major
+ * order over the extent of the axes whose coordinate is NaN. Fails for
+ * infinite coordinates. */
+int
+histogramr_query_slice (
+  const histogramr_query_t * const query,
+  const double * const coord,
+  double * const density
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,519 @@
+/* metrics.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+
+static const char * const metrics_phase[NPHASE] = {
+  "open", "load", "bin", "sort", "accumulate", "spill", "save"
+};
+
+static const char * const metrics_event[NEVENT] = {
+  "cycles", "instructions", "cache_misses", "branch_misses", "page_faults"
+};
+
+metrics_t *
+metrics_open (
+  const char * const name, const char * const status
+)
+{
+  size_t i;
+  metrics_t * metrics;
+  
+  metrics = malloc (sizeof (* metrics));
+  
+  /* records are appended with single writes, so background saves can share the file */
+  metrics->fd = -1;
+  if (name && (metrics->fd = open (name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)) < 0)
+  {
+    fprintf (stderr, "fatal: metrics file `%s' could not be created.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  for (i = 0; i < NPHASE; i++)
+    metrics_reset (metrics, i);
+  metrics_events_open (metrics);
+  metrics->begin = metrics->opened = metrics_clock ();
+  
+  /* the status file is rewritten by a thread, off the path of the samples */
+  metrics->status = status;
+  metrics->state.phase = "idle";
+  metrics->state.input = "";
+  metrics->state.done = metrics->state.ninput = 0;
+  metrics->state.bytes = metrics->state.rows = metrics->state.charge = 0;
+  metrics->state.nodes = metrics->state.node_bytes = 0;
+  metrics->dirty = true;
+  metrics->stop = metrics->failed = false;
+  if (status)
+  {
+    pthread_mutex_init (& metrics->lock, NULL);
+    pthread_cond_init (& metrics->cond, NULL);
+    if (pthread_create (& metrics->thread, NULL, metrics_monitor, metrics))
+    {
+      fprintf (stderr, "warning: status file `%s' disabled, no thread could be started.\n", status);
+      metrics->status = NULL;
+    }
+  }
+  
+  return (metrics);
+}
+
+void
+metrics_close (
+  metrics_t * const metrics
+)
+{
+  if (! metrics)
+    return;
+  
+  if (metrics->status)
+  {
+    metrics_update (metrics, "done");
+    pthread_mutex_lock (& metrics->lock);
+    metrics->stop = true;
+    pthread_cond_signal (& metrics->cond);
+    pthread_mutex_unlock (& metrics->lock);
+    pthread_join (metrics->thread, NULL);
+    if (! metrics->failed)
+      metrics_status (metrics, & metrics->state);
+    pthread_mutex_destroy (& metrics->lock);
+    pthread_cond_destroy (& metrics->cond);
+  }
+  metrics_events_close (metrics);
+  if (metrics->fd >= 0)
+    close (metrics->fd);
+  free (metrics);
+}
+
+void
+metrics_fork (
+  metrics_t * const metrics
+)
+{
+  if (! metrics)
+    return;
+  
+  /* inherited counters keep counting the parent, the status thread is not inherited */
+  metrics_events_close (metrics);
+  metrics_events_open (metrics);
+  metrics->status = NULL;
+  trace_process (PACKAGE_NAME " save");
+  trace_thread ("save");
+}
+
+void
+metrics_start (
+  metrics_t * const metrics,
+  const phase_t phase
+)
+{
+  if (! metrics)
+    return;
+  
+  metrics_update (metrics, metrics_phase[phase]);
+  metrics_events_read (metrics, metrics->mark[phase]);
+  metrics->start[phase] = metrics_clock ();
+}
+
+void
+metrics_stop (
+  metrics_t * const metrics,
+  const phase_t phase
+)
+{
+  size_t i;
+  unsigned long int value[NEVENT], rss, max_rss;
+  double stop;
+  
+  if (! metrics)
+    return;
+  
+  stop = metrics_clock ();
+  metrics->seconds[phase] += stop - metrics->start[phase];
+  metrics->calls[phase]++;
+  metrics_events_read (metrics, value);
+  for (i = 0; i < NEVENT; i++)
+    metrics->count[phase][i] += value[i] - metrics->mark[phase][i];
+  
+  /* saves are traced with their output, see metrics_save */
+  if (trace_enabled () && phase != PHASE_SAVE)
+  {
+    trace_span ("phase", metrics_phase[phase], metrics->start[phase], stop, "file", metrics->state.input);
+    metrics_rss (& rss, & max_rss);
+    trace_counter ("memory", "rss", rss);
+    trace_counter ("memory", "node_bytes", freq_allocated ());
+  }
+}
+
+void
+metrics_input (
+  metrics_t * const metrics,
+  const char * const input, const size_t ninput
+)
+{
+  if (! metrics)
+    return;
+  
+  if (metrics->status)
+    pthread_mutex_lock (& metrics->lock);
+  metrics->state.input = input;
+  metrics->state.ninput = ninput;
+  if (metrics->status)
+    pthread_mutex_unlock (& metrics->lock);
+  metrics->opened = metrics_clock ();
+}
+
+void
+metrics_file (
+  metrics_t * const metrics,
+  const char * const input,
+  const unsigned long int bytes, const unsigned long int rows, const unsigned long int charge
+)
+{
+  size_t i;
+  
+  if (! metrics)
+    return;
+  
+  /* one record per phase the file went through, the phases are summed over all histograms */
+  for (i = 0; i < PHASE_SAVE; i++)
+  {
+    if (metrics->calls[i] && metrics->fd >= 0)
+      metrics_emit (metrics, i, "file", input, bytes, rows, 0);
+    metrics_reset (metrics, i);
+  }
+  trace_span ("file", "file", metrics->opened, metrics_clock (), "file", input);
+  
+  if (metrics->status)
+  {
+    pthread_mutex_lock (& metrics->lock);
+    metrics->state.done++;
+    metrics->state.bytes += bytes;
+    metrics->state.rows += rows;
+    metrics->state.charge = charge;
+    pthread_mutex_unlock (& metrics->lock);
+    metrics_update (metrics, "idle");
+  }
+}
+
+void
+metrics_save (
+  metrics_t * const metrics,
+  const char * const output,
+  const unsigned long int rows
+)
+{
+  struct stat st;
+  
+  if (! metrics)
+    return;
+  
+  trace_span ("phase", metrics_phase[PHASE_SAVE], metrics->start[PHASE_SAVE], metrics_clock (), "output", output);
+  if (stat (output, & st))
+    st.st_size = 0;
+  if (metrics->fd >= 0)
+    metrics_emit (metrics, PHASE_SAVE, "output", output, 0, rows, (unsigned long int) st.st_size);
+  metrics_reset (metrics, PHASE_SAVE);
+}
+
+static double
+metrics_clock (
+  void
+)
+{
+  struct timespec ts;
+  
+  clock_gettime (CLOCK_MONOTONIC, & ts);
+  
+  return ((double) ts.tv_sec + (double) ts.tv_nsec / 1e9);
+}
+
+static void
+metrics_events_open (
+  metrics_t * const metrics
+)
+{
+  size_t i;
+  
+  for (i = 0; i < NEVENT; i++)
+    metrics->event[i] = -1;
+  if (metrics->fd < 0)
+    return;
+#if defined (HAVE_LINUX_PERF_EVENT_H) && defined (HAVE_SYS_SYSCALL_H) && defined (__NR_perf_event_open)
+  static const unsigned int type[NEVENT] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE
+  };
+  static const unsigned long int config[NEVENT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_PAGE_FAULTS
+  };
+  struct perf_event_attr attr;
+  
+  /* user space of this process only, which needs no privileges at the default paranoia */
+  for (i = 0; i < NEVENT; i++)
+  {
+    memset (& attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = type[i];
+    attr.config = config[i];
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    metrics->event[i] = (int) syscall (__NR_perf_event_open, & attr, 0, -1, -1, 0);
+  }
+#endif
+}
+
+static void
+metrics_events_close (
+  metrics_t * const metrics
+)
+{
+  size_t i;
+  
+  for (i = 0; i < NEVENT; i++)
+    if (metrics->event[i] >= 0)
+      close (metrics->event[i]);
+}
+
+static void
+metrics_events_read (
+  const metrics_t * const metrics,
+  unsigned long int * const value
+)
+{
+  size_t i;
+  unsigned long int buf[3];
+  struct rusage usage;
+  
+  for (i = 0; i < NEVENT; i++)
+    value[i] = 0;
+  if (metrics->fd < 0)
+    return;
+  
+  for (i = 0; i < NEVENT; i++)
+  {
+    /* multiplexed counters are scaled to the time they were enabled */
+    if (metrics->event[i] >= 0 && read (metrics->event[i], buf, sizeof (buf)) == sizeof (buf) && buf[2])
+      value[i] = (unsigned long int) ((double) buf[0] * ((double) buf[1] / (double) buf[2]));
+  }
+  
+  /* page faults are also known without perf */
+  if (metrics->event[EVENT_PAGE_FAULTS] < 0)
+  {
+    getrusage (RUSAGE_SELF, & usage);
+    value[EVENT_PAGE_FAULTS] = (unsigned long int) (usage.ru_minflt + usage.ru_majflt);
+  }
+}
+
+static void
+metrics_reset (
+  metrics_t * const metrics,
+  const phase_t phase
+)
+{
+  size_t i;
+  
+  metrics->seconds[phase] = 0.;
+  metrics->calls[phase] = 0;
+  for (i = 0; i < NEVENT; i++)
+    metrics->count[phase][i] = 0;
+}
+
+static void
+metrics_emit (
+  const metrics_t * const metrics,
+  const phase_t phase, const char * const key, const char * const name,
+  const unsigned long int bytes, const unsigned long int rows, const unsigned long int save
+)
+{
+  char buf[METRICS_RECORD_SIZE];
+  size_t i, n;
+  const double seconds = metrics->seconds[phase];
+  unsigned long int rss, max_rss;
+  struct timeval tv;
+  
+  gettimeofday (& tv, NULL);
+  metrics_rss (& rss, & max_rss);
+  
+  n = snprintf (buf, sizeof (buf), "{\"time\": %.6f, \"elapsed\": %.6f, \"pid\": %ld, \"phase\": \"%s\", \"%s\": \"",
+                (double) tv.tv_sec + (double) tv.tv_usec / 1e6, metrics_clock () - metrics->begin,
+                (long int) getpid (), metrics_phase[phase], key);
+  n += metrics_escape (& buf[n], sizeof (buf) - n, name);
+  n += snprintf (& buf[n], sizeof (buf) - n,
+                 "\", \"seconds\": %.6f, \"bytes\": %lu, \"rows\": %lu, \"rows_per_s\": %.1f, "
+                 "\"nodes\": %lu, \"node_bytes\": %lu, \"rss\": %lu, \"max_rss\": %lu, \"save_bytes\": %lu",
+                 seconds, bytes, rows, (seconds > 0.) ? (double) rows / seconds : 0.,
+                 freq_population (), freq_allocated (), rss, max_rss, save);
+  
+  /* counters that could not be opened are null, not zero */
+  for (i = 0; i < NEVENT; i++)
+    if (metrics->event[i] >= 0 || i == EVENT_PAGE_FAULTS)
+      n += snprintf (& buf[n], sizeof (buf) - n, ", \"%s\": %lu", metrics_event[i], metrics->count[phase][i]);
+    else
+      n += snprintf (& buf[n], sizeof (buf) - n, ", \"%s\": null", metrics_event[i]);
+  n += snprintf (& buf[n], sizeof (buf) - n, "}\n");
+  if (n >= sizeof (buf))
+    return;
+  
+  if (write (metrics->fd, buf, n) != (ssize_t) n)
+    fprintf (stderr, "warning: metrics record could not be written.\n");
+}
+static void
+metrics_update (
+  metrics_t * const metrics,
+  const char * const phase
+)
+{
+  if (! metrics->status)
+    return;
+  
+  /* the sizes of the trees are read here, where they cannot change */
+  pthread_mutex_lock (& metrics->lock);
+  metrics->state.phase = phase;
+  metrics->state.nodes = freq_population ();
+  metrics->state.node_bytes = freq_allocated ();
+  metrics->dirty = true;
+  pthread_mutex_unlock (& metrics->lock);
+}
+
+static void *
+metrics_monitor (
+  void * arg
+)
+{
+  metrics_t * const metrics = arg;
+  status_t state;
+  struct timespec ts;
+  bool ok;
+  
+  pthread_mutex_lock (& metrics->lock);
+  while (! metrics->stop && ! metrics->failed)
+  {
+    if (metrics->dirty)
+    {
+      state = metrics->state;
+      metrics->dirty = false;
+      pthread_mutex_unlock (& metrics->lock);
+      ok = metrics_status (metrics, & state);
+      pthread_mutex_lock (& metrics->lock);
+      if (! ok)
+        metrics->failed = true;
+    }
+    clock_gettime (CLOCK_REALTIME, & ts);
+    ts.tv_sec += METRICS_STATUS_INTERVAL;
+    while (! metrics->stop && pthread_cond_timedwait (& metrics->cond, & metrics->lock, & ts) == 0)
+      ;
+  }
+  pthread_mutex_unlock (& metrics->lock);
+  
+  return (NULL);
+}
+
+static bool
+metrics_status (
+  const metrics_t * const metrics,
+  const status_t * const state
+)
+{
+  char buf[METRICS_RECORD_SIZE], * tmp;
+  size_t n;
+  int fd;
+  bool ok;
+  const double elapsed = metrics_clock () - metrics->begin;
+  unsigned long int rss, max_rss;
+  
+  metrics_rss (& rss, & max_rss);
+  
+  n = snprintf (buf, sizeof (buf), "{\"pid\": %ld, \"phase\": \"%s\", \"file\": \"", (long int) getpid (), state->phase);
+  n += metrics_escape (& buf[n], sizeof (buf) - n, state->input);
+  n += snprintf (& buf[n], sizeof (buf) - n,
+                 "\", \"files_done\": %lu, \"files\": %lu, \"elapsed\": %.3f, \"eta\": %.3f, "
+                 "\"bytes\": %lu, \"rows\": %lu, \"rows_per_s\": %.1f, \"charge\": %lu, "
+                 "\"nodes\": %lu, \"node_bytes\": %lu, \"rss\": %lu, \"max_rss\": %lu}\n",
+                 (unsigned long int) state->done, (unsigned long int) state->ninput, elapsed,
+                 state->done ? elapsed / (double) state->done * (double) (state->ninput - state->done) : 0.,
+                 state->bytes, state->rows, (elapsed > 0.) ? (double) state->rows / elapsed : 0., state->charge,
+                 state->nodes, state->node_bytes, rss, max_rss);
+  if (n >= sizeof (buf))
+    return (true);
+  
+  /* readers see the previous or the new status, never a partial one */
+  tmp = malloc (strlen (metrics->status) + 5);
+  sprintf (tmp, "%s.tmp", metrics->status);
+  ok = (fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0;
+  if (ok)
+  {
+    ok = write (fd, buf, n) == (ssize_t) n;
+    ok = ! close (fd) && ok && ! rename (tmp, metrics->status);
+  }
+  if (! ok)
+    fprintf (stderr, "warning: status file `%s' could not be written, disabling it.\n", metrics->status);
+  free (tmp);
+  
+  return (ok);
+}
+
+static size_t
+metrics_escape (
+  char * const buf, const size_t size,
+  const char * const s
+)
+{
+  size_t i, n = 0;
+  
+  /* file names as JSON strings, truncated to fit the record */
+  for (i = 0; s[i] && n + 7 < size; i++)
+    if (s[i] == '"' || s[i] == '\\')
+    {
+      buf[n++] = '\\';
+      buf[n++] = s[i];
+    }
+    else if ((unsigned char) s[i] < 0x20)
+      n += sprintf (& buf[n], "\\u%04x", (unsigned int) s[i]);
+    else
+      buf[n++] = s[i];
+  buf[n] = '\0';
+  
+  return (n);
+}
+
+static void
+metrics_rss (
+  unsigned long int * const rss, unsigned long int * const max_rss
+)
+{
+  unsigned long int size, resident;
+  struct rusage usage;
+  FILE * file;
+  
+  /* the resident set is only known where /proc exists */
+  * rss = 0;
+  if ((file = fopen ("/proc/self/statm", "r")))
+  {
+    if (fscanf (file, "%lu %lu", & size, & resident) == 2)
+      * rss = resident * (unsigned long int) sysconf (_SC_PAGESIZE);
+    fclose (file);
+  }
+  
+  getrusage (RUSAGE_SELF, & usage);
+#ifdef __APPLE__
+  * max_rss = (unsigned long int) usage.ru_maxrss;
+#else
+  * max_rss = (unsigned long int) usage.ru_maxrss * 1024;
+#endif
+}
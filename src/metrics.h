@@ -0,0 +1,160 @@
+/* metrics.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __metrics_h__
+#define __metrics_h__
+
+#include "global.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+#include "structs.h"
+#include "freq.h"
+#include "trace.h"
+
+#define METRICS_RECORD_SIZE 4096
+/* seconds between rewrites of the status file */
+#define METRICS_STATUS_INTERVAL 1
+
+metrics_t *
+metrics_open (
+  const char * const name, const char * const status
+);
+
+void
+metrics_close (
+  metrics_t * const metrics
+);
+
+void
+metrics_fork (
+  metrics_t * const metrics
+);
+
+void
+metrics_start (
+  metrics_t * const metrics,
+  const phase_t phase
+);
+
+void
+metrics_stop (
+  metrics_t * const metrics,
+  const phase_t phase
+);
+
+void
+metrics_input (
+  metrics_t * const metrics,
+  const char * const input, const size_t ninput
+);
+
+void
+metrics_file (
+  metrics_t * const metrics,
+  const char * const input,
+  const unsigned long int bytes, const unsigned long int rows, const unsigned long int charge
+);
+
+void
+metrics_save (
+  metrics_t * const metrics,
+  const char * const output,
+  const unsigned long int rows
+);
+
+static double
+metrics_clock (
+  void
+);
+
+static void
+metrics_events_open (
+  metrics_t * const metrics
+);
+
+static void
+metrics_events_close (
+  metrics_t * const metrics
+);
+
+static void
+metrics_events_read (
+  const metrics_t * const metrics,
+  unsigned long int * const value
+);
+
+static void
+metrics_reset (
+  metrics_t * const metrics,
+  const phase_t phase
+);
+
+static void
+metrics_emit (
+  const metrics_t * const metrics,
+  const phase_t phase, const char * const key, const char * const name,
+  const unsigned long int bytes, const unsigned long int rows, const unsigned long int save
+);
+
+static void
+metrics_update (
+  metrics_t * const metrics,
+  const char * const phase
+);
+
+static void *
+metrics_monitor (
+  void * arg
+);
+
+static bool
+metrics_status (
+  const metrics_t * const metrics,
+  const status_t * const state
+);
+
+static size_t
+metrics_escape (
+  char * const buf, const size_t size,
+  const char * const s
+);
+
+static void
+metrics_rss (
+  unsigned long int * const rss, unsigned long int * const max_rss
+);
+
+#endif
@@ -0,0 +1,224 @@
+/* moments.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "moments.h"
+
+moments_t *
+moments_alloc (
+  const size_t dim
+)
+{
+  moments_t * moments;
+  
+  moments = malloc (sizeof (* moments));
+  moments->dim = dim;
+  moments->n = 0;
+  moments->mean = calloc (dim, sizeof (* moments->mean));
+  moments->m3 = calloc (dim, sizeof (* moments->m3));
+  moments->cov = calloc (dim * dim, sizeof (* moments->cov));
+  
+  return (moments);
+}
+
+void
+moments_free (
+  moments_t * const moments
+)
+{
+  free (moments->mean);
+  free (moments->m3);
+  free (moments->cov);
+  free (moments);
+}
+
+void
+moments_add (
+  moments_t * const moments,
+  const size_t n,
+  const double * const * const value
+)
+{
+  const size_t dim = moments->dim;
+  size_t i, j, k, nb = 0;
+  double mean[dim], m3[dim], cov[dim * dim], s, s3, d;
+  bool * keep, all = true;
+  
+  /* rows with a value that is not finite, e.g. the log10 of a negative one, are left out */
+  keep = malloc (n * sizeof (* keep));
+  for (k = 0; k < n; k++)
+  {
+    keep[k] = true;
+    for (i = 0; i < dim; i++)
+      keep[k] = keep[k] && isfinite (value[i][k]);
+    nb += keep[k];
+    all = all && keep[k];
+  }
+  if (! nb)
+  {
+    free (keep);
+    return;
+  }
+  
+  /* the moments of the batch in two passes, exact up to rounding whatever its offset */
+  for (i = 0; i < dim; i++)
+  {
+    const double * const x = value[i];
+    
+    s = 0.;
+    if (all)
+      for (k = 0; k < n; k++)
+        s += x[k];
+    else
+      for (k = 0; k < n; k++)
+        s += keep[k] ? x[k] : 0.;
+    mean[i] = s / (double) nb;
+  }
+  for (i = 0; i < dim; i++)
+  {
+    const double * const x = value[i];
+    
+    s = s3 = 0.;
+    for (k = 0; k < n; k++)
+    {
+      d = keep[k] ? x[k] - mean[i] : 0.;
+      s += d * d;
+      s3 += d * d * d;
+    }
+    cov[i * dim + i] = s;
+    m3[i] = s3;
+    for (j = i + 1; j < dim; j++)
+    {
+      const double * const y = value[j];
+      
+      s = 0.;
+      for (k = 0; k < n; k++)
+        s += keep[k] ? (x[k] - mean[i]) * (y[k] - mean[j]) : 0.;
+      cov[i * dim + j] = cov[j * dim + i] = s;
+    }
+  }
+  free (keep);
+  
+  moments_combine (moments, nb, mean, m3, cov);
+}
+
+void
+moments_merge (
+  moments_t * const moments,
+  const moments_t * const other
+)
+{
+  moments_combine (moments, other->n, other->mean, other->m3, other->cov);
+}
+
+void
+moments_save (
+  const hid_t file_out,
+  const moments_t * const moments,
+  const options_t * const options
+)
+{
+  size_t i, j;
+  const size_t dim = moments->dim;
+  const double n = (double) moments->n;
+  double variance[dim], skewness[dim], covariance[dim * dim];
+  hid_t grp_out, strtype, space, dset, attr;
+  hsize_t dims[2] = {dim, dim};
+  herr_t status;
+  
+  /* sample (co)variances, and the skewness of the moments, g1 */
+  for (i = 0; i < dim; i++)
+  {
+    for (j = 0; j < dim; j++)
+      covariance[i * dim + j] = (moments->n > 1) ? moments->cov[i * dim + j] / (n - 1.) : NAN;
+    variance[i] = covariance[i * dim + i];
+    skewness[i] = (moments->n && moments->cov[i * dim + i] > 0.)
+                  ? sqrt (n) * moments->m3[i] / pow (moments->cov[i * dim + i], 1.5) : NAN;
+  }
+  
+  grp_out = H5Gcreate (file_out, "moments", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  
+  strtype = H5Tcopy (H5T_C_S1);
+  status = H5Tset_size (strtype, H5T_VARIABLE);
+  space = H5Screate_simple (1, dims, NULL);
+  attr = H5Acreate (grp_out, "members", strtype, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, strtype, options->member_merged);
+  status = H5Aclose (attr);
+  attr = H5Acreate (grp_out, "analyzer log10", H5T_NATIVE_HBOOL, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_HBOOL, options->l10_merged);
+  status = H5Aclose (attr);
+  status = H5Tclose (strtype);
+  
+  dset = H5Dcreate (grp_out, "mean", H5T_IEEE_F64BE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Dwrite (dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, moments->mean);
+  status = H5Dclose (dset);
+  dset = H5Dcreate (grp_out, "variance", H5T_IEEE_F64BE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Dwrite (dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, variance);
+  status = H5Dclose (dset);
+  dset = H5Dcreate (grp_out, "skewness", H5T_IEEE_F64BE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Dwrite (dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, skewness);
+  status = H5Dclose (dset);
+  status = H5Sclose (space);
+  
+  space = H5Screate_simple (2, dims, NULL);
+  dset = H5Dcreate (grp_out, "covariance", H5T_IEEE_F64BE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Dwrite (dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, covariance);
+  status = H5Dclose (dset);
+  status = H5Sclose (space);
+  
+  space = H5Screate (H5S_SCALAR);
+  attr = H5Acreate (grp_out, "count", H5T_STD_U64BE, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_ULONG, & moments->n);
+  status = H5Aclose (attr);
+  status = H5Sclose (space);
+  
+  status = H5Gclose (grp_out);
+}
+
+static void
+moments_combine (
+  moments_t * const moments,
+  const unsigned long int n,
+  const double * const mean, const double * const m3, const double * const cov
+)
+{
+  size_t i, j;
+  const size_t dim = moments->dim;
+  const double na = (double) moments->n, nb = (double) n, nab = na + nb;
+  double delta[dim], m2a, m2b;
+  
+  if (! n)
+    return;
+  
+  /* the pairwise update of Chan et al. and Pebay, both sides are sums about their own mean */
+  for (i = 0; i < dim; i++)
+    delta[i] = mean[i] - moments->mean[i];
+  for (i = 0; i < dim; i++)
+  {
+    m2a = moments->cov[i * dim + i];
+    m2b = cov[i * dim + i];
+    moments->m3[i] += m3[i]
+                      + delta[i] * delta[i] * delta[i] * na * nb * (na - nb) / (nab * nab)
+                      + 3. * delta[i] * (na * m2b - nb * m2a) / nab;
+  }
+  for (i = 0; i < dim; i++)
+    for (j = 0; j < dim; j++)
+      moments->cov[i * dim + j] += cov[i * dim + j] + delta[i] * delta[j] * na * nb / nab;
+  for (i = 0; i < dim; i++)
+    moments->mean[i] += delta[i] * nb / nab;
+  moments->n += n;
+}
@@ -0,0 +1,71 @@
+/* moments.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __moments_h__
+#define __moments_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <math.h>
+
+#include "structs.h"
+
+moments_t *
+moments_alloc (
+  const size_t dim
+);
+
+void
+moments_free (
+  moments_t * const moments
+);
+
+void
+moments_add (
+  moments_t * const moments,
+  const size_t n,
+  const double * const * const value
+);
+
+void
+moments_merge (
+  moments_t * const moments,
+  const moments_t * const other
+);
+
+void
+moments_save (
+  const hid_t file_out,
+  const moments_t * const moments,
+  const options_t * const options
+);
+
+static void
+moments_combine (
+  moments_t * const moments,
+  const unsigned long int n,
+  const double * const mean, const double * const m3, const double * const cov
+);
+
+#endif
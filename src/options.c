@@ -18,6 +18,9 @@
 
 #include "options.h"
 
+static const char * const format_name[] = {"dense", "sparse", "grid"};
+static const char * const filter_name[] = {"none", "deflate", "zstd", "lz4"};
+
 void
 options_defaults (
   options_t * const options
@@ -26,9 +29,41 @@ options_defaults (
   options->ninput = 0;
   options->input = NULL;
   options->output = NULL;
+  options->jobs = NULL;
+  options->spec = NULL;
   options->savevery = 1;
+  options->interval = 0.;
+  options->background = true;
+  options->format = FORMAT_DENSE;
+  options->marginals = 0;
+  
+  options->chunk = 0;
+  options->filter = FILTER_NONE;
+  options->level = -1;
+  options->shuffle = false;
+  options->nthreads = 0;
+  
+  options->max_memory = 0;
+  options->scratch = NULL;
+  options->metrics = NULL;
+  options->status = NULL;
+  options->trace = NULL;
+  options->layout = NULL;
+  options->group = NULL;
+  options->moments = false;
   
-  options->chunk = 64;
+  options->autorange = false;
+  options->quantile[0] = 0.;
+  options->quantile[1] = 1.;
+  options->nbins = 0;
+  options->small = 0;
+  options->preview = false;
+  options->sample = 0.;
+  options->sampled = 1.;
+  options->seed = 0;
+  options->auto_merged = NULL;
+  options->limit_idl_given = NULL;
+  options->limit_idu_given = NULL;
   
   size_t ndataset = 0;
   do
@@ -44,8 +79,8 @@ options_defaults (
   while (++ndataset < NDATASET_MAX);
 }
 
-void
-options_prep (
+static size_t
+options_parse (
   options_t * const options,
   int argc, char * const argv[]
 )
@@ -56,7 +91,28 @@ options_prep (
   static const char short_options[] = {
     OPT_INPUT, ':',
     OPT_OUTPUT, ':',
+    OPT_JOBS, ':',
     OPT_SAVEVERY, ':',
+    OPT_INTERVAL, ':',
+    OPT_BACKGROUND, ':',
+    OPT_FORMAT, ':',
+    OPT_MARGINALS, ':',
+    OPT_FILTER, ':',
+    OPT_SHUFFLE, ':',
+    OPT_CHUNK, ':',
+    OPT_THREADS, ':',
+    OPT_MEMORY, ':',
+    OPT_SCRATCH, ':',
+    OPT_METRICS, ':',
+    OPT_STATUS, ':',
+    OPT_TRACE, ':',
+    OPT_LAYOUT, ':',
+    OPT_AUTORANGE, ':',
+    OPT_SMALL, ':',
+    OPT_GROUPBY, ':',
+    OPT_SAMPLE, ':',
+    OPT_PREVIEW, ':',
+    OPT_MOMENTS, ':',
     
     OPT_DATASET, ':',
     OPT_MEMBER, ':',
@@ -70,7 +126,28 @@ options_prep (
   static const struct option long_options[] = {
     { "input", required_argument, NULL, OPT_INPUT },
     { "output", required_argument, NULL, OPT_OUTPUT },
+    { "jobs", required_argument, NULL, OPT_JOBS },
     { "save-every", required_argument, NULL, OPT_SAVEVERY },
+    { "save-interval", required_argument, NULL, OPT_INTERVAL },
+    { "background", required_argument, NULL, OPT_BACKGROUND },
+    { "output-format", required_argument, NULL, OPT_FORMAT },
+    { "marginals", required_argument, NULL, OPT_MARGINALS },
+    { "compression", required_argument, NULL, OPT_FILTER },
+    { "shuffle", required_argument, NULL, OPT_SHUFFLE },
+    { "chunk-size", required_argument, NULL, OPT_CHUNK },
+    { "threads", required_argument, NULL, OPT_THREADS },
+    { "max-memory", required_argument, NULL, OPT_MEMORY },
+    { "scratch", required_argument, NULL, OPT_SCRATCH },
+    { "metrics", required_argument, NULL, OPT_METRICS },
+    { "status", required_argument, NULL, OPT_STATUS },
+    { "trace", required_argument, NULL, OPT_TRACE },
+    { "layout", required_argument, NULL, OPT_LAYOUT },
+    { "auto-range", required_argument, NULL, OPT_AUTORANGE },
+    { "small-files", required_argument, NULL, OPT_SMALL },
+    { "group-by", required_argument, NULL, OPT_GROUPBY },
+    { "sample", required_argument, NULL, OPT_SAMPLE },
+    { "preview", required_argument, NULL, OPT_PREVIEW },
+    { "moments", required_argument, NULL, OPT_MOMENTS },
     
     { "dataset", required_argument, NULL, OPT_DATASET },
     { "member", required_argument, NULL, OPT_MEMBER },
@@ -95,9 +172,106 @@ options_prep (
       case OPT_OUTPUT:
         options->output = optarg;
         break;
+      case OPT_JOBS:
+        options->jobs = optarg;
+        break;
       case OPT_SAVEVERY:
         options->savevery = (size_t) atoi (optarg);
         break;
+      case OPT_INTERVAL:
+        options->interval = atof (optarg);
+        break;
+      case OPT_BACKGROUND:
+        options->background = strtobool (optarg);
+        break;
+      case OPT_FORMAT:
+        if (parse_format (& options->format, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: unknown output format `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_MARGINALS:
+        if (parse_marginals (& options->marginals, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: cannot parse marginal orders `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_FILTER:
+        if (parse_filter (& options->filter, & options->level, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: compression `%s' is unknown or not available.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_SHUFFLE:
+        options->shuffle = strtobool (optarg);
+        break;
+      case OPT_CHUNK:
+        options->chunk = (strcasecmp (optarg, "auto") == 0) ? 0 : (size_t) strtoul (optarg, NULL, 10);
+        break;
+      case OPT_THREADS:
+        options->nthreads = (size_t) atoi (optarg);
+        break;
+      case OPT_MEMORY:
+        if (parse_size (& options->max_memory, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: cannot parse memory budget `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_SCRATCH:
+        options->scratch = optarg;
+        break;
+      case OPT_METRICS:
+        options->metrics = optarg;
+        break;
+      case OPT_STATUS:
+        options->status = optarg;
+        break;
+      case OPT_TRACE:
+        options->trace = optarg;
+        break;
+      case OPT_LAYOUT:
+        options->layout = optarg;
+        break;
+      case OPT_GROUPBY:
+        options->group = optarg;
+        break;
+      case OPT_MOMENTS:
+        options->moments = strtobool (optarg);
+        break;
+      case OPT_SAMPLE:
+      case OPT_PREVIEW:
+        options->preview = optchar == OPT_PREVIEW;
+        if (parse_sample (options, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: cannot parse sample fraction `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_SMALL:
+        if (parse_size (& options->small, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: cannot parse small file size `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_AUTORANGE:
+        if (parse_range (options, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: cannot parse automatic range `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, PACKAGE_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
       
       case OPT_DATASET:
         if (ndataset++ < NDATASET_MAX)
@@ -221,6 +395,17 @@ options_prep (
         exit (EXIT_FAILURE);
     }
   
+  return (ndataset);
+}
+
+void
+options_prep (
+  options_t * const options,
+  int argc, char * const argv[]
+)
+{
+  const size_t ndataset = options_parse (options, argc, argv);
+  
   if (optind < argc)
   {
     if (options->ninput == 1)
@@ -246,6 +431,94 @@ options_prep (
                      "try '%s --help' for more information\n", PACKAGE_NAME);
     exit (EXIT_FAILURE);
   }
+  
+  /* records of a stream are read once, in order */
+  if (options->sample > 0. && options->layout)
+  {
+    fprintf (stderr, "fatal: samples and previews are not available with streams.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* the limits are chosen from a pass over the files before the first is binned */
+  if (options->autorange && (options->jobs || options->layout))
+  {
+    fprintf (stderr, "fatal: automatic ranges are not available with job files or streams.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* the histograms themselves are specified in the job file */
+  if (options->jobs)
+  {
+    if (ndataset || options->output)
+    {
+      fprintf (stderr, "fatal: datasets and output must be given in the job file.\n"
+                       "try '%s --help' for more information\n", PACKAGE_NAME);
+      exit (EXIT_FAILURE);
+    }
+    return;
+  }
+  
+  options_merge (options, ndataset);
+}
+
+static void
+options_group (
+  options_t * const options
+)
+{
+  size_t n;
+  
+  /* spilled runs are merged over all axes and the moments are taken over all rows, neither is split by key */
+  if (options->max_memory || options->moments)
+  {
+    fprintf (stderr, "fatal: grouped histograms are not available with a memory budget or moments.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  if (! options->member[0])
+    return;
+  
+  /* the key is a leading axis of the first dataset with one bin per integer and no limits */
+  n = options->dim[0]++;
+  options->member[0] = realloc (options->member[0], options->dim[0] * sizeof (* options->member[0]));
+  memmove (& options->member[0][1], options->member[0], n * sizeof (* options->member[0]));
+  options->member[0][0] = options->group;
+  
+  if (! options->binning[0] && options->autorange)
+    options->binning[0] = calloc (n, sizeof (* options->binning[0]));
+  if (options->binning[0])
+  {
+    options->binning[0] = realloc (options->binning[0], options->dim[0] * sizeof (* options->binning[0]));
+    memmove (& options->binning[0][1], options->binning[0], n * sizeof (* options->binning[0]));
+    options->binning[0][0] = 1.;
+  }
+  
+  if (options->limit_l[0] && options->limit_u[0])
+  {
+    options->limit_l[0] = realloc (options->limit_l[0], options->dim[0] * sizeof (* options->limit_l[0]));
+    options->limit_u[0] = realloc (options->limit_u[0], options->dim[0] * sizeof (* options->limit_u[0]));
+    memmove (& options->limit_l[0][1], options->limit_l[0], n * sizeof (* options->limit_l[0]));
+    memmove (& options->limit_u[0][1], options->limit_u[0], n * sizeof (* options->limit_u[0]));
+    options->limit_l[0][0] = - DBL_MAX;
+    options->limit_u[0][0] = DBL_MAX;
+  }
+  
+  if (options->l10[0])
+  {
+    options->l10[0] = realloc (options->l10[0], options->dim[0] * sizeof (* options->l10[0]));
+    memmove (& options->l10[0][1], options->l10[0], n * sizeof (* options->l10[0]));
+    options->l10[0][0] = 0;
+  }
+}
+
+static void
+options_merge (
+  options_t * const options,
+  const size_t ndataset
+)
+{
   if (! options->output)
   {
     fprintf (stderr, "fatal: no output filename specified.\n"
@@ -264,6 +537,9 @@ options_prep (
     size_t i, j, k;
     double l, u;
     
+    if (options->group)
+      options_group (options);
+    
     for (i = 0, options->dim_merged = 0; i < ndataset; i++)
       options->dim_merged += options->dim[i];
     
@@ -279,6 +555,8 @@ options_prep (
     
     options->l10_merged = malloc (options->dim_merged * sizeof (* options->l10_merged));
     
+    options->auto_merged = options->autorange ? calloc (options->dim_merged, sizeof (* options->auto_merged)) : NULL;
+    
     for (i = 0, j = 0; i < ndataset; i++)
     {
       if (! options->member[i])
@@ -290,6 +568,9 @@ options_prep (
       else
         memcpy (& options->member_merged[j], options->member[i], options->dim[i] * sizeof (* options->member_merged));
       
+      /* missing bin sizes are left to the automatic range */
+      if (! options->binning[i] && options->autorange)
+        options->binning[i] = calloc (options->dim[i], sizeof (* options->binning[i]));
       if (! options->binning[i])
       {
         fprintf (stderr, "fatal: no binning specified.\n"
@@ -317,7 +598,8 @@ options_prep (
           options->limit_idu_merged[j + k] = LONG_MAX;
         }
         
-        fprintf (stderr, "warning: no limits given, assuming infinite interval.\n");
+        if (! options->autorange)
+          fprintf (stderr, "warning: no limits given, assuming infinite interval.\n");
       }
       else
       {
@@ -328,28 +610,26 @@ options_prep (
         {
           l = options->limit_l[i][k];
           u = options->limit_u[i][k];
-          if (options->l10[i])
+          /* the key of the groups takes every integer */
+          if (options->group && ! i && ! k)
           {
-            if (options->l10[i][k] == 1)
-            {
-              if (l > 0 && u > 0)
-              {
-                l = log10 (l);
-                u = log10 (u);
-              }
-              else if (l < 0 && u < 0)
-              {
-                double tmp = l;
-                l = log10 (- u);
-                u = log10 (- tmp);
-              }
-              else
-              {
-                fprintf (stderr, "fatal: limits have different signs or at least one limit is zero.\n"
-                                 "try '%s --help' for more information\n", PACKAGE_NAME);
-                exit (EXIT_FAILURE);
-              }
-            }
+            options->limit_idl_merged[j + k] = LONG_MIN;
+            options->limit_idu_merged[j + k] = LONG_MAX;
+            continue;
+          }
+          /* open limits and missing bin sizes are left to the automatic range */
+          if (options->autorange
+              && (options->binning[i][k] == 0. || l == - DBL_MAX || u == DBL_MAX))
+          {
+            options->limit_idl_merged[j + k] = LONG_MIN;
+            options->limit_idu_merged[j + k] = LONG_MAX;
+            continue;
+          }
+          if (options_limit (& l, & u, options->l10[i] && options->l10[i][k] == 1) == EXIT_FAILURE)
+          {
+            fprintf (stderr, "fatal: limits have different signs or at least one limit is zero.\n"
+                             "try '%s --help' for more information\n", PACKAGE_NAME);
+            exit (EXIT_FAILURE);
           }
           options->limit_idl_merged[j + k] = (long int) floor (l / options->binning[i][k]);
           options->limit_idu_merged[j + k] = (long int) floor (u / options->binning[i][k]);
@@ -366,6 +646,17 @@ options_prep (
       
       j += options->dim[i];
     }
+    
+    /* the marginals of grouped histograms are taken per group */
+    const size_t dim = options->dim_merged - (options->group ? 1 : 0);
+    
+    if (dim < CHAR_BIT * sizeof (options->marginals)
+        && options->marginals >> dim)
+    {
+      fprintf (stderr, "fatal: marginals must be of lower order than the histogram (%lu).\n"
+                       "try '%s --help' for more information\n", dim, PACKAGE_NAME);
+      exit (EXIT_FAILURE);
+    }
   }
 }
 
@@ -399,6 +690,8 @@ options_free (
   free (options->limit_idl_merged);
   free (options->limit_idu_merged);
   free (options->l10_merged);
+  free (options->auto_merged);
+  free (options->spec);
   
   free (options);
 }
@@ -440,11 +733,314 @@ options_write (
   status = H5Sclose (space);
   status = H5Aclose (attr);
   
+  space = H5Screate_simple (1, dims, NULL);
+  attr = H5Acreate (dset, "analyzer lower index", H5T_NATIVE_LONG, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_LONG, options->limit_idl_merged);
+  status = H5Sclose (space);
+  status = H5Aclose (attr);
+  
+  space = H5Screate_simple (1, dims, NULL);
+  attr = H5Acreate (dset, "analyzer upper index", H5T_NATIVE_LONG, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_LONG, options->limit_idu_merged);
+  status = H5Sclose (space);
+  status = H5Aclose (attr);
+  
+  /* the indices of the limits, the extent above may be narrower */
+  space = H5Screate_simple (1, dims, NULL);
+  attr = H5Acreate (dset, "analyzer limit lower index", H5T_NATIVE_LONG, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_LONG, options->limit_idl_given ? options->limit_idl_given : options->limit_idl_merged);
+  status = H5Sclose (space);
+  status = H5Aclose (attr);
+  
+  space = H5Screate_simple (1, dims, NULL);
+  attr = H5Acreate (dset, "analyzer limit upper index", H5T_NATIVE_LONG, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_LONG, options->limit_idu_given ? options->limit_idu_given : options->limit_idu_merged);
+  status = H5Sclose (space);
+  status = H5Aclose (attr);
+  
   space = H5Screate_simple (1, dims, NULL);
   attr = H5Acreate (dset, "analyzer log10", H5T_NATIVE_HBOOL, space, H5P_DEFAULT, H5P_DEFAULT);
   status = H5Awrite (attr, H5T_NATIVE_HBOOL, options->l10_merged);
   status = H5Sclose (space);
   status = H5Aclose (attr);
+  
+  strtype = H5Tcopy (H5T_C_S1);
+  status = H5Tset_size (strtype, H5T_VARIABLE);
+  space = H5Screate (H5S_SCALAR);
+  attr = H5Acreate (dset, "analyzer layout", strtype, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, strtype, & format_name[options->format]);
+  status = H5Sclose (space);
+  status = H5Aclose (attr);
+  status = H5Tclose (strtype);
+  
+  /* the fraction of the rows a preview or sample has binned so far, and its seed */
+  if (options->sampled < 1.)
+  {
+    space = H5Screate (H5S_SCALAR);
+    attr = H5Acreate (dset, "analyzer sampled", H5T_IEEE_F64BE, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_DOUBLE, & options->sampled);
+    status = H5Aclose (attr);
+    attr = H5Acreate (dset, "analyzer sample seed", H5T_STD_U64BE, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_ULONG, & options->seed);
+    status = H5Aclose (attr);
+    status = H5Sclose (space);
+  }
+  
+  /* the member whose values the histograms are grouped by */
+  if (options->group)
+  {
+    strtype = H5Tcopy (H5T_C_S1);
+    status = H5Tset_size (strtype, H5T_VARIABLE);
+    space = H5Screate (H5S_SCALAR);
+    attr = H5Acreate (dset, "analyzer group by", strtype, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, strtype, & options->group);
+    status = H5Sclose (space);
+    status = H5Aclose (attr);
+    status = H5Tclose (strtype);
+  }
+  
+  /* how the automatic range chose the limits and bin sizes */
+  if (options->auto_merged)
+  {
+    size_t i;
+    hbool_t chosen[options->dim_merged];
+    const char * rule = options->nbins ? "count" : "freedman-diaconis";
+    hsize_t dims_q[1] = {2};
+    
+    space = H5Screate_simple (1, dims, NULL);
+    for (i = 0; i < options->dim_merged; i++)
+      chosen[i] = (options->auto_merged[i] & RANGE_LIMITS) != 0;
+    attr = H5Acreate (dset, "analyzer auto limits", H5T_NATIVE_HBOOL, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_HBOOL, chosen);
+    status = H5Aclose (attr);
+    for (i = 0; i < options->dim_merged; i++)
+      chosen[i] = (options->auto_merged[i] & RANGE_BINNING) != 0;
+    attr = H5Acreate (dset, "analyzer auto binning", H5T_NATIVE_HBOOL, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_HBOOL, chosen);
+    status = H5Aclose (attr);
+    status = H5Sclose (space);
+    
+    space = H5Screate_simple (1, dims_q, NULL);
+    attr = H5Acreate (dset, "analyzer auto quantiles", H5T_IEEE_F64BE, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_DOUBLE, options->quantile);
+    status = H5Sclose (space);
+    status = H5Aclose (attr);
+    
+    strtype = H5Tcopy (H5T_C_S1);
+    status = H5Tset_size (strtype, H5T_VARIABLE);
+    space = H5Screate (H5S_SCALAR);
+    attr = H5Acreate (dset, "analyzer auto rule", strtype, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, strtype, & rule);
+    status = H5Sclose (space);
+    status = H5Aclose (attr);
+    status = H5Tclose (strtype);
+  }
+}
+
+options_t **
+options_jobs (
+  const options_t * const options,
+  size_t * const njob
+)
+{
+  FILE * stream;
+  char * line = NULL, * cur;
+  size_t n = 0, lineno = 0;
+  int argc;
+  char ** argv;
+  options_t * job, ** jobs = NULL;
+  
+  if (! (stream = fopen (options->jobs, "r")))
+  {
+    fprintf (stderr, "fatal: job file `%s' could not be opened.\n"
+                     "try '%s --help' for more information\n", options->jobs, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  * njob = 0;
+  while (getline (& line, & n, stream) != -1)
+  {
+    lineno++;
+    
+    /* split the line into arguments, the job keeps the buffer */
+    argv = malloc ((strlen (line) / 2 + 2) * sizeof (* argv));
+    argv[0] = PACKAGE_NAME;
+    for (argc = 1, cur = strtok (line, " \t\r\n"); cur && * cur != '#'; cur = strtok (NULL, " \t\r\n"))
+      argv[argc++] = cur;
+    argv[argc] = NULL;
+    if (argc == 1)
+    {
+      free (argv);
+      continue;
+    }
+    
+    /* global settings are the defaults of every job */
+    job = malloc (sizeof (* job));
+    options_defaults (job);
+    job->savevery = options->savevery;
+    job->interval = options->interval;
+    job->background = options->background;
+    job->format = options->format;
+    job->marginals = options->marginals;
+    job->chunk = options->chunk;
+    job->filter = options->filter;
+    job->level = options->level;
+    job->shuffle = options->shuffle;
+    job->nthreads = options->nthreads;
+    job->max_memory = options->max_memory;
+    job->scratch = options->scratch;
+    job->metrics = options->metrics;
+    job->status = options->status;
+    job->trace = options->trace;
+    job->layout = options->layout;
+    job->group = options->group;
+    job->moments = options->moments;
+    job->spec = line;
+    
+    optind = 0;
+    options_merge (job, options_parse (job, argc, argv));
+    if (optind < argc || job->ninput || job->jobs || job->autorange || job->sample > 0.)
+    {
+      fprintf (stderr, "fatal: job file `%s', line %lu: input files, job files, automatic ranges and samples cannot be given here.\n"
+                       "try '%s --help' for more information\n", options->jobs, lineno, PACKAGE_NAME);
+      exit (EXIT_FAILURE);
+    }
+    free (argv);
+    
+    jobs = realloc (jobs, ++(* njob) * sizeof (* jobs));
+    jobs[* njob - 1] = job;
+    line = NULL;
+    n = 0;
+  }
+  free (line);
+  fclose (stream);
+  
+  if (! * njob)
+  {
+    fprintf (stderr, "fatal: job file `%s' contains no histograms.\n"
+                     "try '%s --help' for more information\n", options->jobs, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  return (jobs);
+}
+
+void
+options_marginal (
+  options_t * const marginal,
+  const options_t * const options,
+  const size_t * const axes, const size_t dim
+)
+{
+  size_t i;
+  
+  /* share everything but the merged axes */
+  * marginal = * options;
+  marginal->dim_merged = dim;
+  marginal->marginals = 0;
+  
+  marginal->member_merged = malloc (dim * sizeof (* marginal->member_merged));
+  marginal->binning_merged = malloc (dim * sizeof (* marginal->binning_merged));
+  marginal->limit_l_merged = malloc (dim * sizeof (* marginal->limit_l_merged));
+  marginal->limit_u_merged = malloc (dim * sizeof (* marginal->limit_u_merged));
+  marginal->limit_idl_merged = malloc (dim * sizeof (* marginal->limit_idl_merged));
+  marginal->limit_idu_merged = malloc (dim * sizeof (* marginal->limit_idu_merged));
+  marginal->l10_merged = malloc (dim * sizeof (* marginal->l10_merged));
+  marginal->auto_merged = options->auto_merged ? malloc (dim * sizeof (* marginal->auto_merged)) : NULL;
+  marginal->limit_idl_given = options->limit_idl_given ? malloc (dim * sizeof (* marginal->limit_idl_given)) : NULL;
+  marginal->limit_idu_given = options->limit_idu_given ? malloc (dim * sizeof (* marginal->limit_idu_given)) : NULL;
+  
+  for (i = 0; i < dim; i++)
+  {
+    marginal->member_merged[i] = options->member_merged[axes[i]];
+    marginal->binning_merged[i] = options->binning_merged[axes[i]];
+    marginal->limit_l_merged[i] = options->limit_l_merged[axes[i]];
+    marginal->limit_u_merged[i] = options->limit_u_merged[axes[i]];
+    marginal->limit_idl_merged[i] = options->limit_idl_merged[axes[i]];
+    marginal->limit_idu_merged[i] = options->limit_idu_merged[axes[i]];
+    marginal->l10_merged[i] = options->l10_merged[axes[i]];
+    if (marginal->auto_merged)
+      marginal->auto_merged[i] = options->auto_merged[axes[i]];
+    if (marginal->limit_idl_given)
+    {
+      marginal->limit_idl_given[i] = options->limit_idl_given[axes[i]];
+      marginal->limit_idu_given[i] = options->limit_idu_given[axes[i]];
+    }
+  }
+}
+
+void
+options_marginal_free (
+  options_t * const marginal
+)
+{
+  free (marginal->member_merged);
+  free (marginal->binning_merged);
+  free (marginal->limit_l_merged);
+  free (marginal->limit_u_merged);
+  free (marginal->limit_idl_merged);
+  free (marginal->limit_idu_merged);
+  free (marginal->l10_merged);
+  free (marginal->auto_merged);
+  free (marginal->limit_idl_given);
+  free (marginal->limit_idu_given);
+}
+
+int
+options_limit (
+  double * const l, double * const u, const bool l10
+)
+{
+  double tmp;
+  
+  /* limits in the space of the bin indices */
+  if (! l10)
+    return EXIT_SUCCESS;
+  if (* l > 0 && * u > 0)
+  {
+    * l = log10 (* l);
+    * u = log10 (* u);
+  }
+  else if (* l < 0 && * u < 0)
+  {
+    tmp = * l;
+    * l = log10 (- * u);
+    * u = log10 (- tmp);
+  }
+  else
+    return EXIT_FAILURE;
+  
+  return EXIT_SUCCESS;
+}
+
+void
+options_write_axis (
+  const options_t * const options,
+  const hid_t dset,
+  const size_t i
+)
+{
+  hid_t space, attr, strtype;
+  herr_t status;
+  
+  strtype = H5Tcopy (H5T_C_S1);
+  status = H5Tset_size (strtype, H5T_VARIABLE);
+  space = H5Screate (H5S_SCALAR);
+  
+  attr = H5Acreate (dset, "member", strtype, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, strtype, & options->member_merged[i]);
+  status = H5Aclose (attr);
+  
+  attr = H5Acreate (dset, "analyzer binning", H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_DOUBLE, & options->binning_merged[i]);
+  status = H5Aclose (attr);
+  
+  attr = H5Acreate (dset, "analyzer log10", H5T_NATIVE_HBOOL, space, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr, H5T_NATIVE_HBOOL, & options->l10_merged[i]);
+  status = H5Aclose (attr);
+  
+  status = H5Sclose (space);
+  status = H5Tclose (strtype);
 }
 
 static size_t
@@ -511,7 +1107,7 @@ parse_binning (
   return EXIT_SUCCESS;
 }
 
-static int
+int
 parse_limit (
   double * const limit_l, double * const limit_u, char * str, const size_t dim
 )
@@ -579,7 +1175,192 @@ parse_l10 (
   return EXIT_SUCCESS;
 }
 
-static bool
+static int
+parse_range (
+  options_t * const options, const char * const str
+)
+{
+  char * str_end;
+  const char * cur = str;
+  
+  /* <lower quantile>,<upper quantile>[,fd|<bins>] */
+  options->quantile[0] = strtod (cur, & str_end);
+  if (str_end == cur || * str_end != ',')
+    return EXIT_FAILURE;
+  cur = str_end + 1;
+  options->quantile[1] = strtod (cur, & str_end);
+  if (str_end == cur || (* str_end != ',' && * str_end != '\0'))
+    return EXIT_FAILURE;
+  if (! (options->quantile[0] >= 0. && options->quantile[0] < options->quantile[1] && options->quantile[1] <= 1.))
+    return EXIT_FAILURE;
+  
+  options->nbins = 0;
+  if (* str_end == ',')
+  {
+    cur = str_end + 1;
+    if (strcasecmp (cur, "fd") != 0)
+    {
+      options->nbins = (size_t) strtoul (cur, & str_end, 10);
+      if (str_end == cur || * str_end != '\0' || ! options->nbins)
+        return EXIT_FAILURE;
+    }
+  }
+  options->autorange = true;
+  
+  return EXIT_SUCCESS;
+}
+
+static int
+parse_sample (
+  options_t * const options, const char * const str
+)
+{
+  char * str_end;
+  const char * cur;
+  
+  /* <fraction>[,<seed>] */
+  options->sample = strtod (str, & str_end);
+  if (str_end == str || (* str_end != ',' && * str_end != '\0'))
+    return EXIT_FAILURE;
+  if (! (options->sample > 0. && options->sample <= 1.))
+    return EXIT_FAILURE;
+  
+  options->seed = 0;
+  if (* str_end == ',')
+  {
+    cur = str_end + 1;
+    options->seed = strtoul (cur, & str_end, 0);
+    if (str_end == cur || * str_end != '\0')
+      return EXIT_FAILURE;
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+int
+parse_format (
+  format_t * const format, const char * const str
+)
+{
+  size_t i;
+  
+  for (i = 0; i < sizeof (format_name) / sizeof (* format_name); i++)
+    if (strcasecmp (str, format_name[i]) == 0)
+    {
+      * format = (format_t) i;
+      return EXIT_SUCCESS;
+    }
+  
+  return EXIT_FAILURE;
+}
+
+int
+parse_filter (
+  filter_t * const filter, int * const level, const char * const str
+)
+{
+  size_t i, l;
+  const char * str_level;
+  char * str_end;
+  
+  l = (str_level = strchr (str, ',')) ? (size_t) (str_level - str) : strlen (str);
+  
+  for (i = 0; i < sizeof (filter_name) / sizeof (* filter_name); i++)
+    if (strlen (filter_name[i]) == l && strncasecmp (str, filter_name[i], l) == 0)
+      break;
+  if (i == sizeof (filter_name) / sizeof (* filter_name))
+    return EXIT_FAILURE;
+#if ! (defined (HAVE_ZSTD_H) && defined (HAVE_LIBZSTD))
+  if (i == FILTER_ZSTD)
+    return EXIT_FAILURE;
+#endif
+#if ! (defined (HAVE_LZ4_H) && defined (HAVE_LIBLZ4))
+  if (i == FILTER_LZ4)
+    return EXIT_FAILURE;
+#endif
+  * filter = (filter_t) i;
+  
+  /* default levels of the respective libraries */
+  if (str_level)
+  {
+    * level = (int) strtol (str_level + 1, & str_end, 10);
+    if (str_end == str_level + 1 || * str_end != '\0')
+      return EXIT_FAILURE;
+  }
+  else
+    * level = (* filter == FILTER_ZSTD) ? 3 : 6;
+  if (* filter == FILTER_DEFLATE && (* level < 0 || * level > 9))
+    return EXIT_FAILURE;
+  
+  return EXIT_SUCCESS;
+}
+
+static int
+parse_size (
+  unsigned long int * const size, const char * const str
+)
+{
+  char * str_end;
+  double value;
+  
+  /* bytes with an optional binary suffix */
+  value = strtod (str, & str_end);
+  if (str_end == str || value < 0.)
+    return EXIT_FAILURE;
+  switch (* str_end)
+  {
+    case 'G': case 'g':
+      value *= 1024.;
+      /* fall through */
+    case 'M': case 'm':
+      value *= 1024.;
+      /* fall through */
+    case 'K': case 'k':
+      value *= 1024.;
+      str_end++;
+      /* fall through */
+    case '\0':
+      break;
+    default:
+      return EXIT_FAILURE;
+  }
+  if (* str_end != '\0' || value >= (double) ULONG_MAX)
+    return EXIT_FAILURE;
+  
+  * size = (unsigned long int) value;
+  
+  return EXIT_SUCCESS;
+}
+
+int
+parse_marginals (
+  unsigned long int * const marginals, char * str
+)
+{
+  char * str_tok, * str_end;
+  long int order;
+  
+  if (strlen (str) == 0)
+    return EXIT_FAILURE;
+  
+  /* bit k is set for marginals of order k */
+  str_tok = strtok (str, ",\0");
+  while (str_tok != NULL)
+  {
+    order = strtol (str_tok, & str_end, 10);
+    if (str_end == str_tok || * str_end != '\0')
+      return EXIT_FAILURE;
+    if (order < 1 || order >= (long int) (CHAR_BIT * sizeof (* marginals)))
+      return EXIT_FAILURE;
+    * marginals |= 1ul << order;
+    
+    str_tok = strtok (NULL, ",\0");
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+bool
 strtobool (
   const char * str
 )
@@ -602,7 +1383,13 @@ print_usage (
     "Usage: %s -d <dsname1> -m <mname1[:mname2...]>\n"
     "  -b <size1[:size2...]> -l <range1[:range2...]>\n"
     "  [-L <boolean1[:boolean2...]>] [-d <dsname2> ...] [-e <number>]\n"
-    "  -o <outfile> <infile1> [<infile2> ...]\n\n"
+    "  [-I <seconds>] [-B <boolean>] [-M <order1[,order2...]>]\n"
+    "  [-f <format>] [-z <filter>] [-s <boolean>] [-c <bytes>] [-t <number>]\n"
+    "  [-x <bytes>] [-S <directory>] [-T <file>] [-U <file>] [-P <file>]\n"
+    "  [-R <layout>] [-A <spec>] [-F <bytes>] [-G <mname>]\n"
+    "  [-q <fraction> | -p <fraction>] [-k <boolean>]\n"
+    "  -o <outfile> <infile1> [<infile2> ...]\n"
+    "   or: %s -j <jobfile> [options] <infile1> [<infile2> ...]\n\n"
     "Mandatory options:\n"
     "  -d, --dataset <dsname>     data set(s) must be specified first\n"
     "  -m, --member <mname>       data set member(s)\n"
@@ -610,15 +1397,63 @@ print_usage (
     "  -l, --limit <range>        histogram limits\n"
     "  -o, --output <outfile>     name the output file\n\n"
     "Optional options:\n"
+    "  -j, --jobs <jobfile>       compute one histogram per line of\n"
+    "                             <jobfile> in a single pass\n"
     "  -e, --save-every <number>  save every <number> of files\n"
-    "                             (default: 1)\n"
+    "                             (default: 1), 0 to disable\n"
+    "  -I, --save-interval <sec>  save every <sec> seconds of wall-clock\n"
+    "                             time (default: 0, disabled)\n"
+    "  -B, --background <boolean> write intermediate saves in a background\n"
+    "                             process (default: true)\n"
+    "  -f, --output-format <fmt>  output layout, dense, sparse or grid\n"
+    "                             (default: dense)\n"
+    "  -M, --marginals <order>    also save all marginals of the given\n"
+    "                             orders, e.g. 1,2 (default: none)\n"
+    "  -z, --compression <f[,n]>  output compression none, deflate, zstd\n"
+    "                             or lz4, at level <n> (default: none)\n"
+    "  -s, --shuffle <boolean>    shuffle bytes before compression\n"
+    "                             (default: false)\n"
+    "  -c, --chunk-size <bytes>   output chunk size, or auto\n"
+    "                             (default: auto)\n"
+    "  -t, --threads <number>     compression threads, 0 for one per CPU\n"
+    "                             (default: 0)\n"
+    "  -x, --max-memory <bytes>   spill the histograms to disk whenever they\n"
+    "                             outgrow <bytes>, k, M or G may follow\n"
+    "                             (default: 0, unlimited)\n"
+    "  -S, --scratch <directory>  directory for spilled runs\n"
+    "                             (default: $TMPDIR or /tmp)\n"
+    "  -T, --metrics <file>       write JSON lines with the timings and\n"
+    "                             sizes of every file and phase to <file>\n"
+    "  -U, --status <file>        keep the progress of the run in <file>\n"
+    "  -P, --trace <file>         write a timeline of the run to <file> in\n"
+    "                             the Chrome trace event format\n"
+    "  -R, --layout <layout>      read the inputs as streams of binary records\n"
+    "                             of the fields name:type[,...], - for stdin\n"
+    "  -A, --auto-range <spec>    choose missing limits from the quantiles\n"
+    "                             q1,q2[,rule] of a sample of the inputs and\n"
+    "                             missing bin sizes by rule, fd for\n"
+    "                             Freedman-Diaconis or a bin count\n"
+    "                             (default rule: fd)\n"
+    "  -F, --small-files <bytes>  read inputs of up to <bytes> whole, ahead\n"
+    "                             of time, and bin them in batches\n"
+    "                             (default: 0, disabled)\n"
+    "  -G, --group-by <mname>     save one histogram per integer value of\n"
+    "                             the member <mname> of the first data set\n"
+    "  -q, --sample <f[,seed]>    bin only a seeded sample of the fraction\n"
+    "                             <f> of the rows, in blocks spread over all\n"
+    "                             files\n"
+    "  -p, --preview <f[,seed]>   bin a sample of the fraction <f> first,\n"
+    "                             then refine it with samples twice as large\n"
+    "                             up to all rows, saving after each\n"
+    "  -k, --moments <boolean>    also save the mean, variance, skewness and\n"
+    "                             covariance of the members (default: false)\n"
     "  -L, --l10 <boolean>        logarithmic transform (default: false)\n\n"
     "Other options:\n"
     "  -h, --help                 print this help message and quit\n"
     "  -V, --version              print version information and quit\n\n"
     "Report bugs to: %s\n"
     "%s home page: <%s>\n",
-    PACKAGE_NAME, PACKAGE_NAME, PACKAGE_BUGREPORT, PACKAGE_NAME, PACKAGE_URL
+    PACKAGE_NAME, PACKAGE_NAME, PACKAGE_NAME, PACKAGE_BUGREPORT, PACKAGE_NAME, PACKAGE_URL
   );
 
   return;
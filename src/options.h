@@ -46,8 +46,29 @@ enum
   
   OPT_INPUT = 'i',
   OPT_OUTPUT = 'o',
+  OPT_JOBS = 'j',
   
   OPT_SAVEVERY = 'e',
+  OPT_INTERVAL = 'I',
+  OPT_BACKGROUND = 'B',
+  OPT_FORMAT = 'f',
+  OPT_MARGINALS = 'M',
+  OPT_FILTER = 'z',
+  OPT_SHUFFLE = 's',
+  OPT_CHUNK = 'c',
+  OPT_THREADS = 't',
+  OPT_MEMORY = 'x',
+  OPT_SCRATCH = 'S',
+  OPT_METRICS = 'T',
+  OPT_STATUS = 'U',
+  OPT_TRACE = 'P',
+  OPT_LAYOUT = 'R',
+  OPT_AUTORANGE = 'A',
+  OPT_SMALL = 'F',
+  OPT_GROUPBY = 'G',
+  OPT_SAMPLE = 'q',
+  OPT_PREVIEW = 'p',
+  OPT_MOMENTS = 'k',
 
   OPT_HELP = 'h',
   OPT_VERSION = 'V'
@@ -69,12 +90,59 @@ options_prep (
   int argc, char * const argv[]
 );
 
+int
+options_limit (
+  double * const l, double * const u, const bool l10
+);
+
+void
+options_write_axis (
+  const options_t * const options,
+  const hid_t dset,
+  const size_t i
+);
+
+options_t **
+options_jobs (
+  const options_t * const options,
+  size_t * const njob
+);
+
 void
 options_write (
   const options_t * const options,
   const hid_t dset
 );
 
+void
+options_marginal (
+  options_t * const marginal,
+  const options_t * const options,
+  const size_t * const axes, const size_t dim
+);
+
+void
+options_marginal_free (
+  options_t * const marginal
+);
+
+static size_t
+options_parse (
+  options_t * const options,
+  int argc, char * const argv[]
+);
+
+static void
+options_group (
+  options_t * const options
+);
+
+static void
+options_merge (
+  options_t * const options,
+  const size_t ndataset
+);
+
 static size_t
 countchar (
   const char * const str, const char what
@@ -90,7 +158,7 @@ parse_binning (
   double * const binning, char * str, const size_t dim
 );
 
-static int
+int
 parse_limit (
   double * const limit_l, double * const limit_u, char * str, const size_t dim
 );
@@ -100,7 +168,37 @@ parse_l10 (
   hbool_t * const l10, char * str, const size_t dim
 );
 
-static bool
+static int
+parse_range (
+  options_t * const options, const char * const str
+);
+
+static int
+parse_sample (
+  options_t * const options, const char * const str
+);
+
+int
+parse_format (
+  format_t * const format, const char * const str
+);
+
+int
+parse_filter (
+  filter_t * const filter, int * const level, const char * const str
+);
+
+static int
+parse_size (
+  unsigned long int * const size, const char * const str
+);
+
+int
+parse_marginals (
+  unsigned long int * const marginals, char * str
+);
+
+bool
 strtobool (
   const char * str
 );
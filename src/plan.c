@@ -0,0 +1,250 @@
+/* plan.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "plan.h"
+
+plan_t *
+plan_alloc (
+  options_t * const options
+)
+{
+  size_t i, j, l, s;
+  options_t ** jobs;
+  column_t column;
+  plan_t * plan;
+  
+  plan = malloc (sizeof (* plan));
+  
+  if (options->jobs)
+    jobs = options_jobs (options, & plan->nspec);
+  else
+  {
+    plan->nspec = 1;
+    jobs = malloc (sizeof (* jobs));
+    jobs[0] = options;
+  }
+  
+  plan->source = malloc (sizeof (* plan->source));
+  options_defaults (plan->source);
+  plan->source->group = options->group;
+  plan->spec = malloc (plan->nspec * sizeof (* plan->spec));
+  plan->ncolumn = 0;
+  plan->column = NULL;
+  
+  for (s = 0; s < plan->nspec; s++)
+  {
+    options_t * const job = jobs[s];
+    
+    plan->spec[s].options = job;
+    plan->spec[s].column = malloc (job->dim_merged * sizeof (* plan->spec[s].column));
+    plan->spec[s].freq = freq_alloc (
+                           0,
+                           job->limit_idl_merged, job->limit_idu_merged,
+                           job->binning_merged,
+                           NULL
+                         );
+    plan->spec[s].spill = options->max_memory ? spill_alloc (options->scratch, s, job->dim_merged) : NULL;
+    plan->spec[s].moments = job->moments ? moments_alloc (job->dim_merged) : NULL;
+    
+    /* members are read once per file, columns are transformed once */
+    for (i = 0, j = 0; i < NDATASET_MAX; i++)
+      if (job->dim[i])
+      {
+        for (l = 0; l < job->dim[i]; l++)
+        {
+          column.dataset = plan_source (plan->source, job->dataset[i], job->member[i][l]);
+          column.member = plan->source->dim[column.dataset] - 1;
+          while (strcmp (plan->source->member[column.dataset][column.member], job->member[i][l]))
+            column.member--;
+          column.l10 = job->l10[i] && job->l10[i][l] == 1;
+          column.sign = (column.l10 && job->limit_l[i] && job->limit_l[i][l] < 0) ? -1. : 1.;
+          column.binning = job->binning[i][l];
+          plan->spec[s].column[j + l] = plan_column (plan, & column);
+        }
+        j += job->dim[i];
+      }
+  }
+  
+  free (jobs);
+  
+  return (plan);
+}
+
+void
+plan_free (
+  plan_t * plan
+)
+{
+  size_t i;
+  
+  for (i = 0; i < plan->nspec; i++)
+  {
+    freq_free (plan->spec[i].freq);
+    if (plan->spec[i].spill)
+      spill_free (plan->spec[i].spill);
+    if (plan->spec[i].moments)
+      moments_free (plan->spec[i].moments);
+    free (plan->spec[i].column);
+    /* jobs read from a job file belong to the plan */
+    if (plan->spec[i].options->spec)
+      options_free (plan->spec[i].options);
+  }
+  for (i = 0; i < NDATASET_MAX; i++)
+    free (plan->source->member[i]);
+  free (plan->source);
+  free (plan->spec);
+  free (plan->column);
+  free (plan);
+}
+
+static size_t
+plan_source (
+  options_t * const source,
+  const char * const dataset, char * const member
+)
+{
+  size_t i, l;
+  
+  for (i = 0; i < NDATASET_MAX && source->dataset[i]; i++)
+    if (! strcmp (source->dataset[i], dataset))
+      break;
+  if (i == NDATASET_MAX)
+  {
+    fprintf (stderr, "fatal: too many datasets.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  source->dataset[i] = (char *) dataset;
+  
+  for (l = 0; l < source->dim[i]; l++)
+    if (! strcmp (source->member[i][l], member))
+      return (i);
+  
+  source->member[i] = realloc (source->member[i], ++source->dim[i] * sizeof (* source->member[i]));
+  source->member[i][l] = member;
+  
+  return (i);
+}
+
+static size_t
+plan_column (
+  plan_t * const plan,
+  const column_t * const column
+)
+{
+  size_t i;
+  
+  for (i = 0; i < plan->ncolumn; i++)
+    if (plan->column[i].dataset == column->dataset
+        && plan->column[i].member == column->member
+        && plan->column[i].l10 == column->l10
+        && plan->column[i].sign == column->sign
+        && plan->column[i].binning == column->binning)
+      return (i);
+  
+  plan->column = realloc (plan->column, ++plan->ncolumn * sizeof (* plan->column));
+  plan->column[i] = * column;
+  
+  return (i);
+}
+
+void
+plan_spill (
+  plan_t * const plan
+)
+{
+  size_t i;
+  
+  /* every histogram is flushed, the budget covers them all */
+  for (i = 0; i < plan->nspec; i++)
+    if (plan->spec[i].spill && (plan->spec[i].freq->first || plan->spec[i].freq->leaves))
+    {
+      spill_run (plan->spec[i].spill, plan->spec[i].freq);
+      printf ("spilled: %s, runs: %lu\n", plan->spec[i].options->output, plan->spec[i].spill->nrun);
+    }
+}
+
+void
+plan_commit (
+  freq_t * const freq,
+  const size_t nsample,
+  const long int * const * const id,
+  const options_t * const options,
+  metrics_t * const metrics
+)
+{
+  size_t i, k;
+  
+  const size_t bc = options->dim_merged;
+  size_t bv[bc], dv[bc];
+  bv[0] = nsample;
+  for (i = 1; i < bc; i++)
+  {
+    bv[i] = 1;
+    dv[i] = 0;
+  }
+  
+  /* building the sample tree counts towards sorting it */
+  metrics_start (metrics, PHASE_SORT);
+  data_t * data;
+  data = data_alloc (bc, bv);
+  
+  for (i = 0; i < bc; i++)
+    for (k = 0; k < nsample; k++)
+    {
+      dv[0] = k;
+      descend (data, i + 1, dv)->id = id[i][k];
+    }
+  
+  data_sort (data);
+  metrics_stop (metrics, PHASE_SORT);
+  
+  metrics_start (metrics, PHASE_ACCUMULATE);
+  freq_accumulate (freq, data);
+  metrics_stop (metrics, PHASE_ACCUMULATE);
+  
+  data_free (data);
+}
+
+void
+plan_transform (
+  long int * const * const id, double * const * const value,
+  const plan_t * const plan,
+  const size_t dataset_length, const size_t compound_member_length,
+  const double * const * const * const * const raw
+)
+{
+  size_t c, k, m;
+  double r;
+  
+  for (c = 0; c < plan->ncolumn; c++)
+  {
+    const column_t * const column = & plan->column[c];
+    
+    for (k = 0; k < dataset_length; k++)
+      for (m = 0; m < compound_member_length; m++)
+      {
+        r = raw[column->dataset][k][column->member][m];
+        if (column->l10)
+          r = log10 (column->sign * r);
+        id[c][k * compound_member_length + m] = (long int) floor (r / column->binning);
+        if (value)
+          value[c][k * compound_member_length + m] = r;
+      }
+  }
+}
@@ -0,0 +1,82 @@
+/* plan.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __plan_h__
+#define __plan_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "structs.h"
+#include "options.h"
+#include "data.h"
+#include "freq.h"
+#include "spill.h"
+#include "moments.h"
+#include "metrics.h"
+
+plan_t *
+plan_alloc (
+  options_t * const options
+);
+
+void
+plan_free (
+  plan_t * plan
+);
+
+static size_t
+plan_source (
+  options_t * const source,
+  const char * const dataset, char * const member
+);
+
+static size_t
+plan_column (
+  plan_t * const plan,
+  const column_t * const column
+);
+
+void
+plan_spill (
+  plan_t * const plan
+);
+
+void
+plan_commit (
+  freq_t * const freq,
+  const size_t nsample,
+  const long int * const * const id,
+  const options_t * const options,
+  metrics_t * const metrics
+);
+
+void
+plan_transform (
+  long int * const * const id, double * const * const value,
+  const plan_t * const plan,
+  const size_t dataset_length, const size_t compound_member_length,
+  const double * const * const * const * const raw
+);
+
+#endif
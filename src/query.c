@@ -0,0 +1,267 @@
+/* query.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "query.h"
+
+int
+main (
+  int argc, char * argv[]
+)
+{
+  int optchar;
+  size_t i, nquery = 0;
+  char * group = NULL, * cache = NULL, ** query = NULL;
+  bool rebuild = false;
+  sat_t * sat;
+  
+  static const char short_options[] = {
+    OPT_BOX, ':',
+    OPT_SLICE, ':',
+    OPT_GROUP, ':',
+    OPT_CACHE, ':',
+    OPT_REBUILD,
+    OPT_HELP,
+    OPT_VERSION,
+    '\0'
+  };
+  static const struct option long_options[] = {
+    { "box", required_argument, NULL, OPT_BOX },
+    { "slice", required_argument, NULL, OPT_SLICE },
+    { "group", required_argument, NULL, OPT_GROUP },
+    { "cache", required_argument, NULL, OPT_CACHE },
+    { "rebuild", no_argument, NULL, OPT_REBUILD },
+    
+    { "help", no_argument, NULL, OPT_HELP },
+    { "version", no_argument, NULL, OPT_VERSION },
+    
+    { NULL, 0, NULL, 0 }
+  };
+  
+  /* queries are answered in the order given, the first character tells them apart */
+  while ((optchar = getopt_long (argc, argv, short_options, long_options, NULL)) != EOF)
+    switch (optchar)
+    {
+      case OPT_BOX:
+      case OPT_SLICE:
+        query = realloc (query, ++nquery * sizeof (* query));
+        query[nquery - 1] = malloc (strlen (optarg) + 2);
+        sprintf (query[nquery - 1], "%c%s", optchar, optarg);
+        break;
+      case OPT_GROUP:
+        group = optarg;
+        break;
+      case OPT_CACHE:
+        cache = optarg;
+        break;
+      case OPT_REBUILD:
+        rebuild = true;
+        break;
+      
+      case OPT_HELP:
+        print_usage ();
+        exit (EXIT_SUCCESS);
+      case OPT_VERSION:
+        print_version ();
+        exit (EXIT_SUCCESS);
+      
+      default:
+        fprintf (stderr, "try '%s --help' for more information\n", QUERY_NAME);
+        exit (EXIT_FAILURE);
+    }
+  
+  if (optind + 1 != argc)
+  {
+    fprintf (stderr, "fatal: exactly one histogram file must be given.\n"
+                     "try '%s --help' for more information\n", QUERY_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  if (! cache)
+    cache = sat_cache (argv[optind], group);
+  
+  if (! (sat = sat_open (argv[optind], group, cache, rebuild)))
+  {
+    fprintf (stderr, "fatal: summed-area table of `%s' could not be opened.\n"
+                     "try '%s --help' for more information\n", argv[optind], QUERY_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  for (i = 0; i < nquery; i++)
+  {
+    if ((query[i][0] == OPT_BOX ? query_box (sat, query[i] + 1) : query_slice (sat, query[i] + 1)) == EXIT_FAILURE)
+    {
+      fprintf (stderr, "fatal: cannot parse query `%s', %lu coordinates expected.\n"
+                       "try '%s --help' for more information\n", query[i] + 1, sat->dim, QUERY_NAME);
+      exit (EXIT_FAILURE);
+    }
+    free (query[i]);
+  }
+  
+  sat_close (sat);
+  free (query);
+  
+  return (EXIT_SUCCESS);
+}
+
+static int
+query_box (
+  const sat_t * const sat, char * str
+)
+{
+  size_t i = 0;
+  char * str_tok, * str_end;
+  long int lo[sat->dim], hi[sat->dim];
+  double l, u;
+  unsigned long int c;
+  
+  /* boxes are widened to the enclosing bin edges */
+  str_tok = strtok (str, ":\0");
+  while (str_tok != NULL && i < sat->dim)
+  {
+    if (! strcmp (str_tok, "*"))
+    {
+      lo[i] = sat->idl[i];
+      hi[i] = sat->idl[i] + (long int) sat->n[i];
+    }
+    else
+    {
+      l = strtod (str_tok, & str_end);
+      if (str_end == str_tok || * str_end != ',')
+        return EXIT_FAILURE;
+      str_tok = str_end + 1;
+      u = strtod (str_tok, & str_end);
+      if (str_end == str_tok || * str_end != '\0')
+        return EXIT_FAILURE;
+      lo[i] = (long int) floor (l / sat->binning[i]);
+      hi[i] = (long int) ceil (u / sat->binning[i]);
+    }
+    
+    ++i;
+    str_tok = strtok (NULL, ":\0");
+  }
+  if (i != sat->dim || str_tok != NULL)
+    return EXIT_FAILURE;
+  
+  c = sat_count (sat, lo, hi);
+  printf ("mass: %.17g, count: %lu, box:", sat->charge ? (double) c / (double) sat->charge : 0., c);
+  for (i = 0; i < sat->dim; i++)
+    printf ("%s%g,%g", i ? ":" : " ", (double) lo[i] * sat->binning[i], (double) hi[i] * sat->binning[i]);
+  printf ("\n");
+  
+  return EXIT_SUCCESS;
+}
+
+static int
+query_slice (
+  const sat_t * const sat, char * str
+)
+{
+  size_t i = 0;
+  char * str_tok, * str_end;
+  bool free_axis[sat->dim];
+  long int lo[sat->dim], hi[sat->dim];
+  double vol = 1., er;
+  
+  str_tok = strtok (str, ":\0");
+  while (str_tok != NULL && i < sat->dim)
+  {
+    if ((free_axis[i] = ! strcmp (str_tok, "*")))
+      lo[i] = sat->idl[i];
+    else
+    {
+      lo[i] = (long int) floor (strtod (str_tok, & str_end) / sat->binning[i]);
+      if (str_end == str_tok || * str_end != '\0')
+        return EXIT_FAILURE;
+    }
+    hi[i] = lo[i] + 1;
+    vol *= sat->binning[i];
+    
+    ++i;
+    str_tok = strtok (NULL, ":\0");
+  }
+  if (i != sat->dim || str_tok != NULL)
+    return EXIT_FAILURE;
+  
+  /* one line per cell: the centres along the free axes, then the density */
+  er = sat->charge ? 1. / ((double) sat->charge * vol) : 0.;
+  for (;;)
+  {
+    for (i = 0; i < sat->dim; i++)
+      if (free_axis[i])
+        printf ("%g ", ((double) lo[i] + .5) * sat->binning[i]);
+    printf ("%.17g\n", (double) sat_count (sat, lo, hi) * er);
+    
+    for (i = sat->dim; i-- > 0;)
+      if (free_axis[i])
+      {
+        if (++lo[i] < sat->idl[i] + (long int) sat->n[i])
+          break;
+        lo[i] = sat->idl[i];
+      }
+    if (i == (size_t) -1)
+      break;
+    for (i = 0; i < sat->dim; i++)
+      hi[i] = lo[i] + 1;
+  }
+  
+  return EXIT_SUCCESS;
+}
+
+static void
+print_usage (
+  void
+)
+{
+  printf (
+    "%s: query saved histograms\n\n"
+    "Usage: %s [-b <range1[:range2...]>] [-s <coord1[:coord2...]>]\n"
+    "  [-g <group>] [-C <cachefile>] [-r] <file>\n\n"
+    "Queries:\n"
+    "  -b, --box <range>          print the probability mass and count in the\n"
+    "                             box lo,hi[:lo,hi...], * for a whole axis\n"
+    "  -s, --slice <coord>        print the density along the axes given as *,\n"
+    "                             at fixed coordinates along the others\n\n"
+    "Optional options:\n"
+    "  -g, --group <group>        query a marginal, e.g. 'marginal 0,1'\n"
+    "  -C, --cache <cachefile>    summed-area table cache\n"
+    "                             (default: <file>.sat)\n"
+    "  -r, --rebuild              rebuild the cache\n\n"
+    "Other options:\n"
+    "  -h, --help                 print this help message and quit\n"
+    "  -V, --version              print version information and quit\n\n"
+    "Report bugs to: %s\n"
+    "%s home page: <%s>\n",
+    QUERY_NAME, QUERY_NAME, PACKAGE_BUGREPORT, PACKAGE_NAME, PACKAGE_URL
+  );
+
+  return;
+}
+
+static void
+print_version (
+  void
+)
+{
+  printf (
+    "%s-%s\n"
+    "Copyright (C) 2015 Torsten Scholak\n",
+    QUERY_NAME, PACKAGE_VERSION
+  );
+
+  return;
+}
@@ -0,0 +1,69 @@
+/* query.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __query_h__
+#define __query_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+
+#include "structs.h"
+#include "sat.h"
+
+#define QUERY_NAME PACKAGE_NAME "-query"
+
+enum
+{
+  OPT_BOX = 'b',
+  OPT_SLICE = 's',
+  OPT_GROUP = 'g',
+  OPT_CACHE = 'C',
+  OPT_REBUILD = 'r',
+  
+  OPT_HELP = 'h',
+  OPT_VERSION = 'V'
+};
+
+static int
+query_box (
+  const sat_t * const sat, char * str
+);
+
+static int
+query_slice (
+  const sat_t * const sat, char * str
+);
+
+static void
+print_usage (
+  void
+);
+
+static void
+print_version (
+  void
+);
+
+#endif
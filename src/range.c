@@ -0,0 +1,165 @@
+/* range.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "range.h"
+
+bool
+range_wanted (
+  const options_t * const options
+)
+{
+  size_t i, k;
+  
+  for (i = 0; i < NDATASET_MAX; i++)
+    for (k = 0; k < options->dim[i]; k++)
+      if (options->group && ! i && ! k)
+        continue;
+      else if (options->binning[i][k] == 0.
+          || options->limit_l[i][k] == - DBL_MAX || options->limit_u[i][k] == DBL_MAX)
+        return (true);
+  
+  return (false);
+}
+
+void
+range_add (
+  sketch_t * const * const sketch,
+  const options_t * const options,
+  const size_t dataset_length, const size_t compound_member_length,
+  double *** const * const raw
+)
+{
+  size_t i, j, k, n, m;
+  double r, sign;
+  
+  /* the samples are sketched in the space of the bin indices */
+  for (i = 0, j = 0; i < NDATASET_MAX; i++)
+    for (k = 0; k < options->dim[i]; k++, j++)
+    {
+      const bool l10 = options->l10[i] && options->l10[i][k] == 1;
+      
+      sign = range_sign (options, i, k);
+      for (n = 0; n < dataset_length; n++)
+        for (m = 0; m < compound_member_length; m++)
+        {
+          r = raw[i][n][k][m];
+          if (l10)
+            r = log10 (sign * r);
+          if (isfinite (r))
+            sketch_add (sketch[j], r);
+        }
+    }
+}
+
+void
+range_apply (
+  options_t * const options,
+  sketch_t * const * const sketch,
+  const double scale
+)
+{
+  size_t i, j, k;
+  double lo, hi, width, iqr;
+  long int idl, idu;
+  
+  for (i = 0, j = 0; i < NDATASET_MAX; i++)
+    for (k = 0; k < options->dim[i]; k++, j++)
+    {
+      const bool l10 = options->l10[i] && options->l10[i][k] == 1;
+      const double sign = range_sign (options, i, k);
+      double * const l = & options->limit_l[i][k], * const u = & options->limit_u[i][k];
+      /* a negative log10 axis runs backwards in the space of the bin indices */
+      const bool auto_lo = (sign > 0.) ? * l == - DBL_MAX : * u == DBL_MAX,
+                 auto_hi = (sign > 0.) ? * u == DBL_MAX : * l == - DBL_MAX,
+                 auto_width = options->binning[i][k] == 0.;
+      
+      /* the key of the groups keeps its integer bins */
+      if ((! auto_lo && ! auto_hi && ! auto_width) || (options->group && ! i && ! k))
+        continue;
+      if (! sketch[j]->n)
+      {
+        fprintf (stderr, "fatal: no finite samples of member `%s' to choose its range from.\n"
+                         "try '%s --help' for more information\n", options->member[i][k], PACKAGE_NAME);
+        exit (EXIT_FAILURE);
+      }
+      
+      lo = auto_lo ? sketch_quantile (sketch[j], options->quantile[0])
+           : ! l10 ? * l : (sign > 0.) ? log10 (* l) : log10 (- * u);
+      hi = auto_hi ? sketch_quantile (sketch[j], options->quantile[1])
+           : ! l10 ? * u : (sign > 0.) ? log10 (* u) : log10 (- * l);
+      
+      /* Freedman-Diaconis on the samples of all inputs, or a fixed count */
+      width = options->binning[i][k];
+      if (auto_width && options->nbins)
+        width = (hi - lo) / (double) options->nbins;
+      else if (auto_width)
+      {
+        iqr = sketch_quantile (sketch[j], 0.75) - sketch_quantile (sketch[j], 0.25);
+        width = 2. * iqr / cbrt (scale * (double) sketch[j]->n);
+      }
+      if (! (width > 0.) || ! isfinite (width))
+        width = (hi > lo) ? (hi - lo) / RANGE_BINS : 1.;
+      
+      /* chosen limits lie on bin edges, the upper one past the quantile */
+      idl = (long int) floor (lo / width);
+      idu = (long int) floor (hi / width) + (auto_hi ? 1 : 0);
+      if (idu <= idl)
+        idu = idl + 1;
+      if (auto_lo)
+        lo = (double) idl * width;
+      if (auto_hi)
+        hi = (double) idu * width;
+      
+      if (! l10)
+      {
+        * l = lo;
+        * u = hi;
+      }
+      else if (sign > 0.)
+      {
+        * l = pow (10., lo);
+        * u = pow (10., hi);
+      }
+      else
+      {
+        * l = - pow (10., hi);
+        * u = - pow (10., lo);
+      }
+      options->binning[i][k] = options->binning_merged[j] = width;
+      options->limit_l_merged[j] = * l;
+      options->limit_u_merged[j] = * u;
+      options->limit_idl_merged[j] = idl;
+      options->limit_idu_merged[j] = idu;
+      options->auto_merged[j] = (auto_lo || auto_hi ? RANGE_LIMITS : RANGE_NONE) | (auto_width ? RANGE_BINNING : RANGE_NONE);
+      
+      printf (
+        "auto range: %s [%g, %g), %ld bins of %g\n",
+        options->member[i][k], * l, * u, idu - idl, width
+      );
+    }
+}
+
+static double
+range_sign (
+  const options_t * const options,
+  const size_t dataset, const size_t member
+)
+{
+  /* as the columns of the plan, the sign of a log10 axis is that of its lower limit */
+  return ((options->limit_l[dataset][member] < 0. && options->limit_l[dataset][member] != - DBL_MAX) ? -1. : 1.);
+}
@@ -0,0 +1,65 @@
+/* range.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __range_h__
+#define __range_h__
+
+#include "global.h"
+
+#include <stdio.h>
+#include <float.h>
+#include <limits.h>
+
+#include <math.h>
+
+#include "structs.h"
+#include "sketch.h"
+
+/* inputs sampled for the automatic range, spread evenly over all */
+#define RANGE_FILES 8
+
+/* bins of an axis whose spread cannot be measured */
+#define RANGE_BINS 100
+
+bool
+range_wanted (
+  const options_t * const options
+);
+
+void
+range_add (
+  sketch_t * const * const sketch,
+  const options_t * const options,
+  const size_t dataset_length, const size_t compound_member_length,
+  double *** const * const raw
+);
+
+void
+range_apply (
+  options_t * const options,
+  sketch_t * const * const sketch,
+  const double scale
+);
+
+static double
+range_sign (
+  const options_t * const options,
+  const size_t dataset, const size_t member
+);
+
+#endif
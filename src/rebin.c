@@ -0,0 +1,782 @@
+/* rebin.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rebin.h"
+
+int
+main (
+  int argc, char * argv[]
+)
+{
+  int optchar;
+  size_t i;
+  char * group = NULL, * factor = NULL, * limit = NULL, * tmp;
+  bool format = false;
+  double crop_l[H5S_MAX_RANK], crop_u[H5S_MAX_RANK];
+  options_t * const options = malloc (sizeof (* options));
+  cells_t * cells;
+  rebin_t rebin;
+  hid_t file_out, root_in, root_out;
+  herr_t status;
+  
+  static const char short_options[] = {
+    OPT_FACTOR, ':',
+    OPT_LIMIT, ':',
+    OPT_GROUP, ':',
+    OPT_OUTPUT, ':',
+    OPT_FORMAT, ':',
+    OPT_FILTER, ':',
+    OPT_SHUFFLE, ':',
+    OPT_CHUNK, ':',
+    OPT_THREADS, ':',
+    OPT_HELP,
+    OPT_VERSION,
+    '\0'
+  };
+  static const struct option long_options[] = {
+    { "factor", required_argument, NULL, OPT_FACTOR },
+    { "limit", required_argument, NULL, OPT_LIMIT },
+    { "group", required_argument, NULL, OPT_GROUP },
+    { "output", required_argument, NULL, OPT_OUTPUT },
+    { "output-format", required_argument, NULL, OPT_FORMAT },
+    { "compression", required_argument, NULL, OPT_FILTER },
+    { "shuffle", required_argument, NULL, OPT_SHUFFLE },
+    { "chunk-size", required_argument, NULL, OPT_CHUNK },
+    { "threads", required_argument, NULL, OPT_THREADS },
+    
+    { "help", no_argument, NULL, OPT_HELP },
+    { "version", no_argument, NULL, OPT_VERSION },
+    
+    { NULL, 0, NULL, 0 }
+  };
+  
+  options_defaults (options);
+  
+  while ((optchar = getopt_long (argc, argv, short_options, long_options, NULL)) != EOF)
+    switch (optchar)
+    {
+      case OPT_FACTOR:
+        factor = optarg;
+        break;
+      case OPT_LIMIT:
+        limit = optarg;
+        break;
+      case OPT_GROUP:
+        group = optarg;
+        break;
+      case OPT_OUTPUT:
+        options->output = optarg;
+        break;
+      case OPT_FORMAT:
+        if (parse_format (& options->format, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: unknown output format `%s'.\n"
+                           "try '%s --help' for more information\n", optarg, REBIN_NAME);
+          exit (EXIT_FAILURE);
+        }
+        format = true;
+        break;
+      case OPT_FILTER:
+        if (parse_filter (& options->filter, & options->level, optarg) == EXIT_FAILURE)
+        {
+          fprintf (stderr, "fatal: compression `%s' is unknown or not available.\n"
+                           "try '%s --help' for more information\n", optarg, REBIN_NAME);
+          exit (EXIT_FAILURE);
+        }
+        break;
+      case OPT_SHUFFLE:
+        options->shuffle = strtobool (optarg);
+        break;
+      case OPT_CHUNK:
+        options->chunk = (strcasecmp (optarg, "auto") == 0) ? 0 : (size_t) strtoul (optarg, NULL, 10);
+        break;
+      case OPT_THREADS:
+        options->nthreads = (size_t) atoi (optarg);
+        break;
+      
+      case OPT_HELP:
+        print_usage ();
+        exit (EXIT_SUCCESS);
+      case OPT_VERSION:
+        print_version ();
+        exit (EXIT_SUCCESS);
+      
+      default:
+        fprintf (stderr, "try '%s --help' for more information\n", REBIN_NAME);
+        exit (EXIT_FAILURE);
+    }
+  
+  if (optind + 1 != argc)
+  {
+    fprintf (stderr, "fatal: exactly one histogram file must be given.\n"
+                     "try '%s --help' for more information\n", REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  if (! options->output)
+  {
+    fprintf (stderr, "fatal: no output file specified.\n"
+                     "try '%s --help' for more information\n", REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  if (! (cells = cells_open (argv[optind], group)))
+  {
+    fprintf (stderr, "fatal: histogram in `%s' could not be read.\n"
+                     "try '%s --help' for more information\n", argv[optind], REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* factors and crop default to the saved binning and limits */
+  rebin.dim = cells->dim;
+  for (i = 0; i < rebin.dim; i++)
+  {
+    rebin.factor[i] = 1;
+    crop_l[i] = - DBL_MAX;
+    crop_u[i] = DBL_MAX;
+  }
+  if (factor && parse_factor (rebin.factor, factor, rebin.dim) == EXIT_FAILURE)
+  {
+    fprintf (stderr, "fatal: cannot parse rebinning factors, one or %lu positive integers expected.\n"
+                     "try '%s --help' for more information\n", rebin.dim, REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  if (limit && parse_limit (crop_l, crop_u, limit, rebin.dim) == EXIT_FAILURE)
+  {
+    fprintf (stderr, "fatal: cannot parse limits, %lu ranges expected.\n"
+                     "try '%s --help' for more information\n", rebin.dim, REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  if (! format && parse_format (& options->format, cells->layout) == EXIT_FAILURE)
+  {
+    fprintf (stderr, "fatal: saved layout `%s' is unknown, specify the output format.\n"
+                     "try '%s --help' for more information\n", cells->layout, REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  options->dim_merged = rebin.dim;
+  options->member_merged = malloc (rebin.dim * sizeof (* options->member_merged));
+  options->binning_merged = malloc (rebin.dim * sizeof (* options->binning_merged));
+  options->limit_l_merged = malloc (rebin.dim * sizeof (* options->limit_l_merged));
+  options->limit_u_merged = malloc (rebin.dim * sizeof (* options->limit_u_merged));
+  options->limit_idl_merged = malloc (rebin.dim * sizeof (* options->limit_idl_merged));
+  options->limit_idu_merged = malloc (rebin.dim * sizeof (* options->limit_idu_merged));
+  options->l10_merged = malloc (rebin.dim * sizeof (* options->l10_merged));
+  
+  rebin.count = false;
+  rebin.format = options->format;
+  rebin.binning = options->binning_merged;
+  rebin.k = 0;
+  rebin.nnz = 0;
+  rebin.fill = 0;
+  rebin.dropped = 0;
+  rebin_range (& rebin, options, cells, crop_l, crop_u);
+  
+  /* ensemble ratio of the coarse cells, the charge is unchanged */
+  rebin.er = (double) cells->charge;
+  for (i = 0; i < rebin.dim; i++)
+    rebin.er *= rebin.binning[i];
+  rebin.er = 1. / rebin.er;
+  
+  /* one plane of coarse cells perpendicular to the first axis is held at a time */
+  rebin.c = calloc (rebin.stride[0], sizeof (* rebin.c));
+  
+  /* readers never see a partially written output file */
+  tmp = malloc (strlen (options->output) + 5);
+  sprintf (tmp, "%s.tmp", options->output);
+  file_out = H5Fcreate (tmp, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  
+  root_in = H5Gopen (cells->file, "/", H5P_DEFAULT);
+  root_out = H5Gopen (file_out, "/", H5P_DEFAULT);
+  status = H5Aiterate2 (root_in, H5_INDEX_NAME, H5_ITER_INC, NULL, rebin_copy, & root_out);
+  status = H5Gclose (root_in);
+  status = H5Gclose (root_out);
+  
+  if (options->format == FORMAT_SPARSE)
+    rebin_sparse (& rebin, file_out, cells, options);
+  else if (options->format == FORMAT_GRID)
+    rebin_grid (& rebin, file_out, cells, options);
+  else
+    rebin_dense (& rebin, file_out, cells, options);
+  
+  status = H5Fclose (file_out);
+  if (rename (tmp, options->output))
+    fprintf (stderr, "warning: could not rename `%s' to `%s'.\n", tmp, options->output);
+  free (tmp);
+  
+  if (rebin.dropped)
+    fprintf (stderr, "warning: %lu counts outside the limits were dropped.\n", rebin.dropped);
+  printf ("saved: %s\n", options->output);
+  
+  free (rebin.c);
+  options_free (options);
+  cells_close (cells);
+  
+  return (EXIT_SUCCESS);
+}
+
+static int
+parse_factor (
+  long int * const factor, char * str, const size_t dim
+)
+{
+  char * str_tok, * str_end;
+  size_t i = 0;
+  
+  str_tok = strtok (str, ":\0");
+  while (str_tok != NULL)
+  {
+    if (i == dim)
+      return EXIT_FAILURE;
+    factor[i] = strtol (str_tok, & str_end, 10);
+    if (str_end == str_tok || * str_end != '\0' || factor[i] < 1)
+      return EXIT_FAILURE;
+    
+    ++i;
+    str_tok = strtok (NULL, ":\0");
+  }
+  
+  /* a single factor applies to every axis */
+  if (i == 1)
+    for (; i < dim; i++)
+      factor[i] = factor[0];
+  
+  return (i == dim) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static long int
+rebin_floor (
+  const long int a, const long int f
+)
+{
+  return (a / f - (a % f < 0));
+}
+
+static long int
+rebin_index (
+  const double x
+)
+{
+  if (x <= (double) LONG_MIN)
+    return (LONG_MIN);
+  if (x >= (double) LONG_MAX)
+    return (LONG_MAX);
+  
+  return ((long int) x);
+}
+
+static void
+rebin_range (
+  rebin_t * const rebin,
+  options_t * const options,
+  const cells_t * const cells,
+  const double * const crop_l, const double * const crop_u
+)
+{
+  size_t i;
+  long int idl, idu, dl, du, lo, hi;
+  double l, u;
+  
+  for (i = 0; i < rebin->dim; i++)
+  {
+    options->member_merged[i] = cells->member[i] ? cells->member[i] : (char *) "";
+    options->binning_merged[i] = (double) rebin->factor[i] * cells->binning[i];
+    options->l10_merged[i] = cells->l10[i];
+    
+    /* cropping never widens the saved limits */
+    options->limit_l_merged[i] = fmax (cells->limit_l[i], crop_l[i]);
+    options->limit_u_merged[i] = fmin (cells->limit_u[i], crop_u[i]);
+    if (options->limit_l_merged[i] >= options->limit_u_merged[i])
+    {
+      fprintf (stderr, "fatal: limits of axis %lu do not overlap the saved limits.\n"
+                       "try '%s --help' for more information\n", i, REBIN_NAME);
+      exit (EXIT_FAILURE);
+    }
+    
+    /* coarse index range, derived from the limits like histogramr does */
+    l = options->limit_l_merged[i];
+    u = options->limit_u_merged[i];
+    if (l == - DBL_MAX && u == DBL_MAX)
+    {
+      idl = LONG_MIN;
+      idu = LONG_MAX;
+    }
+    else
+    {
+      if (options_limit (& l, & u, cells->l10[i]) == EXIT_FAILURE)
+      {
+        fprintf (stderr, "fatal: limits have different signs or at least one limit is zero.\n"
+                         "try '%s --help' for more information\n", REBIN_NAME);
+        exit (EXIT_FAILURE);
+      }
+      idl = rebin_index (floor (l / options->binning_merged[i]));
+      idu = rebin_index (floor (u / options->binning_merged[i]));
+    }
+    
+    /* coarse cells holding saved cells */
+    if (cells->n[i])
+    {
+      dl = rebin_floor (cells->cl[i], rebin->factor[i]);
+      du = rebin_floor (cells->cl[i] + (long int) (cells->n[i] - 1), rebin->factor[i]) + 1;
+    }
+    else
+      dl = du = 0;
+    
+    /* tables cover the limits, or the occupied cells where these are infinite */
+    if (rebin->format == FORMAT_SPARSE)
+    {
+      lo = (idl > dl) ? idl : dl;
+      hi = (idu < du) ? idu : du;
+    }
+    else
+    {
+      lo = idl = (idl == LONG_MIN) ? dl : idl;
+      hi = idu = (idu == LONG_MAX) ? du : idu;
+    }
+    if (hi < lo)
+      hi = lo;
+    
+    options->limit_idl_merged[i] = idl;
+    options->limit_idu_merged[i] = idu;
+    rebin->lo[i] = lo;
+    rebin->m[i] = (hsize_t) ((unsigned long int) hi - (unsigned long int) lo);
+  }
+  
+  for (i = rebin->dim; i-- > 0;)
+  {
+    rebin->stride[i] = (i + 1 < rebin->dim) ? rebin->stride[i + 1] * rebin->m[i + 1] : 1;
+    if (rebin->m[i] && rebin->stride[i] > (HSIZE_UNDEF - 1) / rebin->m[i])
+    {
+      fprintf (stderr, "fatal: histogram has too many cells, specify finite limits or use the sparse format.\n"
+                       "try '%s --help' for more information\n", REBIN_NAME);
+      exit (EXIT_FAILURE);
+    }
+  }
+}
+
+static void
+rebin_add (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  rebin_t * const rebin = ctx;
+  size_t i;
+  long int k = 0;
+  hsize_t p = 0, q;
+  
+  /* coarse cell relative to the table, cells below it wrap around */
+  for (i = 0; i < rebin->dim; i++)
+  {
+    q = (hsize_t) ((unsigned long int) rebin_floor (id[i], rebin->factor[i]) - (unsigned long int) rebin->lo[i]);
+    if (q >= rebin->m[i])
+    {
+      if (! rebin->count)
+        rebin->dropped += c;
+      return;
+    }
+    if (i)
+      p += q * rebin->stride[i];
+    else
+      k = (long int) q;
+  }
+  
+  if (k < rebin->k)
+  {
+    fprintf (stderr, "fatal: saved cells are not in row-major order.\n"
+                     "try '%s --help' for more information\n", REBIN_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  rebin_flush (rebin, k);
+  rebin->c[p] += c;
+}
+
+static void
+rebin_flush (
+  rebin_t * const rebin, const long int until
+)
+{
+  /* planes are complete once the cells have moved past them */
+  while (rebin->k < until)
+  {
+    rebin_plane (rebin);
+    memset (rebin->c, 0, rebin->stride[0] * sizeof (* rebin->c));
+    rebin->k++;
+  }
+}
+
+static void
+rebin_plane (
+  rebin_t * const rebin
+)
+{
+  const size_t dim = rebin->dim;
+  const hsize_t plane = rebin->stride[0];
+  size_t i;
+  hsize_t p, start[H5S_MAX_RANK], count[H5S_MAX_RANK];
+  long int id[H5S_MAX_RANK];
+  double * row;
+  coo_t * const coo = & rebin->coo;
+  
+  if (rebin->count)
+  {
+    for (p = 0; p < plane; p++)
+      if (rebin->c[p])
+        rebin->nnz++;
+    return;
+  }
+  
+  /* the grid slab spans whole chunks along the first axis */
+  if (rebin->format == FORMAT_GRID)
+  {
+    for (p = 0; p < plane; p++)
+      rebin->buf[rebin->fill * plane + p] = (double) rebin->c[p] * rebin->er;
+    if (++rebin->fill == rebin->slab || (hsize_t) rebin->k + 1 == rebin->m[0])
+    {
+      for (i = 0; i < dim; i++)
+      {
+        start[i] = 0;
+        count[i] = rebin->m[i];
+      }
+      start[0] = (hsize_t) rebin->k + 1 - rebin->fill;
+      count[0] = rebin->fill;
+      writer_slab (rebin->writer, start, count, rebin->buf);
+      rebin->fill = 0;
+    }
+    return;
+  }
+  
+  id[0] = rebin->lo[0] + rebin->k;
+  for (i = 1; i < dim; i++)
+    id[i] = rebin->lo[i];
+  
+  for (p = 0; p < plane; p++)
+  {
+    if (rebin->format == FORMAT_SPARSE)
+    {
+      if (rebin->c[p])
+      {
+        for (i = 0; i < dim; i++)
+          coo->id[i * coo->rows + coo->fill] = id[i];
+        coo->c[coo->fill] = rebin->c[p];
+        coo->d[coo->fill] = (double) rebin->c[p] * rebin->er;
+        if (++coo->fill == coo->rows)
+          freq_cooflush (coo);
+      }
+    }
+    else
+    {
+      row = & rebin->block.buf[rebin->block.fill * rebin->block.width];
+      for (i = 0; i < dim; i++)
+        row[i] = ((double) id[i] + .5) * rebin->binning[i];
+      row[dim] = (double) rebin->c[p] * rebin->er;
+      if (++rebin->block.fill == rebin->block.rows)
+        freq_h5flush (& rebin->block);
+    }
+    
+    /* next cell of the plane in row-major order */
+    for (i = dim - 1; i > 0 && ++id[i] == rebin->lo[i] + (long int) rebin->m[i]; i--)
+      id[i] = rebin->lo[i];
+  }
+}
+
+static void
+rebin_dense (
+  rebin_t * const rebin, const hid_t file_out,
+  const cells_t * const cells, const options_t * const options
+)
+{
+  const size_t dim = rebin->dim;
+  hid_t dcpl, dset_out, space_out;
+  hsize_t dims_out[2] = {rebin->m[0] * rebin->stride[0], dim + 1},
+          chunk[2];
+  herr_t status;
+  block_t * const block = & rebin->block;
+  
+  /* set chunking and compression */
+  dcpl = writer_dcpl (2, dims_out, sizeof (double), options, chunk);
+  
+  /* create dataset at its final size */
+  space_out = H5Screate_simple (2, dims_out, NULL);
+  dset_out = H5Dcreate (file_out, "probability density", H5T_IEEE_F64BE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  status = H5Aiterate2 (cells->dset, H5_INDEX_NAME, H5_ITER_INC, NULL, rebin_copy, & dset_out);
+  options_write (options, dset_out);
+  
+  /* the block holds a whole number of chunks */
+  block->writer = writer_open (dset_out, H5T_NATIVE_DOUBLE, chunk, options);
+  block->width = dim + 1;
+  block->rows = FREQ_BLOCK_SIZE / (chunk[0] * block->width * sizeof (* block->buf));
+  block->rows = chunk[0] * (block->rows ? block->rows : 1);
+  if (dims_out[0] < block->rows)
+    block->rows = dims_out[0];
+  block->fill = 0;
+  block->offset = 0;
+  
+  if (block->rows)
+  {
+    block->buf = malloc (block->rows * block->width * sizeof (* block->buf));
+    cells_read (cells, rebin_add, rebin);
+    rebin_flush (rebin, (long int) rebin->m[0]);
+    freq_h5flush (block);
+    free (block->buf);
+  }
+  writer_close (block->writer);
+  
+  status = H5Dclose (dset_out);
+  status = H5Sclose (space_out);
+  status = H5Pclose (dcpl);
+}
+
+static void
+rebin_sparse (
+  rebin_t * const rebin, const hid_t file_out,
+  const cells_t * const cells, const options_t * const options
+)
+{
+  size_t i;
+  char name[255];
+  const size_t dim = rebin->dim;
+  hid_t dcpl, dset_id[dim], dset_c, dset_d, space_out;
+  hsize_t dims_out[1], chunk[1];
+  herr_t status;
+  writer_t * writer_id[dim], * writer_c, * writer_d;
+  coo_t * const coo = & rebin->coo;
+  
+  /* the occupied coarse cells are counted first, datasets have their final size */
+  if (rebin->stride[0] && rebin->m[0])
+  {
+    rebin->count = true;
+    cells_read (cells, rebin_add, rebin);
+    rebin_flush (rebin, (long int) rebin->m[0]);
+    rebin->count = false;
+    rebin->k = 0;
+  }
+  dims_out[0] = rebin->nnz;
+  
+  /* one-dimensional arrays with one entry per occupied bin */
+  dcpl = writer_dcpl (1, dims_out, sizeof (double), options, chunk);
+  space_out = H5Screate_simple (1, dims_out, NULL);
+  
+  /* bin indices and axis metadata */
+  for (i = 0; i < dim; i++)
+  {
+    sprintf (name, "bin index %lu", (unsigned long int) i);
+    dset_id[i] = H5Dcreate (file_out, name, H5T_NATIVE_LONG, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    options_write_axis (options, dset_id[i], i);
+    writer_id[i] = writer_open (dset_id[i], H5T_NATIVE_LONG, chunk, options);
+  }
+  
+  /* counts and densities */
+  dset_c = H5Dcreate (file_out, "count", H5T_NATIVE_ULONG, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  dset_d = H5Dcreate (file_out, "probability density", H5T_NATIVE_DOUBLE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  writer_c = writer_open (dset_c, H5T_NATIVE_ULONG, chunk, options);
+  writer_d = writer_open (dset_d, H5T_NATIVE_DOUBLE, chunk, options);
+  status = H5Aiterate2 (cells->dset, H5_INDEX_NAME, H5_ITER_INC, NULL, rebin_copy, & dset_d);
+  options_write (options, dset_d);
+  
+  /* the block holds a whole number of chunks of every array */
+  coo->writer_id = writer_id;
+  coo->writer_c = writer_c;
+  coo->writer_d = writer_d;
+  coo->dim = dim;
+  coo->rows = FREQ_BLOCK_SIZE / (chunk[0] * (dim + 2) * sizeof (double));
+  coo->rows = chunk[0] * (coo->rows ? coo->rows : 1);
+  if (rebin->nnz < coo->rows)
+    coo->rows = rebin->nnz;
+  coo->fill = 0;
+  coo->offset = 0;
+  
+  if (coo->rows)
+  {
+    coo->id = malloc (coo->rows * dim * sizeof (* coo->id));
+    coo->c = malloc (coo->rows * sizeof (* coo->c));
+    coo->d = malloc (coo->rows * sizeof (* coo->d));
+    cells_read (cells, rebin_add, rebin);
+    rebin_flush (rebin, (long int) rebin->m[0]);
+    freq_cooflush (coo);
+    free (coo->id);
+    free (coo->c);
+    free (coo->d);
+  }
+  
+  for (i = 0; i < dim; i++)
+  {
+    writer_close (writer_id[i]);
+    status = H5Dclose (dset_id[i]);
+  }
+  writer_close (writer_c);
+  writer_close (writer_d);
+  status = H5Dclose (dset_c);
+  status = H5Dclose (dset_d);
+  status = H5Sclose (space_out);
+  status = H5Pclose (dcpl);
+}
+
+static void
+rebin_grid (
+  rebin_t * const rebin, const hid_t file_out,
+  const cells_t * const cells, const options_t * const options
+)
+{
+  size_t i;
+  char name[255];
+  const size_t dim = rebin->dim;
+  hid_t dcpl, dset_out, space_out, dset_axis, space_axis;
+  hsize_t dims_out[dim], chunk[dim], k;
+  double * axis;
+  herr_t status;
+  
+  /* chunks are balanced by halving the longest side first */
+  for (i = 0; i < dim; i++)
+    dims_out[i] = rebin->m[i];
+  dcpl = writer_dcpl (dim, dims_out, sizeof (double), options, chunk);
+  
+  /* create dataset shaped like the bin grid */
+  space_out = H5Screate_simple (dim, dims_out, NULL);
+  dset_out = H5Dcreate (file_out, "probability density", H5T_NATIVE_DOUBLE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  status = H5Aiterate2 (cells->dset, H5_INDEX_NAME, H5_ITER_INC, NULL, rebin_copy, & dset_out);
+  options_write (options, dset_out);
+  
+  /* bin centre coordinates */
+  for (i = 0; i < dim; i++)
+  {
+    axis = malloc ((dims_out[i] ? dims_out[i] : 1) * sizeof (* axis));
+    for (k = 0; k < dims_out[i]; k++)
+      axis[k] = ((double) (rebin->lo[i] + (long int) k) + .5) * rebin->binning[i];
+    
+    sprintf (name, "axis %lu", (unsigned long int) i);
+    space_axis = H5Screate_simple (1, & dims_out[i], NULL);
+    dset_axis = H5Dcreate (file_out, name, H5T_NATIVE_DOUBLE, space_axis, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Dwrite (dset_axis, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, axis);
+    options_write_axis (options, dset_axis, i);
+    status = H5Dclose (dset_axis);
+    status = H5Sclose (space_axis);
+    free (axis);
+  }
+  
+  /* the slab spans whole chunks along the first axis */
+  rebin->writer = writer_open (dset_out, H5T_NATIVE_DOUBLE, chunk, options);
+  rebin->slab = rebin->stride[0] ? FREQ_BLOCK_SIZE / (chunk[0] * rebin->stride[0] * sizeof (* rebin->buf)) : 0;
+  rebin->slab = chunk[0] * (rebin->slab ? rebin->slab : 1);
+  if (rebin->slab > rebin->m[0])
+    rebin->slab = rebin->m[0];
+  
+  if (rebin->slab && rebin->stride[0])
+  {
+    rebin->buf = malloc (rebin->slab * rebin->stride[0] * sizeof (* rebin->buf));
+    cells_read (cells, rebin_add, rebin);
+    rebin_flush (rebin, (long int) rebin->m[0]);
+    free (rebin->buf);
+  }
+  writer_close (rebin->writer);
+  
+  status = H5Dclose (dset_out);
+  status = H5Sclose (space_out);
+  status = H5Pclose (dcpl);
+}
+
+static herr_t
+rebin_copy (
+  hid_t loc, const char * name, const H5A_info_t * info, void * data
+)
+{
+  hid_t attr_in, attr_out, type, space;
+  hssize_t n;
+  void * buf;
+  herr_t status;
+  
+  /* axis descriptions are rewritten for the new binning */
+  if (! strcmp (name, "members") || ! strncmp (name, "analyzer ", 9))
+    return (0);
+  
+  attr_in = H5Aopen (loc, name, H5P_DEFAULT);
+  type = H5Aget_type (attr_in);
+  space = H5Aget_space (attr_in);
+  n = H5Sget_simple_extent_npoints (space);
+  
+  if (H5Tget_class (type) != H5T_REFERENCE)
+  {
+    buf = malloc ((size_t) (n ? n : 1) * H5Tget_size (type));
+    status = H5Aread (attr_in, type, buf);
+    attr_out = H5Acreate (* (const hid_t *) data, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr_out, type, buf);
+    status = H5Aclose (attr_out);
+    if (H5Tdetect_class (type, H5T_VLEN) > 0 || H5Tis_variable_str (type) > 0)
+      status = H5Dvlen_reclaim (type, space, H5P_DEFAULT, buf);
+    free (buf);
+  }
+  
+  status = H5Sclose (space);
+  status = H5Tclose (type);
+  status = H5Aclose (attr_in);
+  
+  return (0);
+}
+
+static void
+print_usage (
+  void
+)
+{
+  printf (
+    "%s: coarsen or crop saved histograms\n\n"
+    "Usage: %s [-r <factor1[:factor2...]>] [-l <range1[:range2...]>]\n"
+    "  [-g <group>] [options] -o <outfile> <infile>\n\n"
+    "Rebinning:\n"
+    "  -r, --factor <factor>      merge this many adjacent bins along each\n"
+    "                             axis, one factor for all axes or one per\n"
+    "                             axis (default: 1)\n"
+    "  -l, --limit <range>        crop to lo,hi along each axis, an empty side\n"
+    "                             keeps the saved limit (default: no crop)\n\n"
+    "Required options:\n"
+    "  -o, --output <outfile>     output file\n\n"
+    "Optional options:\n"
+    "  -g, --group <group>        rebin a marginal, e.g. 'marginal 0,1'\n"
+    "  -f, --output-format <fmt>  output layout, dense, sparse or grid\n"
+    "                             (default: the saved layout)\n"
+    "  -z, --compression <f[,n]>  output compression none, deflate, zstd\n"
+    "                             or lz4, at level <n> (default: none)\n"
+    "  -s, --shuffle <boolean>    shuffle bytes before compression\n"
+    "                             (default: false)\n"
+    "  -c, --chunk-size <bytes>   output chunk size, or auto\n"
+    "                             (default: auto)\n"
+    "  -t, --threads <number>     compression threads, 0 for one per CPU\n"
+    "                             (default: 0)\n\n"
+    "Other options:\n"
+    "  -h, --help                 print this help message and quit\n"
+    "  -V, --version              print version information and quit\n\n"
+    "Report bugs to: %s\n"
+    "%s home page: <%s>\n",
+    REBIN_NAME, REBIN_NAME, PACKAGE_BUGREPORT, PACKAGE_NAME, PACKAGE_URL
+  );
+
+  return;
+}
+
+static void
+print_version (
+  void
+)
+{
+  printf (
+    "%s-%s\n"
+    "Copyright (C) 2015 Torsten Scholak\n",
+    REBIN_NAME, PACKAGE_VERSION
+  );
+
+  return;
+}
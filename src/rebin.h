@@ -0,0 +1,119 @@
+/* rebin.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __rebin_h__
+#define __rebin_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+
+#include "structs.h"
+#include "options.h"
+#include "writer.h"
+#include "freq.h"
+#include "cells.h"
+
+#define REBIN_NAME PACKAGE_NAME "-rebin"
+
+enum
+{
+  OPT_FACTOR = 'r',
+  OPT_GROUP = 'g'
+};
+
+static int
+parse_factor (
+  long int * const factor, char * str, const size_t dim
+);
+
+static long int
+rebin_floor (
+  const long int a, const long int f
+);
+
+static long int
+rebin_index (
+  const double x
+);
+
+static void
+rebin_range (
+  rebin_t * const rebin,
+  options_t * const options,
+  const cells_t * const cells,
+  const double * const crop_l, const double * const crop_u
+);
+
+static void
+rebin_add (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static void
+rebin_flush (
+  rebin_t * const rebin, const long int until
+);
+
+static void
+rebin_plane (
+  rebin_t * const rebin
+);
+
+static void
+rebin_dense (
+  rebin_t * const rebin, const hid_t file_out,
+  const cells_t * const cells, const options_t * const options
+);
+
+static void
+rebin_sparse (
+  rebin_t * const rebin, const hid_t file_out,
+  const cells_t * const cells, const options_t * const options
+);
+
+static void
+rebin_grid (
+  rebin_t * const rebin, const hid_t file_out,
+  const cells_t * const cells, const options_t * const options
+);
+
+static herr_t
+rebin_copy (
+  hid_t loc, const char * name, const H5A_info_t * info, void * data
+);
+
+static void
+print_usage (
+  void
+);
+
+static void
+print_version (
+  void
+);
+
+#endif
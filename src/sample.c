@@ -0,0 +1,140 @@
+/* sample.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sample.h"
+
+size_t
+sample_passes (
+  const options_t * const options
+)
+{
+  size_t n = 1;
+  
+  /* a preview doubles its sample until all rows are binned */
+  if (options->sample > 0. && options->preview)
+    while (sample_bound (options, n - 1) < 1.)
+      n++;
+  
+  return (n);
+}
+
+double
+sample_bound (
+  const options_t * const options,
+  const size_t pass
+)
+{
+  double hi;
+  size_t i;
+  
+  if (! (options->sample > 0.))
+    return (1.);
+  for (i = 0, hi = options->sample; i < pass && hi < 1.; i++)
+    hi *= 2.;
+  
+  return ((hi < 1.) ? hi : 1.);
+}
+
+hsize_t
+sample_block (
+  const hid_t dset
+)
+{
+  hid_t dcpl;
+  hsize_t chunk[1] = {0};
+  herr_t status;
+  
+  /* whole chunks are read, as many as make up a block */
+  dcpl = H5Dget_create_plist (dset);
+  if (H5Pget_layout (dcpl) == H5D_CHUNKED)
+    H5Pget_chunk (dcpl, 1, chunk);
+  status = H5Pclose (dcpl);
+  
+  if (! chunk[0])
+    return (SAMPLE_BLOCK);
+  return (chunk[0] * ((SAMPLE_BLOCK + chunk[0] - 1) / chunk[0]));
+}
+
+hsize_t
+sample_select (
+  const hid_t space,
+  const hsize_t nrow, const hsize_t block,
+  const sample_t * const sample
+)
+{
+  hsize_t b, first = 0, start, count, n = 0;
+  const hsize_t nblock = (nrow + block - 1) / block;
+  const uint64_t key = sample_mix (sample->seed ^ sample_name (sample->name));
+  bool run = false, selected;
+  double u;
+  
+  /* every block has a fixed uniform variate, a pass takes those in [lo, hi) */
+  H5Sselect_none (space);
+  for (b = 0; b <= nblock; b++)
+  {
+    selected = false;
+    if (b < nblock)
+    {
+      u = (double) (sample_mix (key ^ sample_mix (b)) >> 11) * 0x1p-53;
+      selected = u >= sample->lo && u < sample->hi;
+    }
+    if (selected && ! run)
+    {
+      first = b;
+      run = true;
+    }
+    else if (! selected && run)
+    {
+      /* adjacent blocks are read as one hyperslab */
+      start = first * block;
+      count = ((b * block < nrow) ? b * block : nrow) - start;
+      H5Sselect_hyperslab (space, H5S_SELECT_OR, & start, NULL, & count, NULL);
+      n += count;
+      run = false;
+    }
+  }
+  
+  return (n);
+}
+
+static uint64_t
+sample_mix (
+  uint64_t x
+)
+{
+  /* the finaliser of splitmix64 */
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  
+  return (x ^ (x >> 31));
+}
+
+static uint64_t
+sample_name (
+  const char * name
+)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  
+  /* FNV-1a, the sample of a file does not depend on its position in the list */
+  while (* name)
+    h = (h ^ (unsigned char) * name++) * 0x100000001b3ull;
+  
+  return (h);
+}
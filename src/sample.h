@@ -0,0 +1,67 @@
+/* sample.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __sample_h__
+#define __sample_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "structs.h"
+
+/* rows per block of a contiguous dataset, chunked ones are sampled by whole chunks */
+#define SAMPLE_BLOCK 4096
+
+size_t
+sample_passes (
+  const options_t * const options
+);
+
+double
+sample_bound (
+  const options_t * const options,
+  const size_t pass
+);
+
+hsize_t
+sample_block (
+  const hid_t dset
+);
+
+hsize_t
+sample_select (
+  const hid_t space,
+  const hsize_t nrow, const hsize_t block,
+  const sample_t * const sample
+);
+
+static uint64_t
+sample_mix (
+  uint64_t x
+);
+
+static uint64_t
+sample_name (
+  const char * name
+);
+
+#endif
@@ -0,0 +1,297 @@
+/* sat.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sat.h"
+
+sat_t *
+sat_open (
+  const char * const file, const char * const group, const char * const cache,
+  const bool rebuild
+)
+{
+  sat_t * sat;
+  struct stat source;
+  
+  if (stat (file, & source))
+  {
+    fprintf (stderr, "warning: file `%s' could not be opened.\n", file);
+    return (NULL);
+  }
+  if (strlen (group ? group : "") >= sizeof (((sat_header_t *) NULL)->group))
+  {
+    fprintf (stderr, "warning: group name `%s' is too long.\n", group);
+    return (NULL);
+  }
+  
+  /* a valid cache is mapped right away, otherwise it is rebuilt */
+  if (! rebuild && (sat = sat_map (cache, group, & source)))
+    return (sat);
+  if (sat_build (file, group, cache, & source) == EXIT_FAILURE)
+    return (NULL);
+  
+  return (sat_map (cache, group, & source));
+}
+
+void
+sat_close (
+  sat_t * sat
+)
+{
+  munmap (sat->map, sat->size);
+  free (sat);
+  sat = NULL;
+}
+
+char *
+sat_cache (
+  const char * const file, const char * const group
+)
+{
+  size_t i;
+  char * cache;
+  
+  /* the default cache sits next to the histogram, one per group */
+  cache = malloc (strlen (file) + (group ? strlen (group) : 0) + 6);
+  if (group)
+  {
+    sprintf (cache, "%s.%s.sat", file, group);
+    for (i = strlen (file) + 1; cache[i]; i++)
+      if (cache[i] == ' ' || cache[i] == '/')
+        cache[i] = '_';
+  }
+  else
+    sprintf (cache, "%s.sat", file);
+  
+  return (cache);
+}
+
+unsigned long int
+sat_count (
+  const sat_t * const sat,
+  const long int * const lo, const long int * const hi
+)
+{
+  size_t i;
+  unsigned long int mask, c = 0;
+  hsize_t a[sat->dim], b[sat->dim], f;
+  long int l, u;
+  int parity;
+  
+  /* clamp the box to the table, the half-open box [lo, hi) is in bin indices */
+  for (i = 0; i < sat->dim; i++)
+  {
+    l = lo[i] - sat->idl[i];
+    u = hi[i] - sat->idl[i];
+    a[i] = (l < 0) ? 0 : (((hsize_t) l > sat->n[i]) ? sat->n[i] : (hsize_t) l);
+    b[i] = (u < 0) ? 0 : (((hsize_t) u > sat->n[i]) ? sat->n[i] : (hsize_t) u);
+    if (a[i] >= b[i])
+      return (0);
+  }
+  
+  /* inclusion-exclusion over the 2^d corners of the box */
+  for (mask = 0; mask < (1ul << sat->dim); mask++)
+  {
+    for (i = 0, f = 0, parity = 0; i < sat->dim; i++)
+      if (mask & (1ul << i))
+        f += b[i] * sat->stride[i];
+      else
+      {
+        f += a[i] * sat->stride[i];
+        parity ^= 1;
+      }
+    if (parity)
+      c -= sat->sum[f];
+    else
+      c += sat->sum[f];
+  }
+  
+  return (c);
+}
+
+static sat_t *
+sat_map (
+  const char * const cache, const char * const group, const struct stat * const source
+)
+{
+  size_t i;
+  int fd;
+  struct stat st;
+  hsize_t total;
+  void * map;
+  const sat_header_t * header;
+  sat_t * sat;
+  
+  if ((fd = open (cache, O_RDONLY)) < 0)
+    return (NULL);
+  if (fstat (fd, & st) || (size_t) st.st_size < sizeof (* header)
+      || (map = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    close (fd);
+    return (NULL);
+  }
+  close (fd);
+  
+  /* the cache belongs to this very version of the output file */
+  header = map;
+  if (memcmp (header->magic, SAT_MAGIC, sizeof (header->magic))
+      || strncmp (header->group, group ? group : "", sizeof (header->group))
+      || header->source_size != (unsigned long int) source->st_size
+      || header->source_mtime != (long int) source->st_mtim.tv_sec
+      || header->source_mtime_nsec != (long int) source->st_mtim.tv_nsec
+      || header->dim > H5S_MAX_RANK
+      || (size_t) st.st_size < sizeof (* header) + header->dim * (sizeof (long int) + sizeof (hsize_t) + sizeof (double)))
+  {
+    munmap (map, (size_t) st.st_size);
+    return (NULL);
+  }
+  
+  sat = malloc (sizeof (* sat));
+  sat->map = map;
+  sat->size = (size_t) st.st_size;
+  sat->dim = header->dim;
+  sat->charge = header->charge;
+  sat->idl = (const long int *) (header + 1);
+  sat->n = (const hsize_t *) (sat->idl + sat->dim);
+  sat->binning = (const double *) (sat->n + sat->dim);
+  sat->sum = (const unsigned long int *) (sat->binning + sat->dim);
+  
+  for (i = sat->dim, total = 1; i-- > 0;)
+  {
+    sat->stride[i] = total;
+    total *= sat->n[i] + 1;
+  }
+  if ((size_t) ((const char *) (sat->sum + total) - (const char *) map) != sat->size)
+  {
+    sat_close (sat);
+    return (NULL);
+  }
+  
+  return (sat);
+}
+
+static int
+sat_build (
+  const char * const file, const char * const group, const char * const cache,
+  const struct stat * const source
+)
+{
+  size_t i, dim, size;
+  int fd;
+  char * tmp;
+  hsize_t stride[H5S_MAX_RANK], total;
+  void * map;
+  cells_t * cells;
+  sat_header_t * header;
+  sat_fill_t fill;
+  
+  if (! (cells = cells_open (file, group)))
+    return (EXIT_FAILURE);
+  dim = cells->dim;
+  
+  for (i = dim, total = 1; i-- > 0;)
+  {
+    stride[i] = total;
+    if (cells->n[i] + 1 == 0 || total > (HSIZE_UNDEF - 1) / (cells->n[i] + 1) / sizeof (* stride))
+    {
+      fprintf (stderr, "warning: histogram in `%s' has too many cells.\n", file);
+      cells_close (cells);
+      return (EXIT_FAILURE);
+    }
+    total *= cells->n[i] + 1;
+  }
+  size = sizeof (* header) + dim * (sizeof (long int) + sizeof (hsize_t) + sizeof (double)) + total * sizeof (unsigned long int);
+  
+  /* the table is built in place in a temporary file and renamed once complete */
+  tmp = malloc (strlen (cache) + 5);
+  sprintf (tmp, "%s.tmp", cache);
+  if ((fd = open (tmp, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0 || ftruncate (fd, (off_t) size)
+      || (map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    fprintf (stderr, "warning: cache `%s' could not be created.\n", tmp);
+    if (fd >= 0)
+      close (fd);
+    free (tmp);
+    cells_close (cells);
+    return (EXIT_FAILURE);
+  }
+  close (fd);
+  
+  header = map;
+  header->dim = dim;
+  header->charge = cells->charge;
+  header->source_size = (unsigned long int) source->st_size;
+  header->source_mtime = (long int) source->st_mtim.tv_sec;
+  header->source_mtime_nsec = (long int) source->st_mtim.tv_nsec;
+  strncpy (header->group, group ? group : "", sizeof (header->group));
+  memcpy (header + 1, cells->cl, dim * sizeof (long int));
+  memcpy ((long int *) (header + 1) + dim, cells->n, dim * sizeof (hsize_t));
+  memcpy ((hsize_t *) ((long int *) (header + 1) + dim) + dim, cells->binning, dim * sizeof (double));
+  
+  fill.dim = dim;
+  fill.cl = cells->cl;
+  fill.stride = stride;
+  fill.sum = (unsigned long int *) ((double *) ((hsize_t *) ((long int *) (header + 1) + dim) + dim) + dim);
+  if (total > 1)
+  {
+    cells_read (cells, sat_fill, & fill);
+    sat_prefix (fill.sum, dim, stride, cells->n);
+  }
+  
+  memcpy (header->magic, SAT_MAGIC, sizeof (header->magic));
+  msync (map, size, MS_SYNC);
+  munmap (map, size);
+  if (rename (tmp, cache))
+    fprintf (stderr, "warning: could not rename `%s' to `%s'.\n", tmp, cache);
+  free (tmp);
+  
+  cells_close (cells);
+  
+  return (EXIT_SUCCESS);
+}
+
+static void
+sat_fill (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  size_t i;
+  hsize_t f;
+  sat_fill_t * const fill = ctx;
+  
+  /* cells sit behind the zero border */
+  for (i = 0, f = 0; i < fill->dim; i++)
+    f += (hsize_t) (id[i] - fill->cl[i] + 1) * fill->stride[i];
+  fill->sum[f] += c;
+}
+
+static void
+sat_prefix (
+  unsigned long int * const sum, const size_t dim,
+  const hsize_t * const stride, const hsize_t * const n
+)
+{
+  size_t a;
+  hsize_t base, i, k, total = stride[0] * (n[0] + 1);
+  
+  /* one pass of running sums along every axis, the zero border stays untouched */
+  for (a = 0; a < dim; a++)
+    for (base = 0; base < total; base += stride[a] * (n[a] + 1))
+      for (i = 1; i <= n[a]; i++)
+        for (k = 0; k < stride[a]; k++)
+          sum[base + i * stride[a] + k] += sum[base + (i - 1) * stride[a] + k];
+}
@@ -0,0 +1,86 @@
+/* sat.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __sat_h__
+#define __sat_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "structs.h"
+#include "cells.h"
+
+#define SAT_MAGIC "hgrsat1"
+#define SAT_BLOCK_SIZE 16777216
+
+sat_t *
+sat_open (
+  const char * const file, const char * const group, const char * const cache,
+  const bool rebuild
+);
+
+void
+sat_close (
+  sat_t * sat
+);
+
+char *
+sat_cache (
+  const char * const file, const char * const group
+);
+
+unsigned long int
+sat_count (
+  const sat_t * const sat,
+  const long int * const lo, const long int * const hi
+);
+
+static sat_t *
+sat_map (
+  const char * const cache, const char * const group, const struct stat * const source
+);
+
+static int
+sat_build (
+  const char * const file, const char * const group, const char * const cache,
+  const struct stat * const source
+);
+
+static void
+sat_fill (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static void
+sat_prefix (
+  unsigned long int * const sum, const size_t dim,
+  const hsize_t * const stride, const hsize_t * const n
+);
+
+#endif
@@ -0,0 +1,637 @@
+/* save.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "save.h"
+
+void
+save (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  options_t * const options
+)
+{
+  hid_t grp_in, grp_out;
+  herr_t status;
+  long int idl[options->dim_merged], idu[options->dim_merged];
+  
+  /* copy group attributes, histograms filled through the library have no input file */
+  if (file_in >= 0)
+  {
+    grp_in = H5Gopen (file_in, "/", H5P_DEFAULT);
+    grp_out = H5Gopen (file_out, "/", H5P_DEFAULT);
+    copy_attr (grp_in, grp_out, NULL);
+    status = H5Gclose (grp_in);
+    status = H5Gclose (grp_out);
+  }
+  
+  save_narrow (freq, spill, options, idl, idu);
+  if (options->group)
+    save_groups (file_out, file_in, freq, options);
+  else
+  {
+    save_layout (file_out, file_in, freq, spill, options);
+    if (options->marginals)
+      save_marginals (file_out, file_in, freq, spill, options);
+  }
+  save_widen (options, idl, idu);
+}
+
+void
+save_narrow (
+  const freq_t * const freq, const spill_t * const spill,
+  options_t * const options,
+  long int * const idl, long int * const idu
+)
+{
+  size_t i;
+  long int tmp;
+  const size_t dim = options->dim_merged;
+  
+  /* the box of the occupied cells, in the tree and in the spilled runs */
+  for (i = 0; i < dim; i++)
+  {
+    idl[i] = LONG_MAX;
+    idu[i] = LONG_MIN;
+  }
+  freq_extent (freq, dim, idl, idu);
+  if (spill && spill->nrun)
+    for (i = 0; i < dim; i++)
+    {
+      if (spill->lo[i] < idl[i])
+        idl[i] = spill->lo[i];
+      if (spill->hi[i] > idu[i])
+        idu[i] = spill->hi[i];
+    }
+  
+  /* no cell at all, an empty extent at the lower limit */
+  for (i = 0; i < dim; i++)
+    if (idl[i] > idu[i])
+      idl[i] = idu[i] = (options->limit_idl_merged[i] == LONG_MIN) ? 0 : options->limit_idl_merged[i];
+  
+  /* the tree enumerates the index limits of the options, these become the box until save_widen */
+  for (i = 0; i < dim; i++)
+  {
+    tmp = options->limit_idl_merged[i];
+    options->limit_idl_merged[i] = idl[i];
+    idl[i] = tmp;
+    tmp = options->limit_idu_merged[i];
+    options->limit_idu_merged[i] = idu[i];
+    idu[i] = tmp;
+  }
+  options->limit_idl_given = idl;
+  options->limit_idu_given = idu;
+}
+
+void
+save_widen (
+  options_t * const options,
+  long int * const idl, long int * const idu
+)
+{
+  memcpy (options->limit_idl_merged, idl, options->dim_merged * sizeof (* idl));
+  memcpy (options->limit_idu_merged, idu, options->dim_merged * sizeof (* idu));
+  options->limit_idl_given = NULL;
+  options->limit_idu_given = NULL;
+}
+
+void
+save_layout (
+  const hid_t loc_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+)
+{
+  if (options->format == FORMAT_SPARSE)
+    save_sparse (loc_out, file_in, freq, spill, options);
+  else if (options->format == FORMAT_GRID)
+    save_grid (loc_out, file_in, freq, spill, options);
+  else
+    save_dense (loc_out, file_in, freq, spill, options);
+}
+
+void
+save_marginals (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+)
+{
+  const size_t dim = options->dim_merged;
+  size_t i, j, k, n, nmarg = 0;
+  size_t axes[dim], * dim_marg = NULL, ** axes_marg = NULL;
+  char * name;
+  hid_t grp_out, space, attr;
+  hsize_t dims[1];
+  herr_t status;
+  freq_t ** marg = NULL;
+  options_t * options_marg = NULL;
+  
+  /* enumerate the axis combinations of all requested orders */
+  for (k = 1; k < dim; k++)
+  {
+    if (! (options->marginals & (1ul << k)))
+      continue;
+    for (i = 0; i < k; i++)
+      axes[i] = i;
+    for (;;)
+    {
+      n = nmarg++;
+      dim_marg = realloc (dim_marg, nmarg * sizeof (* dim_marg));
+      axes_marg = realloc (axes_marg, nmarg * sizeof (* axes_marg));
+      marg = realloc (marg, nmarg * sizeof (* marg));
+      options_marg = realloc (options_marg, nmarg * sizeof (* options_marg));
+      
+      dim_marg[n] = k;
+      axes_marg[n] = malloc (k * sizeof (* axes_marg[n]));
+      memcpy (axes_marg[n], axes, k * sizeof (* axes));
+      options_marginal (& options_marg[n], options, axes, k);
+      marg[n] = freq_alloc (
+                  0,
+                  options_marg[n].limit_idl_merged, options_marg[n].limit_idu_merged,
+                  options_marg[n].binning_merged,
+                  NULL
+                );
+      
+      for (i = k; i > 0 && axes[i - 1] == dim - k + i - 1; i--)
+        ;
+      if (! i)
+        break;
+      axes[i - 1]++;
+      for (j = i; j < k; j++)
+        axes[j] = axes[j - 1] + 1;
+    }
+  }
+  
+  if (spill && spill->nrun)
+    spill_marginals (marg, (const size_t * const *) axes_marg, dim_marg, nmarg, spill, freq);
+  else
+    freq_marginals (marg, (const size_t * const *) axes_marg, dim_marg, nmarg, freq, dim);
+  
+  /* every marginal is saved like the joint histogram, in a group of its own */
+  name = malloc (dim * 21 + 10);
+  for (n = 0; n < nmarg; n++)
+  {
+    j = sprintf (name, "marginal ");
+    for (i = 0; i < dim_marg[n]; i++)
+      j += sprintf (& name[j], i ? ",%lu" : "%lu", axes_marg[n][i]);
+    grp_out = H5Gcreate (file_out, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    
+    dims[0] = dim_marg[n];
+    space = H5Screate_simple (1, dims, NULL);
+    attr = H5Acreate (grp_out, "analyzer axes", H5T_NATIVE_ULONG, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_ULONG, axes_marg[n]);
+    status = H5Aclose (attr);
+    status = H5Sclose (space);
+    
+    save_layout (grp_out, file_in, marg[n], NULL, & options_marg[n]);
+    status = H5Gclose (grp_out);
+    
+    freq_free (marg[n]);
+    options_marginal_free (& options_marg[n]);
+    free (axes_marg[n]);
+  }
+  
+  free (name);
+  free (marg);
+  free (options_marg);
+  free (axes_marg);
+  free (dim_marg);
+}
+
+void
+save_groups (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq,
+  const options_t * const options
+)
+{
+  size_t i;
+  const size_t dim = options->dim_merged;
+  size_t axes[dim];
+  char name[32];
+  hid_t grp_out, space, attr;
+  herr_t status;
+  const freq_t * cur;
+  options_t options_group;
+  
+  /* the groups share the box of all occupied cells, so their histograms line up */
+  for (i = 1; i < dim; i++)
+    axes[i - 1] = i;
+  options_marginal (& options_group, options, axes, dim - 1);
+  options_group.marginals = options->marginals;
+  
+  /* below the key, every node is the tree of a histogram of the other axes, normalised on its own */
+  for (cur = freq->first; cur; cur = cur->next)
+  {
+    sprintf (name, "group %ld", cur->id);
+    grp_out = H5Gcreate (file_out, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    
+    space = H5Screate (H5S_SCALAR);
+    attr = H5Acreate (grp_out, "analyzer group", H5T_NATIVE_LONG, space, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Awrite (attr, H5T_NATIVE_LONG, & cur->id);
+    status = H5Aclose (attr);
+    status = H5Sclose (space);
+    
+    save_layout (grp_out, file_in, cur, NULL, & options_group);
+    if (options_group.marginals)
+      save_marginals (grp_out, file_in, cur, NULL, & options_group);
+    status = H5Gclose (grp_out);
+  }
+  
+  options_marginal_free (& options_group);
+}
+
+void
+save_attr (
+  const hid_t dset_out, const hid_t file_in,
+  const freq_t * const freq,
+  const options_t * const options
+)
+{
+  size_t i;
+  hid_t space_charge, attr_charge;
+  hsize_t dims_charge[1] = {1};
+  herr_t status;
+  
+  /* copy attributes */
+  for (i = 0; i < NDATASET_MAX; i++)
+  {
+    if (options->dim[i] && file_in >= 0)
+    {
+      hid_t dset_in;
+      
+      dset_in = H5Dopen (file_in, options->dataset[i], H5P_DEFAULT);
+      copy_attr (dset_in, dset_out, options->dataset[i]);
+      status = H5Dclose (dset_in);
+    }
+  }
+  
+  /* write options */
+  options_write (options, dset_out);
+  
+  space_charge = H5Screate_simple (1, dims_charge, NULL);
+  attr_charge = H5Acreate (dset_out, "charge", H5T_STD_U64BE, space_charge, H5P_DEFAULT, H5P_DEFAULT);
+  status = H5Awrite (attr_charge, H5T_NATIVE_ULONG, & freq->c);
+  status = H5Sclose (space_charge);
+  status = H5Aclose (attr_charge);
+}
+
+void
+save_dense (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+)
+{
+  hid_t dcpl, dset_out, space_out;
+  hsize_t dims_out[2] = {freq_rows (freq, options->dim_merged), options->dim_merged + 1},
+          chunk[2];
+  herr_t status;
+  writer_t * writer;
+  
+  if (dims_out[0] == HSIZE_UNDEF)
+  {
+    fprintf (stderr, "fatal: histogram has too many cells, specify finite limits or use the sparse format.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* set chunking and compression */
+  dcpl = writer_dcpl (2, dims_out, sizeof (double), options, chunk);
+  
+  /* create dataset at its final size */
+  space_out = H5Screate_simple (2, dims_out, NULL);
+  dset_out = H5Dcreate (file_out, "probability density", H5T_IEEE_F64BE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  
+  save_attr (dset_out, file_in, freq, options);
+  
+  writer = writer_open (dset_out, H5T_NATIVE_DOUBLE, chunk, options);
+  if (spill && spill->nrun)
+    spill_save (
+      writer,
+      spill,
+      freq
+    );
+  else
+    freq_save (
+      writer,
+      freq,
+      options->dim_merged
+    );
+  writer_close (writer);
+  
+  status = H5Dclose (dset_out);
+  status = H5Sclose (space_out);
+  status = H5Pclose (dcpl);
+}
+
+void
+save_sparse (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+)
+{
+  size_t i;
+  char name[255];
+  hid_t dcpl, dset_id[options->dim_merged], dset_c, dset_d, space_out;
+  hsize_t dims_out[1] = {(spill && spill->nrun) ? spill_leaves (spill, freq) : freq_leaves (freq, options->dim_merged)},
+          chunk[1];
+  herr_t status;
+  writer_t * writer_id[options->dim_merged], * writer_c, * writer_d;
+  
+  /* one-dimensional arrays with one entry per occupied bin */
+  dcpl = writer_dcpl (1, dims_out, sizeof (double), options, chunk);
+  space_out = H5Screate_simple (1, dims_out, NULL);
+  
+  /* bin indices and axis metadata */
+  for (i = 0; i < options->dim_merged; i++)
+  {
+    sprintf (name, "bin index %lu", (unsigned long int) i);
+    dset_id[i] = H5Dcreate (file_out, name, H5T_NATIVE_LONG, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    options_write_axis (options, dset_id[i], i);
+    writer_id[i] = writer_open (dset_id[i], H5T_NATIVE_LONG, chunk, options);
+  }
+  
+  /* counts and densities */
+  dset_c = H5Dcreate (file_out, "count", H5T_NATIVE_ULONG, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  dset_d = H5Dcreate (file_out, "probability density", H5T_NATIVE_DOUBLE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  writer_c = writer_open (dset_c, H5T_NATIVE_ULONG, chunk, options);
+  writer_d = writer_open (dset_d, H5T_NATIVE_DOUBLE, chunk, options);
+  
+  save_attr (dset_d, file_in, freq, options);
+  
+  if (spill && spill->nrun)
+    spill_save_sparse (
+      writer_id, writer_c, writer_d,
+      spill,
+      freq
+    );
+  else
+    freq_save_sparse (
+      writer_id, writer_c, writer_d,
+      freq,
+      options->dim_merged
+    );
+  
+  for (i = 0; i < options->dim_merged; i++)
+  {
+    writer_close (writer_id[i]);
+    status = H5Dclose (dset_id[i]);
+  }
+  writer_close (writer_c);
+  writer_close (writer_d);
+  status = H5Dclose (dset_c);
+  status = H5Dclose (dset_d);
+  status = H5Sclose (space_out);
+  status = H5Pclose (dcpl);
+}
+
+void
+save_grid (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+)
+{
+  size_t i;
+  char name[255];
+  const size_t dim = options->dim_merged;
+  hid_t dcpl, dset_out, space_out, dset_axis, space_axis;
+  hsize_t dims_out[dim], chunk[dim];
+  long int id;
+  double * axis;
+  herr_t status;
+  writer_t * writer;
+  
+  if (freq_rows (freq, dim) == HSIZE_UNDEF)
+  {
+    fprintf (stderr, "fatal: histogram has too many cells, specify finite limits or use the sparse format.\n"
+                     "try '%s --help' for more information\n", PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* chunks are balanced by halving the longest side first */
+  for (i = 0; i < dim; i++)
+    dims_out[i] = (hsize_t) (freq->idu[i] - freq->idl[i]);
+  dcpl = writer_dcpl (dim, dims_out, sizeof (double), options, chunk);
+  
+  /* create dataset shaped like the bin grid */
+  space_out = H5Screate_simple (dim, dims_out, NULL);
+  dset_out = H5Dcreate (file_out, "probability density", H5T_NATIVE_DOUBLE, space_out, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  
+  save_attr (dset_out, file_in, freq, options);
+  
+  /* bin centre coordinates */
+  for (i = 0; i < dim; i++)
+  {
+    axis = malloc ((dims_out[i] ? dims_out[i] : 1) * sizeof (* axis));
+    for (id = freq->idl[i]; id < freq->idu[i]; id++)
+      axis[id - freq->idl[i]] = ((double) id + .5) * freq->binning[i];
+    
+    sprintf (name, "axis %lu", (unsigned long int) i);
+    space_axis = H5Screate_simple (1, & dims_out[i], NULL);
+    dset_axis = H5Dcreate (file_out, name, H5T_NATIVE_DOUBLE, space_axis, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    status = H5Dwrite (dset_axis, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, axis);
+    options_write_axis (options, dset_axis, i);
+    status = H5Dclose (dset_axis);
+    status = H5Sclose (space_axis);
+    free (axis);
+  }
+  
+  writer = writer_open (dset_out, H5T_NATIVE_DOUBLE, chunk, options);
+  if (spill && spill->nrun)
+    spill_save_grid (
+      writer,
+      spill,
+      freq
+    );
+  else
+    freq_save_grid (
+      writer,
+      freq,
+      dim
+    );
+  writer_close (writer);
+  
+  status = H5Dclose (dset_out);
+  status = H5Sclose (space_out);
+  status = H5Pclose (dcpl);
+}
+
+void
+save_atomic (
+  const hid_t file_in,
+  const plan_t * const plan,
+  metrics_t * const metrics
+)
+{
+  size_t i;
+  char * tmp;
+  hid_t file_out;
+  herr_t status;
+  
+  for (i = 0; i < plan->nspec; i++)
+  {
+    options_t * const options = plan->spec[i].options;
+    
+    metrics_start (metrics, PHASE_SAVE);
+    
+    /* readers never see a partially written output file */
+    tmp = malloc (strlen (options->output) + 5);
+    sprintf (tmp, "%s.tmp", options->output);
+    file_out = H5Fcreate (tmp, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    save (file_out, file_in, plan->spec[i].freq, plan->spec[i].spill, options);
+    if (plan->spec[i].moments)
+      moments_save (file_out, plan->spec[i].moments, options);
+    status = H5Fclose (file_out);
+    if (rename (tmp, options->output))
+      fprintf (stderr, "warning: could not rename `%s' to `%s'.\n", tmp, options->output);
+    free (tmp);
+    
+    metrics_stop (metrics, PHASE_SAVE);
+    metrics_save (metrics, options->output, plan->spec[i].freq->c);
+    printf ("saved: %s\n", options->output);
+  }
+}
+
+pid_t
+save_background (
+  const hid_t file_in,
+  const plan_t * const plan,
+  metrics_t * const metrics
+)
+{
+  pid_t pid;
+  
+  fflush (stdout);
+  fflush (stderr);
+  
+  /* the child saves a copy-on-write image of the histograms */
+  if ((pid = fork ()) == 0)
+  {
+    metrics_fork (metrics);
+    save_atomic (file_in, plan, metrics);
+    fflush (stdout);
+    _exit (EXIT_SUCCESS);
+  }
+  else if (pid < 0)
+  {
+    fprintf (stderr, "warning: could not start background save, saving in the foreground.\n");
+    save_atomic (file_in, plan, metrics);
+    return (0);
+  }
+  
+  return (pid);
+}
+
+pid_t
+save_reap (
+  const pid_t pid,
+  const bool block
+)
+{
+  int wstatus;
+  pid_t ret;
+  
+  if (! pid)
+    return (0);
+  
+  while ((ret = waitpid (pid, & wstatus, block ? 0 : WNOHANG)) < 0 && errno == EINTR)
+    ;
+  if (! ret)
+    return (pid);
+  if (ret < 0 || ! WIFEXITED (wstatus) || WEXITSTATUS (wstatus) != EXIT_SUCCESS)
+    fprintf (stderr, "warning: background save failed.\n");
+  
+  return (0);
+}
+
+void
+copy_attr (
+  const hid_t loc_in, const hid_t loc_out,
+  const char * const suffix
+)
+{
+  hid_t attr_id, attr_out, space_id, ftype_id, wtype_id;
+  size_t msize; /* size of type */
+  void * buf = NULL; /* data buffer */
+  hsize_t nelmts; /* number of elements in dataset */
+  int rank; /* rank of dataset */
+  htri_t is_named; /* whether the datatype is named */
+  hsize_t dims[H5S_MAX_RANK]; /* dimensions of dataset */
+  char name[255];
+  H5O_info_t oinfo; /* object info */
+  int j;
+  unsigned u;
+  
+  H5Oget_info (loc_in, & oinfo);
+  
+  /* copy all attributes */
+  for (u = 0; u < (unsigned) oinfo.num_attrs; u++)
+  {
+    buf = NULL;
+    
+    /* open attribute */
+    attr_id = H5Aopen_by_idx (loc_in, ".", H5_INDEX_CRT_ORDER, H5_ITER_INC, (hsize_t) u, H5P_DEFAULT, H5P_DEFAULT);
+    
+    /* get name */
+    H5Aget_name (attr_id, (size_t) 255, name);
+    if (suffix)
+      sprintf (& name[strlen (name)], " (%s)", suffix);
+    
+    /* get the file datatype  */
+    ftype_id = H5Aget_type (attr_id);
+    
+    /* get the dataspace handle  */
+    space_id = H5Aget_space (attr_id);
+    
+    /* get dimensions  */
+    rank = H5Sget_simple_extent_dims (space_id, dims, NULL);
+    for (j = 0, nelmts=1; j < rank; j++)
+      nelmts *= dims[j];
+    
+    wtype_id = H5Tcopy (ftype_id);
+    
+    msize = H5Tget_size (wtype_id);
+    
+    if (H5T_REFERENCE == H5Tget_class (wtype_id))
+      ;
+    else 
+    {
+      /* read to memory */
+      buf = malloc ((size_t) (nelmts * msize));
+      H5Aread (attr_id, wtype_id, buf);
+      
+      /* copy */
+      attr_out = H5Acreate2 (loc_out, name, wtype_id, space_id, H5P_DEFAULT, H5P_DEFAULT);
+      H5Awrite (attr_out, wtype_id, buf);
+      
+      /*close*/
+      H5Aclose (attr_out);
+      
+      free (buf);
+    }
+    
+    /* close */
+    H5Tclose (ftype_id);
+    H5Tclose (wtype_id);
+    H5Sclose (space_id);
+    H5Aclose (attr_id);
+  }
+}
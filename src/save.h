@@ -0,0 +1,136 @@
+/* save.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __save_h__
+#define __save_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "structs.h"
+#include "options.h"
+#include "freq.h"
+#include "writer.h"
+#include "spill.h"
+#include "metrics.h"
+#include "moments.h"
+
+void
+save (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  options_t * const options
+);
+
+void
+save_narrow (
+  const freq_t * const freq, const spill_t * const spill,
+  options_t * const options,
+  long int * const idl, long int * const idu
+);
+
+void
+save_widen (
+  options_t * const options,
+  long int * const idl, long int * const idu
+);
+
+void
+save_layout (
+  const hid_t loc_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+);
+
+void
+save_marginals (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+);
+
+void
+save_groups (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq,
+  const options_t * const options
+);
+
+void
+save_attr (
+  const hid_t dset_out, const hid_t file_in,
+  const freq_t * const freq,
+  const options_t * const options
+);
+
+void
+save_dense (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+);
+
+void
+save_sparse (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+);
+
+void
+save_grid (
+  const hid_t file_out, const hid_t file_in,
+  const freq_t * const freq, const spill_t * const spill,
+  const options_t * const options
+);
+
+void
+save_atomic (
+  const hid_t file_in,
+  const plan_t * const plan,
+  metrics_t * const metrics
+);
+
+pid_t
+save_background (
+  const hid_t file_in,
+  const plan_t * const plan,
+  metrics_t * const metrics
+);
+
+pid_t
+save_reap (
+  const pid_t pid,
+  const bool block
+);
+
+void
+copy_attr (
+  const hid_t loc_in, const hid_t loc_out,
+  const char * const suffix
+);
+
+#endif
@@ -0,0 +1,214 @@
+/* sketch.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sketch.h"
+
+sketch_t *
+sketch_alloc (
+  void
+)
+{
+  sketch_t * sketch;
+  
+  sketch = malloc (sizeof (* sketch));
+  sketch->n = 0;
+  sketch->nlevel = 0;
+  sketch->min = INFINITY;
+  sketch->max = - INFINITY;
+  sketch->size = NULL;
+  sketch->alloc = NULL;
+  sketch->level = NULL;
+  sketch->odd = false;
+  
+  return (sketch);
+}
+
+void
+sketch_free (
+  sketch_t * const sketch
+)
+{
+  size_t h;
+  
+  for (h = 0; h < sketch->nlevel; h++)
+    free (sketch->level[h]);
+  free (sketch->level);
+  free (sketch->size);
+  free (sketch->alloc);
+  free (sketch);
+}
+
+void
+sketch_add (
+  sketch_t * const sketch,
+  const double value
+)
+{
+  sketch->n++;
+  if (value < sketch->min)
+    sketch->min = value;
+  if (value > sketch->max)
+    sketch->max = value;
+  
+  sketch_push (sketch, 0, value);
+  if (sketch->size[0] >= sketch_capacity (sketch, 0))
+    sketch_compress (sketch);
+}
+
+void
+sketch_merge (
+  sketch_t * const sketch,
+  const sketch_t * const other
+)
+{
+  size_t h, i;
+  
+  /* the items keep their weights, only the compactors shrink */
+  for (h = 0; h < other->nlevel; h++)
+    for (i = 0; i < other->size[h]; i++)
+      sketch_push (sketch, h, other->level[h][i]);
+  sketch->n += other->n;
+  if (other->min < sketch->min)
+    sketch->min = other->min;
+  if (other->max > sketch->max)
+    sketch->max = other->max;
+  sketch_compress (sketch);
+}
+
+double
+sketch_quantile (
+  const sketch_t * const sketch,
+  const double q
+)
+{
+  size_t h, i, n = 0;
+  double target, weight = 0.;
+  
+  if (! sketch->n)
+    return (NAN);
+  if (q <= 0.)
+    return (sketch->min);
+  if (q >= 1.)
+    return (sketch->max);
+  
+  /* the items of level h stand for 2^h samples each */
+  for (h = 0; h < sketch->nlevel; h++)
+    n += sketch->size[h];
+  {
+    sketch_item_t item[n];
+    
+    for (h = 0, n = 0; h < sketch->nlevel; h++)
+      for (i = 0; i < sketch->size[h]; i++, n++)
+      {
+        item[n].value = sketch->level[h][i];
+        item[n].weight = ldexp (1., (int) h);
+      }
+    /* the items sort by their leading value */
+    qsort (item, n, sizeof (* item), sketch_compare);
+    
+    target = q * (double) sketch->n;
+    for (i = 0; i < n; i++)
+      if ((weight += item[i].weight) >= target)
+        return (item[i].value);
+  }
+  
+  return (sketch->max);
+}
+
+static size_t
+sketch_capacity (
+  const sketch_t * const sketch,
+  const size_t level
+)
+{
+  const double capacity = SKETCH_K * pow (2. / 3., (double) (sketch->nlevel - level - 1));
+  
+  /* the lower compactors shrink geometrically */
+  return ((capacity < SKETCH_MIN) ? SKETCH_MIN : (size_t) capacity);
+}
+
+static void
+sketch_push (
+  sketch_t * const sketch,
+  const size_t level, const double value
+)
+{
+  if (level >= sketch->nlevel)
+  {
+    sketch->level = realloc (sketch->level, (level + 1) * sizeof (* sketch->level));
+    sketch->size = realloc (sketch->size, (level + 1) * sizeof (* sketch->size));
+    sketch->alloc = realloc (sketch->alloc, (level + 1) * sizeof (* sketch->alloc));
+    for (; sketch->nlevel <= level; sketch->nlevel++)
+    {
+      sketch->level[sketch->nlevel] = NULL;
+      sketch->size[sketch->nlevel] = 0;
+      sketch->alloc[sketch->nlevel] = 0;
+    }
+  }
+  if (sketch->size[level] == sketch->alloc[level])
+  {
+    sketch->alloc[level] = sketch->alloc[level] ? 2 * sketch->alloc[level] : SKETCH_K;
+    sketch->level[level] = realloc (sketch->level[level], sketch->alloc[level] * sizeof (* sketch->level[level]));
+  }
+  sketch->level[level][sketch->size[level]++] = value;
+}
+
+static void
+sketch_compress (
+  sketch_t * const sketch
+)
+{
+  size_t h, i, m, offset;
+  double * item;
+  
+  /* a full compactor passes every other of its sorted items one level up */
+  for (h = 0; h < sketch->nlevel; h++)
+  {
+    if (sketch->size[h] < sketch_capacity (sketch, h))
+      continue;
+    item = sketch->level[h];
+    qsort (item, sketch->size[h], sizeof (* item), sketch_compare);
+    
+    /* an odd item stays behind, the weights add up to n exactly */
+    m = sketch->size[h] & ~ (size_t) 1;
+    offset = sketch->odd;
+    sketch->odd = ! sketch->odd;
+    for (i = offset; i < m; i += 2)
+      sketch_push (sketch, h + 1, sketch->level[h][i]);
+    item = sketch->level[h];
+    if (sketch->size[h] > m)
+      item[0] = item[m];
+    sketch->size[h] -= m;
+  }
+}
+
+static int
+sketch_compare (
+  const void * a, const void * b
+)
+{
+  const double da = * (const double *) a;
+  const double db = * (const double *) b;
+  
+  if (da < db)
+    return (-1);
+  else if (da == db)
+    return (0);
+  else
+    return (1);
+}
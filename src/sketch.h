@@ -0,0 +1,86 @@
+/* sketch.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __sketch_h__
+#define __sketch_h__
+
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "structs.h"
+
+/* items of the top compactor, the rank error shrinks as 1 / SKETCH_K */
+#define SKETCH_K 1024
+
+/* items of the lowest compactors */
+#define SKETCH_MIN 8
+
+sketch_t *
+sketch_alloc (
+  void
+);
+
+void
+sketch_free (
+  sketch_t * const sketch
+);
+
+void
+sketch_add (
+  sketch_t * const sketch,
+  const double value
+);
+
+void
+sketch_merge (
+  sketch_t * const sketch,
+  const sketch_t * const other
+);
+
+double
+sketch_quantile (
+  const sketch_t * const sketch,
+  const double q
+);
+
+static size_t
+sketch_capacity (
+  const sketch_t * const sketch,
+  const size_t level
+);
+
+static void
+sketch_push (
+  sketch_t * const sketch,
+  const size_t level, const double value
+);
+
+static void
+sketch_compress (
+  sketch_t * const sketch
+);
+
+static int
+sketch_compare (
+  const void * a, const void * b
+);
+
+#endif
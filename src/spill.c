@@ -0,0 +1,621 @@
+/* spill.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spill.h"
+
+spill_t *
+spill_alloc (
+  const char * const dir, const size_t index, const size_t dim
+)
+{
+  size_t i;
+  const char * base = dir;
+  spill_t * spill;
+  
+  if (! base && ! (base = getenv ("TMPDIR")))
+    base = "/tmp";
+  
+  spill = malloc (sizeof (* spill));
+  spill->prefix = malloc (strlen (base) + 64);
+  sprintf (spill->prefix, "%s/%s.%ld.%lu", base, PACKAGE_NAME, (long int) getpid (), (unsigned long int) index);
+  spill->dim = dim;
+  spill->nrun = 0;
+  for (i = 0; i < dim; i++)
+  {
+    spill->lo[i] = LONG_MAX;
+    spill->hi[i] = LONG_MIN;
+  }
+  
+  return (spill);
+}
+
+void
+spill_free (
+  spill_t * spill
+)
+{
+  size_t i;
+  char * name;
+  
+  for (i = 0; i < spill->nrun; i++)
+  {
+    name = spill_name (spill, i);
+    unlink (name);
+    free (name);
+  }
+  free (spill->prefix);
+  free (spill);
+}
+
+void
+spill_run (
+  spill_t * const spill,
+  freq_t * const freq
+)
+{
+  const size_t dim = spill->dim;
+  size_t i;
+  char * name;
+  bool more;
+  FILE * file;
+  run_t run;
+  
+  name = spill_name (spill, spill->nrun);
+  if (! (file = fopen (name, "wb")))
+  {
+    fprintf (stderr, "fatal: scratch file `%s' could not be created.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  setvbuf (file, NULL, _IOFBF, SPILL_BUFFER_SIZE);
+  
+  /* leaves in tree order make a sorted run of (key, count) records */
+  run.file = NULL;
+  run.path[0] = freq;
+  for (more = spill_descend (& run, 0, dim); more; more = spill_next (& run, dim))
+  {
+    if (fwrite (run.key, sizeof (* run.key), dim, file) != dim
+        || fwrite (& run.c, sizeof (run.c), 1, file) != 1)
+      break;
+    /* the runs keep the extent of their cells, the tree is pruned */
+    for (i = 0; i < dim; i++)
+    {
+      if (run.key[i] < spill->lo[i])
+        spill->lo[i] = run.key[i];
+      if (run.key[i] >= spill->hi[i])
+        spill->hi[i] = run.key[i] + 1;
+    }
+  }
+  if (more | fclose (file))
+  {
+    fprintf (stderr, "fatal: scratch file `%s' could not be written.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  free (name);
+  spill->nrun++;
+  
+  /* the root keeps the charge */
+  freq_prune (freq);
+  
+  /* a merge opens every run at once, their number stays bounded */
+  if (spill->nrun >= SPILL_FANIN)
+    spill_compact (spill);
+}
+
+void
+spill_merge (
+  const spill_t * const spill,
+  const freq_t * const freq,
+  const cells_cb_t cb, void * const ctx
+)
+{
+  const size_t dim = spill->dim;
+  size_t i, nheap = 0, * heap;
+  char * name;
+  long int key[dim];
+  unsigned long int c;
+  run_t * run;
+  
+  run = malloc ((spill->nrun + 1) * sizeof (* run));
+  heap = malloc ((spill->nrun + 1) * sizeof (* heap));
+  
+  /* the runs on disk and the tree in memory are merged with a heap */
+  for (i = 0; i < spill->nrun; i++)
+  {
+    name = spill_name (spill, i);
+    if (! (run[i].file = fopen (name, "rb")))
+    {
+      fprintf (stderr, "fatal: scratch file `%s' could not be opened.\n"
+                       "try '%s --help' for more information\n", name, PACKAGE_NAME);
+      exit (EXIT_FAILURE);
+    }
+    setvbuf (run[i].file, NULL, _IOFBF, SPILL_BUFFER_SIZE);
+    free (name);
+    if (spill_next (& run[i], dim))
+      heap[nheap++] = i;
+  }
+  run[i].file = NULL;
+  run[i].path[0] = freq;
+  if (freq && spill_descend (& run[i], 0, dim))
+    heap[nheap++] = i;
+  for (i = nheap / 2; i-- > 0;)
+    spill_sift (run, heap, nheap, i, dim);
+  
+  while (nheap)
+  {
+    /* equal keys from several runs are summed */
+    memcpy (key, run[heap[0]].key, sizeof (key));
+    c = 0;
+    while (nheap && ! spill_cmp (run[heap[0]].key, key, dim))
+    {
+      c += run[heap[0]].c;
+      if (! spill_next (& run[heap[0]], dim))
+        heap[0] = heap[--nheap];
+      spill_sift (run, heap, nheap, 0, dim);
+    }
+    cb (ctx, key, c);
+  }
+  
+  for (i = 0; i < spill->nrun; i++)
+    fclose (run[i].file);
+  free (heap);
+  free (run);
+}
+
+hsize_t
+spill_leaves (
+  const spill_t * const spill,
+  const freq_t * const freq
+)
+{
+  sink_t sink;
+  
+  sink.count = 0;
+  spill_merge (spill, freq, spill_count, & sink);
+  
+  return (sink.count);
+}
+
+void
+spill_save (
+  writer_t * const writer,
+  const spill_t * const spill,
+  const freq_t * const freq
+)
+{
+  size_t i;
+  const size_t dim = spill->dim, chunk = writer->chunk[0];
+  hsize_t rows;
+  block_t block;
+  sink_t sink;
+  
+  if (! (rows = freq_rows (freq, dim)))
+    return;
+  
+  /* the block holds a whole number of chunks */
+  block.writer = writer;
+  block.width = dim + 1;
+  block.rows = FREQ_BLOCK_SIZE / (chunk * block.width * sizeof (* block.buf));
+  block.rows = chunk * (block.rows ? block.rows : 1);
+  if (rows < block.rows)
+    block.rows = rows;
+  block.fill = 0;
+  block.offset = 0;
+  block.buf = malloc (block.rows * block.width * sizeof (* block.buf));
+  
+  /* occupied cells come in row-major order, the empty ones are filled in between */
+  sink.dim = dim;
+  sink.freq = freq;
+  sink.block = & block;
+  sink.count = 0;
+  sink.er = (double) freq->c;
+  for (i = 0; i < dim; i++)
+  {
+    sink.er *= freq->binning[i];
+    sink.id[i] = freq->idl[i];
+  }
+  sink.er = 1. / sink.er;
+  spill_merge (spill, freq, spill_dense, & sink);
+  while (sink.count < rows)
+    spill_row (& sink, 0);
+  
+  freq_h5flush (& block);
+  free (block.buf);
+}
+
+void
+spill_save_sparse (
+  writer_t * const * const writer_id, writer_t * const writer_c, writer_t * const writer_d,
+  const spill_t * const spill,
+  const freq_t * const freq
+)
+{
+  size_t i;
+  const size_t dim = spill->dim, chunk = writer_c->chunk[0];
+  const hsize_t leaves = writer_c->dims[0];
+  coo_t coo;
+  sink_t sink;
+  
+  /* the block holds a whole number of chunks of every array */
+  coo.writer_id = writer_id;
+  coo.writer_c = writer_c;
+  coo.writer_d = writer_d;
+  coo.dim = dim;
+  coo.rows = FREQ_BLOCK_SIZE / (chunk * (dim + 2) * sizeof (double));
+  coo.rows = chunk * (coo.rows ? coo.rows : 1);
+  if (leaves < coo.rows)
+    coo.rows = leaves;
+  coo.fill = 0;
+  coo.offset = 0;
+  
+  if (! coo.rows)
+    return;
+  
+  coo.id = malloc (coo.rows * dim * sizeof (* coo.id));
+  coo.c = malloc (coo.rows * sizeof (* coo.c));
+  coo.d = malloc (coo.rows * sizeof (* coo.d));
+  
+  sink.dim = dim;
+  sink.coo = & coo;
+  sink.er = (double) freq->c;
+  for (i = 0; i < dim; i++)
+    sink.er *= freq->binning[i];
+  sink.er = 1. / sink.er;
+  spill_merge (spill, freq, spill_sparse, & sink);
+  freq_cooflush (& coo);
+  
+  free (coo.id);
+  free (coo.c);
+  free (coo.d);
+}
+
+void
+spill_save_grid (
+  writer_t * const writer,
+  const spill_t * const spill,
+  const freq_t * const freq
+)
+{
+  size_t i;
+  const size_t dim = spill->dim, chunk = writer->chunk[0];
+  sink_t sink;
+  
+  if (! freq_rows (freq, dim))
+    return;
+  
+  sink.dim = dim;
+  sink.freq = freq;
+  sink.writer = writer;
+  sink.er = (double) freq->c;
+  for (i = dim; i-- > 0;)
+  {
+    sink.er *= freq->binning[i];
+    sink.extent[i] = (hsize_t) (freq->idu[i] - freq->idl[i]);
+    sink.stride[i] = (i + 1 < dim) ? sink.stride[i + 1] * sink.extent[i + 1] : 1;
+    sink.start[i] = 0;
+  }
+  sink.er = 1. / sink.er;
+  
+  /* the slab spans whole chunks along the first axis */
+  sink.slab = FREQ_BLOCK_SIZE / (chunk * sink.stride[0] * sizeof (* sink.buf));
+  sink.slab = chunk * (sink.slab ? sink.slab : 1);
+  if (sink.slab > sink.extent[0])
+    sink.slab = sink.extent[0];
+  
+  sink.buf = calloc (sink.slab * sink.stride[0], sizeof (* sink.buf));
+  spill_merge (spill, freq, spill_grid, & sink);
+  while (sink.start[0] < sink.extent[0])
+    spill_slab (& sink);
+  free (sink.buf);
+}
+
+void
+spill_marginals (
+  freq_t * const * const marginal, const size_t * const * const axes, const size_t * const dim_marginal,
+  const size_t nmarginal,
+  const spill_t * const spill,
+  const freq_t * const freq
+)
+{
+  marg_t marg[nmarginal];
+  sink_t sink;
+  
+  /* a single merge of the runs feeds all marginals */
+  freq_margopen (marg, marginal, axes, dim_marginal, nmarginal);
+  sink.marg = marg;
+  sink.nmarg = nmarginal;
+  spill_merge (spill, freq, spill_marg, & sink);
+  freq_margclose (marg, nmarginal, freq->c);
+}
+
+static char *
+spill_name (
+  const spill_t * const spill, const size_t run
+)
+{
+  char * name;
+  
+  name = malloc (strlen (spill->prefix) + 26);
+  sprintf (name, "%s.%lu.run", spill->prefix, (unsigned long int) run);
+  
+  return (name);
+}
+
+static void
+spill_compact (
+  spill_t * const spill
+)
+{
+  size_t i;
+  char * name, * target;
+  sink_t sink;
+  
+  /* the runs are merged into the next free name, which then becomes run 0 */
+  name = spill_name (spill, spill->nrun);
+  if (! (sink.file = fopen (name, "wb")))
+  {
+    fprintf (stderr, "fatal: scratch file `%s' could not be created.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  setvbuf (sink.file, NULL, _IOFBF, SPILL_BUFFER_SIZE);
+  sink.dim = spill->dim;
+  spill_merge (spill, NULL, spill_write, & sink);
+  if (ferror (sink.file) | fclose (sink.file))
+  {
+    fprintf (stderr, "fatal: scratch file `%s' could not be written.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  for (i = 0; i < spill->nrun; i++)
+  {
+    target = spill_name (spill, i);
+    unlink (target);
+    free (target);
+  }
+  target = spill_name (spill, 0);
+  if (rename (name, target))
+  {
+    fprintf (stderr, "fatal: scratch file `%s' could not be renamed.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  free (target);
+  free (name);
+  spill->nrun = 1;
+}
+
+static void
+spill_write (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  sink_t * const sink = ctx;
+  
+  /* write errors are caught by ferror once the merge is done */
+  fwrite (id, sizeof (* id), sink->dim, sink->file);
+  fwrite (& c, sizeof (c), 1, sink->file);
+}
+
+static int
+spill_cmp (
+  const long int * const a, const long int * const b, const size_t dim
+)
+{
+  size_t i;
+  
+  for (i = 0; i < dim; i++)
+    if (a[i] != b[i])
+      return ((a[i] < b[i]) ? -1 : 1);
+  
+  return (0);
+}
+
+static bool
+spill_descend (
+  run_t * const run, const size_t depth, const size_t dim
+)
+{
+  const freq_t * cur;
+  const counter_t * leaves;
+  
+  /* first leaf below the node, paths may end outside the limits */
+  if (depth + 1 == dim)
+  {
+    leaves = run->path[depth]->leaves;
+    if (! leaves || ! leaves->n || leaves->id[0] >= * run->path[depth]->idu)
+      return (false);
+    run->leaf = 0;
+    run->key[depth] = leaves->id[0];
+    run->c = counter_get (leaves, 0);
+    return (true);
+  }
+  
+  for (cur = run->path[depth]->first; cur && cur->id < * run->path[depth]->idu; cur = cur->next)
+  {
+    run->path[depth + 1] = cur;
+    run->key[depth] = cur->id;
+    if (spill_descend (run, depth + 1, dim))
+      return (true);
+  }
+  
+  return (false);
+}
+
+static bool
+spill_next (
+  run_t * const run, const size_t dim
+)
+{
+  size_t depth;
+  const freq_t * cur;
+  const counter_t * leaves;
+  
+  if (run->file)
+    return (fread (run->key, sizeof (* run->key), dim, run->file) == dim
+            && fread (& run->c, sizeof (run->c), 1, run->file) == 1);
+  
+  /* next counter in the block of the last axis */
+  leaves = run->path[dim - 1]->leaves;
+  if (++run->leaf < leaves->n && leaves->id[run->leaf] < * run->path[dim - 1]->idu)
+  {
+    run->key[dim - 1] = leaves->id[run->leaf];
+    run->c = counter_get (leaves, run->leaf);
+    return (true);
+  }
+  
+  /* next sibling at the deepest level that has one */
+  for (depth = dim - 1; depth-- > 0;)
+    for (cur = run->path[depth + 1]->next; cur && cur->id < * run->path[depth]->idu; cur = cur->next)
+    {
+      run->path[depth + 1] = cur;
+      run->key[depth] = cur->id;
+      if (spill_descend (run, depth + 1, dim))
+        return (true);
+    }
+  
+  return (false);
+}
+
+static void
+spill_sift (
+  const run_t * const run, size_t * const heap, const size_t nheap, size_t i, const size_t dim
+)
+{
+  size_t child;
+  const size_t top = heap[i];
+  
+  while ((child = 2 * i + 1) < nheap)
+  {
+    if (child + 1 < nheap && spill_cmp (run[heap[child + 1]].key, run[heap[child]].key, dim) < 0)
+      child++;
+    if (spill_cmp (run[heap[child]].key, run[top].key, dim) >= 0)
+      break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = top;
+}
+
+static void
+spill_count (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  ((sink_t *) ctx)->count++;
+}
+
+static void
+spill_row (
+  sink_t * const sink, const unsigned long int c
+)
+{
+  size_t i;
+  block_t * const block = sink->block;
+  double * const row = & block->buf[block->fill * block->width];
+  
+  for (i = 0; i < sink->dim; i++)
+    row[i] = ((double) sink->id[i] + .5) * sink->freq->binning[i];
+  row[sink->dim] = (double) c * sink->er;
+  if (++block->fill == block->rows)
+    freq_h5flush (block);
+  sink->count++;
+  
+  /* next cell in row-major order */
+  for (i = sink->dim; i-- > 0;)
+  {
+    if (++sink->id[i] < sink->freq->idu[i])
+      break;
+    sink->id[i] = sink->freq->idl[i];
+  }
+}
+
+static void
+spill_dense (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  sink_t * const sink = ctx;
+  
+  while (spill_cmp (sink->id, id, sink->dim))
+    spill_row (sink, 0);
+  spill_row (sink, c);
+}
+
+static void
+spill_sparse (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  size_t i;
+  coo_t * const coo = ((sink_t *) ctx)->coo;
+  
+  for (i = 0; i < coo->dim; i++)
+    coo->id[i * coo->rows + coo->fill] = id[i];
+  coo->c[coo->fill] = c;
+  coo->d[coo->fill] = (double) c * ((sink_t *) ctx)->er;
+  if (++coo->fill == coo->rows)
+    freq_cooflush (coo);
+}
+
+static void
+spill_slab (
+  sink_t * const sink
+)
+{
+  size_t i;
+  hsize_t count[sink->dim];
+  
+  for (i = 0; i < sink->dim; i++)
+    count[i] = sink->extent[i];
+  count[0] = (sink->start[0] + sink->slab < sink->extent[0]) ? sink->slab : sink->extent[0] - sink->start[0];
+  
+  writer_slab (sink->writer, sink->start, count, sink->buf);
+  memset (sink->buf, 0, count[0] * sink->stride[0] * sizeof (* sink->buf));
+  sink->start[0] += count[0];
+}
+
+static void
+spill_grid (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  size_t i;
+  sink_t * const sink = ctx;
+  const hsize_t r = (hsize_t) (id[0] - sink->freq->idl[0]);
+  hsize_t p;
+  
+  while (r >= sink->start[0] + sink->slab)
+    spill_slab (sink);
+  
+  for (i = 1, p = (r - sink->start[0]) * sink->stride[0]; i < sink->dim; i++)
+    p += (hsize_t) (id[i] - sink->freq->idl[i]) * sink->stride[i];
+  sink->buf[p] = (double) c * sink->er;
+}
+
+static void
+spill_marg (
+  void * const ctx, const long int * const id, const unsigned long int c
+)
+{
+  sink_t * const sink = ctx;
+  
+  freq_margcell (sink->marg, sink->nmarg, id, c);
+}
@@ -0,0 +1,169 @@
+/* spill.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __spill_h__
+#define __spill_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "structs.h"
+#include "freq.h"
+#include "writer.h"
+
+/* samples committed between checks of the memory budget */
+#define SPILL_BATCH 65536
+#define SPILL_BUFFER_SIZE 262144
+/* runs merged at once, more are first compacted into one */
+#define SPILL_FANIN 64
+
+spill_t *
+spill_alloc (
+  const char * const dir, const size_t index, const size_t dim
+);
+
+void
+spill_free (
+  spill_t * spill
+);
+
+void
+spill_run (
+  spill_t * const spill,
+  freq_t * const freq
+);
+
+void
+spill_merge (
+  const spill_t * const spill,
+  const freq_t * const freq,
+  const cells_cb_t cb, void * const ctx
+);
+
+hsize_t
+spill_leaves (
+  const spill_t * const spill,
+  const freq_t * const freq
+);
+
+void
+spill_save (
+  writer_t * const writer,
+  const spill_t * const spill,
+  const freq_t * const freq
+);
+
+void
+spill_save_sparse (
+  writer_t * const * const writer_id, writer_t * const writer_c, writer_t * const writer_d,
+  const spill_t * const spill,
+  const freq_t * const freq
+);
+
+void
+spill_save_grid (
+  writer_t * const writer,
+  const spill_t * const spill,
+  const freq_t * const freq
+);
+
+void
+spill_marginals (
+  freq_t * const * const marginal, const size_t * const * const axes, const size_t * const dim_marginal,
+  const size_t nmarginal,
+  const spill_t * const spill,
+  const freq_t * const freq
+);
+
+static char *
+spill_name (
+  const spill_t * const spill, const size_t run
+);
+
+static void
+spill_compact (
+  spill_t * const spill
+);
+
+static void
+spill_write (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static int
+spill_cmp (
+  const long int * const a, const long int * const b, const size_t dim
+);
+
+static bool
+spill_descend (
+  run_t * const run, const size_t depth, const size_t dim
+);
+
+static bool
+spill_next (
+  run_t * const run, const size_t dim
+);
+
+static void
+spill_sift (
+  const run_t * const run, size_t * const heap, const size_t nheap, size_t i, const size_t dim
+);
+
+static void
+spill_count (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static void
+spill_row (
+  sink_t * const sink, const unsigned long int c
+);
+
+static void
+spill_dense (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static void
+spill_sparse (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static void
+spill_slab (
+  sink_t * const sink
+);
+
+static void
+spill_grid (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+static void
+spill_marg (
+  void * const ctx, const long int * const id, const unsigned long int c
+);
+
+#endif
@@ -0,0 +1,258 @@
+/* stream.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream.h"
+
+stream_t *
+stream_open (
+  const char * const name, const char * const layout,
+  const options_t * const source
+)
+{
+  size_t i, k, l, f;
+  stream_t * stream;
+  
+  stream = malloc (sizeof (* stream));
+  stream_layout (stream, layout);
+  
+  /* every member of every dataset is a field of the record */
+  for (i = 0; i < NDATASET_MAX; i++)
+  {
+    stream->dim[i] = source->dim[i];
+    stream->map[i] = NULL;
+    stream->raw[i] = NULL;
+    if (! source->dim[i])
+      continue;
+    stream->map[i] = malloc (source->dim[i] * sizeof (* stream->map[i]));
+    for (l = 0; l < source->dim[i]; l++)
+    {
+      for (f = 0; f < stream->nfield; f++)
+        if (! strcmp (stream->field[f].name, source->member[i][l]))
+          break;
+      if (f == stream->nfield)
+      {
+        fprintf (stderr, "fatal: member `%s' is not a field of the record layout.\n"
+                         "try '%s --help' for more information\n", source->member[i][l], PACKAGE_NAME);
+        exit (EXIT_FAILURE);
+      }
+      stream->map[i][l] = f;
+    }
+    
+    /* shaped like the buffers of load, one member value per record */
+    stream->raw[i] = malloc (STREAM_BATCH * sizeof (* stream->raw[i]));
+    stream->raw[i][0] = malloc (STREAM_BATCH * source->dim[i] * sizeof (* stream->raw[i][0]));
+    stream->raw[i][0][0] = malloc (STREAM_BATCH * source->dim[i] * sizeof (* stream->raw[i][0][0]));
+    for (k = 0; k < STREAM_BATCH; k++)
+    {
+      stream->raw[i][k] = stream->raw[i][0] + k * source->dim[i];
+      for (l = 0; l < source->dim[i]; l++)
+        stream->raw[i][k][l] = stream->raw[i][0][0] + k * source->dim[i] + l;
+    }
+  }
+  
+  stream->buf = malloc (STREAM_BATCH * stream->size);
+  stream->fill = 0;
+  stream->eof = false;
+  
+  /* stdin or anything that can be read in order, a pipe, a FIFO or a file */
+  if (! strcmp (name, "-"))
+    stream->fd = STDIN_FILENO;
+  else if ((stream->fd = open (name, O_RDONLY)) < 0)
+  {
+    fprintf (stderr, "warning: stream `%s' could not be opened, skipping.\n", name);
+    stream_close (stream);
+    return (NULL);
+  }
+  
+  return (stream);
+}
+
+void
+stream_close (
+  stream_t * const stream
+)
+{
+  size_t i;
+  
+  if (stream->fd > STDIN_FILENO)
+    close (stream->fd);
+  for (i = 0; i < NDATASET_MAX; i++)
+    if (stream->raw[i])
+    {
+      free (stream->raw[i][0][0]);
+      free (stream->raw[i][0]);
+      free (stream->raw[i]);
+    }
+  for (i = 0; i < NDATASET_MAX; i++)
+    free (stream->map[i]);
+  for (i = 0; i < stream->nfield; i++)
+    free (stream->field[i].name);
+  free (stream->field);
+  free (stream->buf);
+  free (stream);
+}
+
+size_t
+stream_read (
+  stream_t * const stream
+)
+{
+  size_t i, k, l, n;
+  ssize_t r;
+  const size_t size = STREAM_BATCH * stream->size;
+  
+  /* block until the batch is full or the writer closes the stream */
+  while (! stream->eof && stream->fill < size)
+  {
+    if ((r = read (stream->fd, stream->buf + stream->fill, size - stream->fill)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      fprintf (stderr, "warning: stream could not be read, %s.\n", strerror (errno));
+      stream->eof = true;
+    }
+    else if (! r)
+      stream->eof = true;
+    else
+      stream->fill += r;
+  }
+  
+  n = stream->fill / stream->size;
+  for (k = 0; k < n; k++)
+  {
+    const unsigned char * const record = stream->buf + k * stream->size;
+    
+    for (i = 0; i < NDATASET_MAX; i++)
+      for (l = 0; l < stream->dim[i]; l++)
+        stream->raw[i][k][l][0] = stream_value (record, & stream->field[stream->map[i][l]]);
+  }
+  
+  if (stream->eof && stream->fill % stream->size)
+    fprintf (stderr, "warning: stream ends in a partial record, %lu bytes ignored.\n",
+             (unsigned long int) (stream->fill % stream->size));
+  stream->fill = 0;
+  
+  return (n);
+}
+
+static void
+stream_layout (
+  stream_t * const stream,
+  const char * const layout
+)
+{
+  char * str, * str_tok, * type, * str_end;
+  field_t * field;
+  
+  stream->size = 0;
+  stream->nfield = 0;
+  stream->field = NULL;
+  
+  /* name:type fields in record order, the type optionally prefixed by its byte order */
+  str = strdup (layout);
+  for (str_tok = strtok (str, ","); str_tok; str_tok = strtok (NULL, ","))
+  {
+    stream->field = realloc (stream->field, ++stream->nfield * sizeof (* stream->field));
+    field = & stream->field[stream->nfield - 1];
+    
+    if (! (type = strrchr (str_tok, ':')) || type == str_tok)
+      goto fail;
+    * type++ = '\0';
+    field->name = strdup (str_tok);
+    
+    field->swap = false;
+    if (* type == '<' || * type == '>' || * type == '=')
+    {
+      const uint16_t one = 1;
+      const bool little = * (const unsigned char *) & one;
+      
+      field->swap = (* type == '<' && ! little) || (* type == '>' && little);
+      type++;
+    }
+    field->type = * type++;
+    field->size = (size_t) strtoul (type, & str_end, 10);
+    if (str_end == type || * str_end != '\0')
+      goto fail;
+    if (! ((field->type == 'f' && (field->size == 4 || field->size == 8))
+           || ((field->type == 'i' || field->type == 'u')
+               && (field->size == 1 || field->size == 2 || field->size == 4 || field->size == 8))))
+      goto fail;
+    
+    field->offset = stream->size;
+    stream->size += field->size;
+  }
+  free (str);
+  
+  if (stream->nfield)
+    return;
+  
+fail:
+  fprintf (stderr, "fatal: cannot parse record layout `%s'.\n"
+                   "try '%s --help' for more information\n", layout, PACKAGE_NAME);
+  exit (EXIT_FAILURE);
+}
+
+static double
+stream_value (
+  const unsigned char * const record,
+  const field_t * const field
+)
+{
+  size_t i;
+  unsigned char b[8];
+  
+  /* records need not be aligned */
+  if (field->swap)
+    for (i = 0; i < field->size; i++)
+      b[i] = record[field->offset + field->size - 1 - i];
+  else
+    memcpy (b, & record[field->offset], field->size);
+  
+  switch (field->type)
+  {
+    case 'f':
+      if (field->size == 4)
+      {
+        float v;
+        memcpy (& v, b, sizeof (v));
+        return ((double) v);
+      }
+      else
+      {
+        double v;
+        memcpy (& v, b, sizeof (v));
+        return (v);
+      }
+    case 'i':
+      switch (field->size)
+      {
+        case 1: { int8_t v; memcpy (& v, b, 1); return ((double) v); }
+        case 2: { int16_t v; memcpy (& v, b, 2); return ((double) v); }
+        case 4: { int32_t v; memcpy (& v, b, 4); return ((double) v); }
+        default: { int64_t v; memcpy (& v, b, 8); return ((double) v); }
+      }
+    default:
+      switch (field->size)
+      {
+        case 1: { uint8_t v; memcpy (& v, b, 1); return ((double) v); }
+        case 2: { uint16_t v; memcpy (& v, b, 2); return ((double) v); }
+        case 4: { uint32_t v; memcpy (& v, b, 4); return ((double) v); }
+        default: { uint64_t v; memcpy (& v, b, 8); return ((double) v); }
+      }
+  }
+}
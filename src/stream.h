@@ -0,0 +1,64 @@
+/* stream.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __stream_h__
+#define __stream_h__
+
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "structs.h"
+
+/* records per batch, binned together like the samples of one file */
+#define STREAM_BATCH 262144
+
+stream_t *
+stream_open (
+  const char * const name, const char * const layout,
+  const options_t * const source
+);
+
+void
+stream_close (
+  stream_t * const stream
+);
+
+size_t
+stream_read (
+  stream_t * const stream
+);
+
+static void
+stream_layout (
+  stream_t * const stream,
+  const char * const layout
+);
+
+static double
+stream_value (
+  const unsigned char * const record,
+  const field_t * const field
+);
+
+#endif
@@ -23,18 +23,73 @@
 
 #include "hdf5.h"
 
+#include <stdio.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #define NDATASET_MAX 10
 
+typedef enum
+{
+  FORMAT_DENSE = 0,
+  FORMAT_SPARSE,
+  FORMAT_GRID
+}
+format_t;
+
+typedef enum
+{
+  FILTER_NONE = 0,
+  FILTER_DEFLATE,
+  FILTER_ZSTD,
+  FILTER_LZ4
+}
+filter_t;
+
+/* what the automatic range chose of an axis */
+typedef enum
+{
+  RANGE_NONE = 0,
+  RANGE_LIMITS = 1,
+  RANGE_BINNING = 2
+}
+range_t;
+
 typedef struct
 {
   size_t ninput;
   char ** input;
   char * output;
+  char * jobs;
+  char * spec;
   size_t savevery;
+  double interval;
+  bool background;
+  format_t format;
+  unsigned long int marginals;
   
   size_t chunk;
+  filter_t filter;
+  int level;
+  bool shuffle;
+  size_t nthreads;
+  
+  unsigned long int max_memory;
+  char * scratch;
+  char * metrics;
+  char * status;
+  char * trace;
+  char * layout;
+  char * group;
+  bool moments;
+  
+  bool autorange;
+  unsigned long int small;
+  bool preview;
+  double sample, sampled;
+  unsigned long int seed;
+  double quantile[2];
+  size_t nbins;
   
   char * dataset[NDATASET_MAX];
   size_t dim[NDATASET_MAX];
@@ -52,9 +107,100 @@ typedef struct
   long int * limit_idl_merged,
            * limit_idu_merged;
   bool * l10_merged;
+  unsigned char * auto_merged;
+  long int * limit_idl_given,
+           * limit_idu_given;
 }
 options_t;
 
+/* mergeable sums of the moments about the mean, the diagonal of the co-moments being the squares */
+typedef struct
+{
+  size_t dim;
+  unsigned long int n;
+  double * mean, * m3, * cov;
+}
+moments_t;
+
+typedef struct
+{
+  size_t dataset, member;
+  bool l10;
+  double sign, binning;
+}
+column_t;
+
+typedef struct
+{
+  options_t * options;
+  struct freq * freq;
+  struct spill * spill;
+  moments_t * moments;
+  size_t * column;
+}
+spec_t;
+
+typedef struct
+{
+  options_t * source;
+  size_t nspec, ncolumn;
+  spec_t * spec;
+  column_t * column;
+}
+plan_t;
+
+typedef struct
+{
+  hid_t file, loc, dset;
+  char layout[16];
+  size_t dim;
+  char * member[H5S_MAX_RANK];
+  double binning[H5S_MAX_RANK],
+         limit_l[H5S_MAX_RANK],
+         limit_u[H5S_MAX_RANK];
+  long int idl[H5S_MAX_RANK],
+           idu[H5S_MAX_RANK],
+           cl[H5S_MAX_RANK];
+  hsize_t n[H5S_MAX_RANK];
+  hbool_t l10[H5S_MAX_RANK];
+  unsigned long int charge;
+}
+cells_t;
+
+typedef void (* cells_cb_t) (void * const, const long int * const, const unsigned long int);
+
+typedef struct
+{
+  size_t dim;
+  const long int * cl;
+  const hsize_t * stride;
+  unsigned long int * sum;
+}
+sat_fill_t;
+
+typedef struct
+{
+  char magic[8];
+  unsigned long int dim, charge, source_size;
+  long int source_mtime, source_mtime_nsec;
+  char group[256];
+}
+sat_header_t;
+
+typedef struct
+{
+  size_t dim;
+  const long int * idl;
+  const hsize_t * n;
+  const double * binning;
+  unsigned long int charge;
+  hsize_t stride[H5S_MAX_RANK];
+  const unsigned long int * sum;
+  size_t size;
+  void * map;
+}
+sat_t;
+
 typedef struct data
 {
   long int id;
@@ -63,6 +209,22 @@ typedef struct data
 }
 data_t;
 
+typedef struct
+{
+  long int id;
+  unsigned long int c;
+}
+overflow_t;
+
+typedef struct
+{
+  size_t n, size;
+  unsigned int width, nover;
+  overflow_t * over;
+  long int id[];
+}
+counter_t;
+
 typedef struct freq
 {
   long int id;
@@ -73,7 +235,255 @@ typedef struct freq
   const double * binning;
   
   struct freq * first, * next;
+  counter_t * leaves;
 }
 freq_t;
 
+typedef struct job
+{
+  hsize_t offset[H5S_MAX_RANK];
+  size_t size;
+  unsigned int mask;
+  unsigned char * buf, * out;
+  struct job * next;
+}
+job_t;
+
+typedef struct
+{
+  hid_t dset, memtype, filetype;
+  size_t rank, elsize, nthreads, inflight, max;
+  hsize_t dims[H5S_MAX_RANK], chunk[H5S_MAX_RANK];
+  filter_t filter;
+  int level;
+  bool shuffle, convert, stop;
+  job_t * todo, * todo_last, * done;
+  pthread_t * thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond_todo, cond_done;
+}
+writer_t;
+
+typedef struct
+{
+  writer_t * writer;
+  size_t width, rows, fill;
+  hsize_t offset;
+  double * buf;
+}
+block_t;
+
+typedef struct
+{
+  writer_t * const * writer_id;
+  writer_t * writer_c, * writer_d;
+  size_t dim, rows, fill;
+  hsize_t offset;
+  long int * id;
+  unsigned long int * c;
+  double * d;
+}
+coo_t;
+
+typedef struct
+{
+  size_t dim;
+  bool count;
+  format_t format;
+  long int factor[H5S_MAX_RANK], lo[H5S_MAX_RANK], k;
+  hsize_t m[H5S_MAX_RANK], stride[H5S_MAX_RANK], nnz, slab, fill;
+  const double * binning;
+  double er, * buf;
+  unsigned long int * c, dropped;
+  block_t block;
+  coo_t coo;
+  writer_t * writer;
+}
+rebin_t;
+
+typedef struct
+{
+  freq_t * freq;
+  const size_t * axes;
+  size_t dim, size, fill;
+  long int * key;
+  unsigned long int * c;
+}
+marg_t;
+
+typedef struct spill
+{
+  char * prefix;
+  size_t dim, nrun;
+  long int lo[H5S_MAX_RANK], hi[H5S_MAX_RANK];
+}
+spill_t;
+
+typedef struct
+{
+  FILE * file;
+  const freq_t * path[H5S_MAX_RANK + 1];
+  size_t leaf;
+  long int key[H5S_MAX_RANK];
+  unsigned long int c;
+}
+run_t;
+
+typedef struct
+{
+  size_t dim;
+  const freq_t * freq;
+  double er;
+  hsize_t count;
+  long int id[H5S_MAX_RANK];
+  hsize_t stride[H5S_MAX_RANK], extent[H5S_MAX_RANK], start[H5S_MAX_RANK], slab;
+  double * buf;
+  block_t * block;
+  coo_t * coo;
+  writer_t * writer;
+  marg_t * marg;
+  size_t nmarg;
+  FILE * file;
+}
+sink_t;
+
+typedef struct
+{
+  size_t dim, n;
+  const long int * idl;
+  size_t stride[H5S_MAX_RANK];
+  long int * index;
+  unsigned long int * count;
+}
+export_t;
+
+/* the handle of libhistogramr.h, typedef'd there */
+struct histogramr
+{
+  options_t * options;
+  char ** member;
+  column_t * column;
+  freq_t * freq;
+  moments_t * moments;
+};
+
+/* the query handle of libhistogramr.h, typedef'd there */
+struct histogramr_query
+{
+  sat_t * sat;
+};
+
+/* the rows of an input a pass reads, by the hash of their block */
+typedef struct
+{
+  const char * name;
+  double lo, hi;
+  unsigned long int seed;
+}
+sample_t;
+
+typedef struct
+{
+  hid_t dtype, memtype;
+  size_t length;
+  H5T_class_t class;
+}
+typecache_t;
+
+typedef struct
+{
+  size_t n, size, length;
+  size_t dim[NDATASET_MAX];
+  double * buf[NDATASET_MAX];
+  double *** raw[NDATASET_MAX];
+}
+batch_t;
+
+typedef struct
+{
+  char * name;
+  size_t offset, size;
+  char type;
+  bool swap;
+}
+field_t;
+
+typedef struct
+{
+  int fd;
+  size_t size, nfield, fill;
+  bool eof;
+  field_t * field;
+  unsigned char * buf;
+  size_t dim[NDATASET_MAX], * map[NDATASET_MAX];
+  double *** raw[NDATASET_MAX];
+}
+stream_t;
+
+typedef struct
+{
+  size_t n, nlevel;
+  double min, max;
+  size_t * size, * alloc;
+  double ** level;
+  bool odd;
+}
+sketch_t;
+
+typedef struct
+{
+  double value, weight;
+}
+sketch_item_t;
+
+typedef enum
+{
+  PHASE_OPEN = 0,
+  PHASE_LOAD,
+  PHASE_BIN,
+  PHASE_SORT,
+  PHASE_ACCUMULATE,
+  PHASE_SPILL,
+  PHASE_SAVE,
+  NPHASE
+}
+phase_t;
+
+typedef enum
+{
+  EVENT_CYCLES = 0,
+  EVENT_INSTRUCTIONS,
+  EVENT_CACHE_MISSES,
+  EVENT_BRANCH_MISSES,
+  EVENT_PAGE_FAULTS,
+  NEVENT
+}
+event_t;
+
+typedef struct
+{
+  const char * phase, * input;
+  size_t done, ninput;
+  unsigned long int bytes, rows, charge, nodes, node_bytes;
+}
+status_t;
+
+typedef struct
+{
+  int fd;
+  double begin, opened;
+  double start[NPHASE], seconds[NPHASE];
+  unsigned long int calls[NPHASE];
+  int event[NEVENT];
+  unsigned long int mark[NPHASE][NEVENT], count[NPHASE][NEVENT];
+  
+  const char * status;
+  status_t state;
+  bool dirty, stop, failed;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+}
+metrics_t;
+
 #endif
@@ -0,0 +1,203 @@
+/* trace.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trace.h"
+
+/* one trace per process, threads and forked saves append to the same file */
+static int trace_fd = -1;
+static const char * trace_sep = "";
+
+void
+trace_open (
+  const char * const name
+)
+{
+  if ((trace_fd = open (name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)) < 0)
+  {
+    fprintf (stderr, "fatal: trace file `%s' could not be created.\n"
+                     "try '%s --help' for more information\n", name, PACKAGE_NAME);
+    exit (EXIT_FAILURE);
+  }
+  
+  /* every later event starts with a comma, so an unfinished trace only lacks the optional bracket */
+  trace_write ("[", 1);
+  trace_process (PACKAGE_NAME);
+  trace_sep = ",\n";
+  trace_thread ("main");
+}
+
+void
+trace_close (
+  void
+)
+{
+  if (trace_fd < 0)
+    return;
+  
+  trace_write ("\n]\n", 3);
+  close (trace_fd);
+  trace_fd = -1;
+}
+
+bool
+trace_enabled (
+  void
+)
+{
+  return (trace_fd >= 0);
+}
+
+double
+trace_clock (
+  void
+)
+{
+  struct timespec ts;
+  
+  clock_gettime (CLOCK_MONOTONIC, & ts);
+  
+  return ((double) ts.tv_sec + (double) ts.tv_nsec / 1e9);
+}
+
+void
+trace_process (
+  const char * const name
+)
+{
+  char buf[TRACE_EVENT_SIZE];
+  size_t n;
+  
+  if (trace_fd < 0)
+    return;
+  
+  n = snprintf (buf, sizeof (buf), "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %ld, \"args\": {\"name\": \"",
+                trace_sep, (long int) getpid ());
+  n += trace_escape (& buf[n], sizeof (buf) - n, name);
+  n += snprintf (& buf[n], sizeof (buf) - n, "\"}}");
+  trace_write (buf, n);
+}
+
+void
+trace_thread (
+  const char * const name
+)
+{
+  char buf[TRACE_EVENT_SIZE];
+  size_t n;
+  
+  if (trace_fd < 0)
+    return;
+  
+  n = snprintf (buf, sizeof (buf), "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %ld, \"tid\": %ld, \"args\": {\"name\": \"",
+                trace_sep, (long int) getpid (), trace_tid ());
+  n += trace_escape (& buf[n], sizeof (buf) - n, name);
+  n += snprintf (& buf[n], sizeof (buf) - n, "\"}}");
+  trace_write (buf, n);
+}
+
+void
+trace_span (
+  const char * const category, const char * const name,
+  const double start, const double stop,
+  const char * const key, const char * const value
+)
+{
+  char buf[TRACE_EVENT_SIZE];
+  size_t n;
+  
+  if (trace_fd < 0)
+    return;
+  
+  /* complete events in microseconds of the monotonic clock, which forked saves share */
+  n = snprintf (buf, sizeof (buf), "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %ld, \"tid\": %ld",
+                trace_sep, name, category, start * 1e6, (stop - start) * 1e6, (long int) getpid (), trace_tid ());
+  if (key && n < sizeof (buf))
+  {
+    n += snprintf (& buf[n], sizeof (buf) - n, ", \"args\": {\"%s\": \"", key);
+    n += trace_escape (& buf[n], sizeof (buf) - n, value);
+    n += snprintf (& buf[n], sizeof (buf) - n, "\"}");
+  }
+  if (n < sizeof (buf))
+    n += snprintf (& buf[n], sizeof (buf) - n, "}");
+  trace_write (buf, n);
+}
+
+void
+trace_counter (
+  const char * const name, const char * const key,
+  const double value
+)
+{
+  char buf[TRACE_EVENT_SIZE];
+  size_t n;
+  
+  if (trace_fd < 0)
+    return;
+  
+  /* counters with the same name and different keys are drawn as one track */
+  n = snprintf (buf, sizeof (buf), "%s{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": %ld, \"args\": {\"%s\": %.0f}}",
+                trace_sep, name, trace_clock () * 1e6, (long int) getpid (), key, value);
+  trace_write (buf, n);
+}
+
+static void
+trace_write (
+  const char * const buf, const size_t n
+)
+{
+  ssize_t status;
+  
+  /* events are dropped rather than truncated */
+  if (n < TRACE_EVENT_SIZE)
+    status = write (trace_fd, buf, n);
+}
+
+static long int
+trace_tid (
+  void
+)
+{
+#if defined (HAVE_SYS_SYSCALL_H) && defined (SYS_gettid)
+  return ((long int) syscall (SYS_gettid));
+#else
+  return ((long int) getpid ());
+#endif
+}
+
+static size_t
+trace_escape (
+  char * const buf, const size_t size,
+  const char * const s
+)
+{
+  size_t i, n = 0;
+  
+  for (i = 0; s[i] && n + 7 < size; i++)
+    if (s[i] == '"' || s[i] == '\\')
+    {
+      buf[n++] = '\\';
+      buf[n++] = s[i];
+    }
+    else if ((unsigned char) s[i] < 0x20)
+      n += sprintf (& buf[n], "\\u%04x", (unsigned int) s[i]);
+    else
+      buf[n++] = s[i];
+  buf[n] = '\0';
+  
+  return (n);
+}
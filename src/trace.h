@@ -0,0 +1,97 @@
+/* trace.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __trace_h__
+#define __trace_h__
+
+#include "global.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+#define TRACE_EVENT_SIZE 1024
+
+void
+trace_open (
+  const char * const name
+);
+
+void
+trace_close (
+  void
+);
+
+bool
+trace_enabled (
+  void
+);
+
+double
+trace_clock (
+  void
+);
+
+void
+trace_process (
+  const char * const name
+);
+
+void
+trace_thread (
+  const char * const name
+);
+
+void
+trace_span (
+  const char * const category, const char * const name,
+  const double start, const double stop,
+  const char * const key, const char * const value
+);
+
+void
+trace_counter (
+  const char * const name, const char * const key,
+  const double value
+);
+
+static void
+trace_write (
+  const char * const buf, const size_t n
+);
+
+static long int
+trace_tid (
+  void
+);
+
+static size_t
+trace_escape (
+  char * const buf, const size_t size,
+  const char * const s
+);
+
+#endif
@@ -0,0 +1,497 @@
+/* writer.c
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "writer.h"
+
+void
+writer_chunk (
+  const size_t rank, const hsize_t * const dims, const size_t elsize,
+  const size_t bytes,
+  hsize_t * const chunk
+)
+{
+  size_t i, j;
+  hsize_t cells, target = bytes;
+  
+  for (i = 0, cells = 1; i < rank; i++)
+  {
+    chunk[i] = dims[i] ? dims[i] : 1;
+    cells *= chunk[i];
+  }
+  
+  /* automatic: about 256 chunks, within sensible bounds */
+  if (! target)
+  {
+    target = cells * elsize / 256;
+    if (target < WRITER_CHUNK_MIN)
+      target = WRITER_CHUNK_MIN;
+    if (target > WRITER_CHUNK_MAX)
+      target = WRITER_CHUNK_MAX;
+  }
+  
+  /* halve the longest side first */
+  while (cells * elsize > target)
+  {
+    for (i = 1, j = 0; i < rank; i++)
+      if (chunk[i] > chunk[j])
+        j = i;
+    if (chunk[j] == 1)
+      break;
+    cells /= chunk[j];
+    chunk[j] = (chunk[j] + 1) / 2;
+    cells *= chunk[j];
+  }
+}
+
+hid_t
+writer_dcpl (
+  const size_t rank, const hsize_t * const dims, const size_t elsize,
+  const options_t * const options,
+  hsize_t * const chunk
+)
+{
+  size_t i;
+  unsigned int cd_values[1];
+  hid_t dcpl;
+  hsize_t cells;
+  herr_t status;
+  
+  dcpl = H5Pcreate (H5P_DATASET_CREATE);
+  
+  writer_chunk (rank, dims, elsize, options->chunk, chunk);
+  for (i = 0, cells = 1; i < rank; i++)
+    cells *= dims[i];
+  if (! cells)
+    return (dcpl);
+  
+  status = H5Pset_chunk (dcpl, rank, chunk);
+  
+  /* set compression */
+  if (options->shuffle)
+    status = H5Pset_shuffle (dcpl);
+  switch (options->filter)
+  {
+    case FILTER_DEFLATE:
+      status = H5Pset_deflate (dcpl, options->level);
+      break;
+    case FILTER_ZSTD:
+      cd_values[0] = options->level;
+      status = H5Pset_filter (dcpl, H5Z_FILTER_ZSTD, H5Z_FLAG_OPTIONAL, 1, cd_values);
+      break;
+    case FILTER_LZ4:
+      cd_values[0] = 0;
+      status = H5Pset_filter (dcpl, H5Z_FILTER_LZ4, H5Z_FLAG_OPTIONAL, 1, cd_values);
+      break;
+    default:
+      break;
+  }
+  
+  return (dcpl);
+}
+
+writer_t *
+writer_open (
+  const hid_t dset, const hid_t memtype,
+  const hsize_t * const chunk,
+  const options_t * const options
+)
+{
+  size_t i;
+  hid_t space;
+  herr_t status;
+  writer_t * writer;
+  
+  writer = malloc (sizeof (* writer));
+  
+  writer->dset = dset;
+  writer->memtype = memtype;
+  writer->filetype = H5Dget_type (dset);
+  writer->convert = H5Tequal (memtype, writer->filetype) <= 0;
+  writer->elsize = H5Tget_size (memtype);
+  
+  space = H5Dget_space (dset);
+  writer->rank = H5Sget_simple_extent_ndims (space);
+  H5Sget_simple_extent_dims (space, writer->dims, NULL);
+  status = H5Sclose (space);
+  memcpy (writer->chunk, chunk, writer->rank * sizeof (* chunk));
+  
+  writer->filter = options->filter;
+  writer->level = options->level;
+  writer->shuffle = options->shuffle;
+  
+  /* unfiltered chunks are cheaper to write than to hand over */
+  writer->nthreads = options->nthreads;
+  if (! writer->nthreads)
+    writer->nthreads = writer_cpus ();
+  if (writer->filter == FILTER_NONE && ! writer->shuffle)
+    writer->nthreads = 0;
+  writer->max = 2 * writer->nthreads;
+  writer->inflight = 0;
+  writer->stop = false;
+  writer->todo = writer->todo_last = writer->done = NULL;
+  writer->thread = NULL;
+  
+  if (writer->nthreads)
+  {
+    pthread_mutex_init (& writer->lock, NULL);
+    pthread_cond_init (& writer->cond_todo, NULL);
+    pthread_cond_init (& writer->cond_done, NULL);
+    writer->thread = malloc (writer->nthreads * sizeof (* writer->thread));
+    for (i = 0; i < writer->nthreads; i++)
+      pthread_create (& writer->thread[i], NULL, writer_work, writer);
+  }
+  
+  return (writer);
+}
+
+void
+writer_close (
+  writer_t * writer
+)
+{
+  size_t i;
+  herr_t status;
+  
+  if (writer->nthreads)
+  {
+    writer_drain (writer, true);
+    
+    pthread_mutex_lock (& writer->lock);
+    writer->stop = true;
+    pthread_cond_broadcast (& writer->cond_todo);
+    pthread_mutex_unlock (& writer->lock);
+    for (i = 0; i < writer->nthreads; i++)
+      pthread_join (writer->thread[i], NULL);
+    
+    pthread_mutex_destroy (& writer->lock);
+    pthread_cond_destroy (& writer->cond_todo);
+    pthread_cond_destroy (& writer->cond_done);
+    free (writer->thread);
+  }
+  
+  status = H5Tclose (writer->filetype);
+  free (writer);
+  writer = NULL;
+}
+
+void
+writer_slab (
+  writer_t * const writer,
+  const hsize_t * const start, const hsize_t * const count,
+  const void * const buf
+)
+{
+#ifdef HAVE_H5DWRITE_CHUNK
+  /* start is aligned to the chunk grid, count ends on it or at the edge */
+  size_t i, d;
+  const size_t rank = writer->rank, elsize = writer->elsize;
+  hsize_t cells, so, co,
+          origin[rank], extent[rank], idx[rank], sstride[rank], cstride[rank];
+  bool more;
+  job_t * job;
+  
+  for (d = rank, cells = 1; d-- > 0;)
+  {
+    sstride[d] = (d + 1 < rank) ? sstride[d + 1] * count[d + 1] : 1;
+    cstride[d] = (d + 1 < rank) ? cstride[d + 1] * writer->chunk[d + 1] : 1;
+    cells *= writer->chunk[d];
+    origin[d] = start[d];
+  }
+  
+  do
+  {
+    job = malloc (sizeof (* job));
+    job->size = cells * elsize;
+    job->buf = calloc (cells, elsize);
+    for (d = 0; d < rank; d++)
+    {
+      job->offset[d] = origin[d];
+      extent[d] = start[d] + count[d] - origin[d];
+      if (extent[d] > writer->chunk[d])
+        extent[d] = writer->chunk[d];
+      idx[d] = 0;
+    }
+    
+    /* gather the chunk, one contiguous run of the last axis at a time */
+    do
+    {
+      for (d = 0, so = origin[rank - 1] - start[rank - 1], co = 0; d + 1 < rank; d++)
+      {
+        so += (origin[d] - start[d] + idx[d]) * sstride[d];
+        co += idx[d] * cstride[d];
+      }
+      memcpy (& job->buf[co * elsize], & ((const unsigned char *) buf)[so * elsize], extent[rank - 1] * elsize);
+      
+      for (i = rank - 1, more = false; i-- > 0 && ! more;)
+        if (! (more = ++idx[i] < extent[i]))
+          idx[i] = 0;
+    }
+    while (more);
+    
+    if (writer->convert)
+      H5Tconvert (writer->memtype, writer->filetype, cells, job->buf, NULL, H5P_DEFAULT);
+    
+    writer_submit (writer, job);
+    
+    for (d = rank, more = false; d-- > 0 && ! more;)
+      if (! (more = (origin[d] += writer->chunk[d]) < start[d] + count[d]))
+        origin[d] = start[d];
+  }
+  while (more);
+#else
+  hid_t space, memspace;
+  herr_t status;
+  
+  space = H5Dget_space (writer->dset);
+  status = H5Sselect_hyperslab (space, H5S_SELECT_SET, start, NULL, count, NULL);
+  memspace = H5Screate_simple (writer->rank, count, NULL);
+  status = H5Dwrite (writer->dset, writer->memtype, memspace, space, H5P_DEFAULT, buf);
+  status = H5Sclose (memspace);
+  status = H5Sclose (space);
+#endif
+}
+
+static size_t
+writer_cpus (
+  void
+)
+{
+#ifdef HAVE_SCHED_GETAFFINITY
+  cpu_set_t set;
+  
+  /* the processors this process may actually run on */
+  if (sched_getaffinity (0, sizeof (set), & set) == 0)
+    return ((size_t) CPU_COUNT (& set));
+#endif
+  
+  return ((size_t) sysconf (_SC_NPROCESSORS_ONLN));
+}
+
+static void
+writer_submit (
+  writer_t * const writer,
+  job_t * const job
+)
+{
+  size_t n;
+  
+  job->next = NULL;
+  
+  if (! writer->nthreads)
+  {
+    writer_filter (writer, job);
+    writer_store (writer, job);
+    return;
+  }
+  
+  /* bound the number of chunks in memory */
+  writer_drain (writer, false);
+  
+  pthread_mutex_lock (& writer->lock);
+  if (writer->todo_last)
+    writer->todo_last->next = job;
+  else
+    writer->todo = job;
+  writer->todo_last = job;
+  n = ++writer->inflight;
+  pthread_cond_signal (& writer->cond_todo);
+  pthread_mutex_unlock (& writer->lock);
+  trace_counter ("writer", "inflight", n);
+}
+
+static void
+writer_drain (
+  writer_t * const writer,
+  const bool all
+)
+{
+  job_t * job;
+  size_t n;
+  
+  /* hdf5 is only ever called from this thread */
+  pthread_mutex_lock (& writer->lock);
+  for (;;)
+  {
+    while ((job = writer->done))
+    {
+      writer->done = job->next;
+      pthread_mutex_unlock (& writer->lock);
+      writer_store (writer, job);
+      pthread_mutex_lock (& writer->lock);
+      n = --writer->inflight;
+      pthread_mutex_unlock (& writer->lock);
+      trace_counter ("writer", "inflight", n);
+      pthread_mutex_lock (& writer->lock);
+    }
+    if (all ? ! writer->inflight : writer->inflight < writer->max)
+      break;
+    pthread_cond_wait (& writer->cond_done, & writer->lock);
+  }
+  pthread_mutex_unlock (& writer->lock);
+}
+
+static void
+writer_store (
+  writer_t * const writer,
+  job_t * const job
+)
+{
+  herr_t status;
+  const double start = trace_clock ();
+  
+#ifdef HAVE_H5DWRITE_CHUNK
+  status = H5Dwrite_chunk (writer->dset, H5P_DEFAULT, job->mask, job->offset, job->size, job->out);
+#endif
+  trace_span ("writer", "store", start, trace_clock (), NULL, NULL);
+  
+  if (job->out != job->buf)
+    free (job->out);
+  free (job->buf);
+  free (job);
+}
+
+static void *
+writer_work (
+  void * arg
+)
+{
+  writer_t * const writer = arg;
+  job_t * job;
+  double start;
+  
+  trace_thread ("writer");
+  pthread_mutex_lock (& writer->lock);
+  for (;;)
+  {
+    while (! writer->todo && ! writer->stop)
+      pthread_cond_wait (& writer->cond_todo, & writer->lock);
+    if (! (job = writer->todo))
+      break;
+    if (! (writer->todo = job->next))
+      writer->todo_last = NULL;
+    pthread_mutex_unlock (& writer->lock);
+    
+    start = trace_clock ();
+    writer_filter (writer, job);
+    trace_span ("writer", "filter", start, trace_clock (), NULL, NULL);
+    
+    pthread_mutex_lock (& writer->lock);
+    job->next = writer->done;
+    writer->done = job;
+    pthread_cond_signal (& writer->cond_done);
+  }
+  pthread_mutex_unlock (& writer->lock);
+  
+  return (NULL);
+}
+
+static void
+writer_filter (
+  const writer_t * const writer,
+  job_t * const job
+)
+{
+  size_t i, j, n;
+  unsigned char * tmp;
+  
+  job->out = job->buf;
+  job->mask = 0;
+  
+  /* byte shuffle, same as the hdf5 shuffle filter */
+  if (writer->shuffle)
+  {
+    n = job->size / writer->elsize;
+    tmp = malloc (job->size);
+    for (i = 0; i < writer->elsize; i++)
+      for (j = 0; j < n; j++)
+        tmp[i * n + j] = job->buf[j * writer->elsize + i];
+    job->out = tmp;
+  }
+  
+  /* an optional filter that does not pay off is skipped, as hdf5 does */
+  if (writer->filter != FILTER_NONE)
+  {
+    tmp = malloc (job->size);
+    if ((n = writer_compress (writer, tmp, job->size, job->out, job->size)))
+    {
+      if (job->out != job->buf)
+        free (job->out);
+      job->out = tmp;
+      job->size = n;
+    }
+    else
+    {
+      free (tmp);
+      job->mask |= 1u << (writer->shuffle ? 1 : 0);
+    }
+  }
+}
+
+static size_t
+writer_compress (
+  const writer_t * const writer,
+  unsigned char * const dst, const size_t dstl,
+  const unsigned char * const src, const size_t srcl
+)
+{
+  size_t n = 0;
+  
+  switch (writer->filter)
+  {
+    case FILTER_DEFLATE:
+    {
+      uLongf zn = dstl;
+      
+      if (compress2 (dst, & zn, src, srcl, writer->level) == Z_OK)
+        n = zn;
+      break;
+    }
+#if defined (HAVE_ZSTD_H) && defined (HAVE_LIBZSTD)
+    case FILTER_ZSTD:
+      n = ZSTD_compress (dst, dstl, src, srcl, writer->level);
+      if (ZSTD_isError (n))
+        n = 0;
+      break;
+#endif
+#if defined (HAVE_LZ4_H) && defined (HAVE_LIBLZ4)
+    case FILTER_LZ4:
+    {
+      /* plugin framing: total size, block size, one block */
+      int i, ln;
+      
+      if (dstl <= 16)
+        break;
+      if ((ln = LZ4_compress_default ((const char *) src, (char *) & dst[16], srcl, dstl - 16)) <= 0)
+        break;
+      for (i = 0; i < 8; i++)
+        dst[i] = (unsigned char) ((unsigned long int) srcl >> (8 * (7 - i)));
+      for (i = 0; i < 4; i++)
+      {
+        dst[8 + i] = (unsigned char) ((unsigned long int) srcl >> (8 * (3 - i)));
+        dst[12 + i] = (unsigned char) ((unsigned long int) ln >> (8 * (3 - i)));
+      }
+      n = 16 + (size_t) ln;
+      break;
+    }
+#endif
+    default:
+      break;
+  }
+  
+  return ((n && n < srcl) ? n : 0);
+}
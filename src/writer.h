@@ -0,0 +1,127 @@
+/* writer.h
+ *
+ * Copyright (C) 2015 Torsten Scholak <torsten.scholak@googlemail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __writer_h__
+#define __writer_h__
+
+#include "global.h"
+
+#include "hdf5.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef HAVE_SCHED_GETAFFINITY
+#include <sched.h>
+#endif
+
+#include <zlib.h>
+#if defined (HAVE_ZSTD_H) && defined (HAVE_LIBZSTD)
+#include <zstd.h>
+#endif
+#if defined (HAVE_LZ4_H) && defined (HAVE_LIBLZ4)
+#include <lz4.h>
+#endif
+
+#include "structs.h"
+#include "trace.h"
+
+/* registered ids of the zstd and lz4 filter plugins */
+#define H5Z_FILTER_ZSTD 32015
+#define H5Z_FILTER_LZ4 32004
+
+#define WRITER_CHUNK_MIN 65536
+#define WRITER_CHUNK_MAX 4194304
+
+void
+writer_chunk (
+  const size_t rank, const hsize_t * const dims, const size_t elsize,
+  const size_t bytes,
+  hsize_t * const chunk
+);
+
+hid_t
+writer_dcpl (
+  const size_t rank, const hsize_t * const dims, const size_t elsize,
+  const options_t * const options,
+  hsize_t * const chunk
+);
+
+writer_t *
+writer_open (
+  const hid_t dset, const hid_t memtype,
+  const hsize_t * const chunk,
+  const options_t * const options
+);
+
+void
+writer_close (
+  writer_t * writer
+);
+
+void
+writer_slab (
+  writer_t * const writer,
+  const hsize_t * const start, const hsize_t * const count,
+  const void * const buf
+);
+
+static size_t
+writer_cpus (
+  void
+);
+
+static void
+writer_submit (
+  writer_t * const writer,
+  job_t * const job
+);
+
+static void
+writer_drain (
+  writer_t * const writer,
+  const bool all
+);
+
+static void
+writer_store (
+  writer_t * const writer,
+  job_t * const job
+);
+
+static void *
+writer_work (
+  void * arg
+);
+
+static void
+writer_filter (
+  const writer_t * const writer,
+  job_t * const job
+);
+
+static size_t
+writer_compress (
+  const writer_t * const writer,
+  unsigned char * const dst, const size_t dstl,
+  const unsigned char * const src, const size_t srcl
+);
+
+#endif